@@ -80,7 +80,7 @@ void loop() {
       linker.monitor->setMessage("TX: " + message, MonitorReceive);
 
       /**
-       * Try to send message till serial is avalable
+       * Try to queue message till send queue has room
        */
       while (!linker.rs485->send(message)) {
 
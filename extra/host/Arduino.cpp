@@ -0,0 +1,869 @@
+/*
+ * OptaLinker
+ *
+ * Author: Jean-Christian Paul Denis
+ * Source: https://github.com/JcDenis/OptaLinker
+ *
+ * see README.md file
+ */
+
+#include <Arduino.h>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include <poll.h>
+#include <unistd.h>
+
+/*
+ * String
+ */
+
+String::String(const char *cstr) {
+  if (cstr) {
+    copy(cstr, strlen(cstr));
+  }
+}
+
+String::String(const char *cstr, unsigned int length) {
+  if (cstr) {
+    copy(cstr, length);
+  }
+}
+
+String::String(const String &str) {
+  *this = str;
+}
+
+String::String(String &&str) {
+  *this = static_cast<String &&>(str);
+}
+
+String::String(char c) {
+  copy(&c, 1);
+}
+
+String::String(unsigned char value, unsigned char base) : String((unsigned long long)value, base) {}
+String::String(int value, unsigned char base) : String((long long)value, base) {}
+String::String(unsigned int value, unsigned char base) : String((unsigned long long)value, base) {}
+String::String(long value, unsigned char base) : String((long long)value, base) {}
+String::String(unsigned long value, unsigned char base) : String((unsigned long long)value, base) {}
+
+String::String(long long value, unsigned char base) {
+  if (value < 0 && base == 10) {
+    *this = String((unsigned long long)(-value), base);
+    String minus('-');
+    minus.concat(*this);
+    *this = static_cast<String &&>(minus);
+  } else {
+    *this = String((unsigned long long)value, base);
+  }
+}
+
+String::String(unsigned long long value, unsigned char base) {
+  char buffer[66];
+  char *p = buffer + sizeof(buffer) - 1;
+  *p = '\0';
+  if (base < 2) {
+    base = 10;
+  }
+  do {
+    uint8_t digit = value % base;
+    *--p = digit < 10 ? '0' + digit : 'a' + digit - 10;
+    value /= base;
+  } while (value);
+  copy(p, strlen(p));
+}
+
+String::String(float value, unsigned char decimals) : String((double)value, decimals) {}
+
+String::String(double value, unsigned char decimals) {
+  char buffer[64];
+  snprintf(buffer, sizeof(buffer), "%.*f", decimals, value);
+  copy(buffer, strlen(buffer));
+}
+
+String::~String() {
+  free(_buffer);
+}
+
+String &String::operator=(const String &rhs) {
+  if (this == &rhs) {
+
+    return *this;
+  }
+  if (rhs._buffer) {
+    copy(rhs._buffer, rhs._len);
+  } else {
+    invalidate();
+  }
+
+  return *this;
+}
+
+String &String::operator=(String &&rhs) {
+  if (this != &rhs) {
+    free(_buffer);
+    _buffer = rhs._buffer;
+    _capacity = rhs._capacity;
+    _len = rhs._len;
+    rhs._buffer = nullptr;
+    rhs._capacity = rhs._len = 0;
+  }
+
+  return *this;
+}
+
+String &String::operator=(const char *cstr) {
+  if (cstr) {
+    copy(cstr, strlen(cstr));
+  } else {
+    invalidate();
+  }
+
+  return *this;
+}
+
+void String::invalidate() {
+  free(_buffer);
+  _buffer = nullptr;
+  _capacity = _len = 0;
+}
+
+bool String::reserve(unsigned int size) {
+  if (_buffer && _capacity >= size) {
+
+    return true;
+  }
+  char *buffer = (char *)realloc(_buffer, size + 1);
+  if (!buffer) {
+
+    return false;
+  }
+  if (!_buffer) {
+    buffer[0] = '\0';
+  }
+  _buffer = buffer;
+  _capacity = size;
+
+  return true;
+}
+
+String &String::copy(const char *cstr, unsigned int length) {
+  if (!reserve(length)) {
+    invalidate();
+
+    return *this;
+  }
+  memmove(_buffer, cstr, length);
+  _len = length;
+  _buffer[_len] = '\0';
+
+  return *this;
+}
+
+bool String::concat(const char *cstr, unsigned int length) {
+  if (!cstr) {
+
+    return false;
+  }
+  if (length == 0) {
+
+    return true;
+  }
+  unsigned int total = _len + length;
+  if (total > _capacity && !reserve(total > _capacity * 2 ? total : _capacity * 2)) {
+
+    return false;
+  }
+  memmove(_buffer + _len, cstr, length);
+  _len = total;
+  _buffer[_len] = '\0';
+
+  return true;
+}
+
+bool String::concat(const String &str) { return concat(str.c_str(), str._len); }
+bool String::concat(const char *cstr) { return cstr ? concat(cstr, strlen(cstr)) : false; }
+bool String::concat(char c) { return concat(&c, 1); }
+bool String::concat(unsigned char value) { return concat(String(value)); }
+bool String::concat(int value) { return concat(String(value)); }
+bool String::concat(unsigned int value) { return concat(String(value)); }
+bool String::concat(long value) { return concat(String(value)); }
+bool String::concat(unsigned long value) { return concat(String(value)); }
+bool String::concat(long long value) { return concat(String(value)); }
+bool String::concat(unsigned long long value) { return concat(String(value)); }
+bool String::concat(float value) { return concat(String(value)); }
+bool String::concat(double value) { return concat(String(value)); }
+
+int String::compareTo(const String &s) const {
+  return strcmp(c_str(), s.c_str());
+}
+
+bool String::equals(const String &s) const {
+  return _len == s._len && compareTo(s) == 0;
+}
+
+bool String::equals(const char *cstr) const {
+  return strcmp(c_str(), cstr ? cstr : "") == 0;
+}
+
+bool String::equalsIgnoreCase(const String &s) const {
+  return _len == s._len && strcasecmp(c_str(), s.c_str()) == 0;
+}
+
+bool String::startsWith(const String &prefix) const {
+  return startsWith(prefix, 0);
+}
+
+bool String::startsWith(const String &prefix, unsigned int offset) const {
+  return offset + prefix._len <= _len && strncmp(c_str() + offset, prefix.c_str(), prefix._len) == 0;
+}
+
+bool String::endsWith(const String &suffix) const {
+  return suffix._len <= _len && strcmp(c_str() + _len - suffix._len, suffix.c_str()) == 0;
+}
+
+char String::charAt(unsigned int index) const {
+  return operator[](index);
+}
+
+void String::setCharAt(unsigned int index, char c) {
+  if (index < _len) {
+    _buffer[index] = c;
+  }
+}
+
+char String::operator[](unsigned int index) const {
+  return index < _len ? _buffer[index] : '\0';
+}
+
+char &String::operator[](unsigned int index) {
+  static char dummy;
+  if (index >= _len) {
+    dummy = '\0';
+
+    return dummy;
+  }
+
+  return _buffer[index];
+}
+
+void String::getBytes(unsigned char *buf, unsigned int size, unsigned int index) const {
+  if (!size || !buf) {
+
+    return;
+  }
+  if (index >= _len) {
+    buf[0] = '\0';
+
+    return;
+  }
+  unsigned int n = size - 1;
+  if (n > _len - index) {
+    n = _len - index;
+  }
+  memcpy(buf, _buffer + index, n);
+  buf[n] = '\0';
+}
+
+int String::indexOf(char c, unsigned int from) const {
+  if (from >= _len) {
+
+    return -1;
+  }
+  const char *p = strchr(_buffer + from, c);
+
+  return p ? p - _buffer : -1;
+}
+
+int String::indexOf(const String &str, unsigned int from) const {
+  if (from >= _len) {
+
+    return -1;
+  }
+  const char *p = strstr(_buffer + from, str.c_str());
+
+  return p ? p - _buffer : -1;
+}
+
+int String::lastIndexOf(char c) const {
+  return _len ? lastIndexOf(c, _len - 1) : -1;
+}
+
+int String::lastIndexOf(char c, unsigned int from) const {
+  for (int i = from < _len ? from : (int)_len - 1; i >= 0; i--) {
+    if (_buffer[i] == c) {
+
+      return i;
+    }
+  }
+
+  return -1;
+}
+
+int String::lastIndexOf(const String &str) const {
+  return str._len <= _len ? lastIndexOf(str, _len - str._len) : -1;
+}
+
+int String::lastIndexOf(const String &str, unsigned int from) const {
+  if (str._len == 0 || str._len > _len) {
+
+    return -1;
+  }
+  for (int i = from <= _len - str._len ? from : _len - str._len; i >= 0; i--) {
+    if (strncmp(_buffer + i, str._buffer, str._len) == 0) {
+
+      return i;
+    }
+  }
+
+  return -1;
+}
+
+String String::substring(unsigned int beginIndex, unsigned int endIndex) const {
+  if (beginIndex > endIndex) {
+    unsigned int temp = endIndex;
+    endIndex = beginIndex;
+    beginIndex = temp;
+  }
+  if (beginIndex >= _len) {
+
+    return String();
+  }
+  if (endIndex > _len) {
+    endIndex = _len;
+  }
+
+  return String(_buffer + beginIndex, endIndex - beginIndex);
+}
+
+void String::replace(char find, char replace) {
+  for (unsigned int i = 0; i < _len; i++) {
+    if (_buffer[i] == find) {
+      _buffer[i] = replace;
+    }
+  }
+}
+
+void String::replace(const String &find, const String &replace) {
+  if (_len == 0 || find._len == 0) {
+
+    return;
+  }
+  String result;
+  int from = 0, found;
+  while ((found = indexOf(find, from)) >= 0) {
+    result.concat(_buffer + from, found - from);
+    result.concat(replace);
+    from = found + find._len;
+  }
+  result.concat(_buffer + from, _len - from);
+  *this = static_cast<String &&>(result);
+}
+
+void String::remove(unsigned int index) {
+  remove(index, (unsigned int)-1);
+}
+
+void String::remove(unsigned int index, unsigned int count) {
+  if (index >= _len) {
+
+    return;
+  }
+  if (count > _len - index) {
+    count = _len - index;
+  }
+  memmove(_buffer + index, _buffer + index + count, _len - index - count + 1);
+  _len -= count;
+}
+
+void String::toLowerCase() {
+  for (unsigned int i = 0; i < _len; i++) {
+    _buffer[i] = tolower((unsigned char)_buffer[i]);
+  }
+}
+
+void String::toUpperCase() {
+  for (unsigned int i = 0; i < _len; i++) {
+    _buffer[i] = toupper((unsigned char)_buffer[i]);
+  }
+}
+
+void String::trim() {
+  if (_len == 0) {
+
+    return;
+  }
+  unsigned int b = 0, e = _len;
+  while (b < e && isspace((unsigned char)_buffer[b])) b++;
+  while (e > b && isspace((unsigned char)_buffer[e - 1])) e--;
+  memmove(_buffer, _buffer + b, e - b);
+  _len = e - b;
+  _buffer[_len] = '\0';
+}
+
+long String::toInt() const {
+  return atol(c_str());
+}
+
+float String::toFloat() const {
+  return atof(c_str());
+}
+
+double String::toDouble() const {
+  return atof(c_str());
+}
+
+String operator+(const String &lhs, const String &rhs) { String s(lhs); s.concat(rhs); return s; }
+String operator+(const String &lhs, const char *cstr) { String s(lhs); s.concat(cstr); return s; }
+String operator+(const char *cstr, const String &rhs) { String s(cstr); s.concat(rhs); return s; }
+String operator+(const String &lhs, char c) { String s(lhs); s.concat(c); return s; }
+String operator+(const String &lhs, unsigned char value) { String s(lhs); s.concat(value); return s; }
+String operator+(const String &lhs, int value) { String s(lhs); s.concat(value); return s; }
+String operator+(const String &lhs, unsigned int value) { String s(lhs); s.concat(value); return s; }
+String operator+(const String &lhs, long value) { String s(lhs); s.concat(value); return s; }
+String operator+(const String &lhs, unsigned long value) { String s(lhs); s.concat(value); return s; }
+String operator+(const String &lhs, long long value) { String s(lhs); s.concat(value); return s; }
+String operator+(const String &lhs, unsigned long long value) { String s(lhs); s.concat(value); return s; }
+String operator+(const String &lhs, float value) { String s(lhs); s.concat(value); return s; }
+String operator+(const String &lhs, double value) { String s(lhs); s.concat(value); return s; }
+
+/*
+ * Print and Stream
+ */
+
+size_t Print::write(const uint8_t *buffer, size_t size) {
+  size_t n = 0;
+  while (size--) {
+    if (!write(*buffer++)) {
+      break;
+    }
+    n++;
+  }
+
+  return n;
+}
+
+size_t Print::print(long long value, int base) {
+  return print(String(value, (unsigned char)base));
+}
+
+size_t Print::print(unsigned long long value, int base) {
+  return print(String(value, (unsigned char)base));
+}
+
+size_t Print::print(double value, int digits) {
+  return print(String(value, (unsigned char)digits));
+}
+
+int Stream::timedRead() {
+  unsigned long start = millis();
+  do {
+    int c = read();
+    if (c >= 0) {
+
+      return c;
+    }
+    yield();
+  } while (millis() - start < _timeout);
+
+  return -1;
+}
+
+int Stream::timedPeek() {
+  unsigned long start = millis();
+  do {
+    int c = peek();
+    if (c >= 0) {
+
+      return c;
+    }
+    yield();
+  } while (millis() - start < _timeout);
+
+  return -1;
+}
+
+bool Stream::find(const char *target) {
+  size_t len = strlen(target), index = 0;
+  if (len == 0) {
+
+    return true;
+  }
+  int c;
+  while ((c = timedRead()) >= 0) {
+    if (c == target[index]) {
+      if (++index >= len) {
+
+        return true;
+      }
+    } else {
+      index = c == target[0] ? 1 : 0;
+    }
+  }
+
+  return false;
+}
+
+size_t Stream::readBytes(char *buffer, size_t length) {
+  size_t count = 0;
+  while (count < length) {
+    int c = timedRead();
+    if (c < 0) {
+      break;
+    }
+    *buffer++ = (char)c;
+    count++;
+  }
+
+  return count;
+}
+
+size_t Stream::readBytesUntil(char terminator, char *buffer, size_t length) {
+  size_t count = 0;
+  while (count < length) {
+    int c = timedRead();
+    if (c < 0 || c == terminator) {
+      break;
+    }
+    *buffer++ = (char)c;
+    count++;
+  }
+
+  return count;
+}
+
+String Stream::readString() {
+  String ret;
+  int c;
+  while ((c = timedRead()) >= 0) {
+    ret += (char)c;
+  }
+
+  return ret;
+}
+
+String Stream::readStringUntil(char terminator) {
+  String ret;
+  int c;
+  while ((c = timedRead()) >= 0 && c != terminator) {
+    ret += (char)c;
+  }
+
+  return ret;
+}
+
+long Stream::parseInt() {
+  int c;
+  while ((c = timedPeek()) >= 0 && c != '-' && !isdigit(c)) {
+    read();
+  }
+  bool negative = false;
+  long value = 0;
+  if (c == '-') {
+    negative = true;
+    read();
+  }
+  while ((c = timedPeek()) >= 0 && isdigit(c)) {
+    value = value * 10 + c - '0';
+    read();
+  }
+
+  return negative ? -value : value;
+}
+
+/*
+ * IPAddress
+ */
+
+const IPAddress INADDR_NONE(0, 0, 0, 0);
+
+bool IPAddress::fromString(const char *address) {
+  unsigned int a, b, c, d;
+  char end;
+  if (sscanf(address, "%u.%u.%u.%u%c", &a, &b, &c, &d, &end) != 4 || a > 255 || b > 255 || c > 255 || d > 255) {
+
+    return false;
+  }
+  *this = IPAddress(a, b, c, d);
+
+  return true;
+}
+
+String IPAddress::toString() const {
+  char buffer[16];
+  snprintf(buffer, sizeof(buffer), "%u.%u.%u.%u", _address.bytes[0], _address.bytes[1], _address.bytes[2], _address.bytes[3]);
+
+  return String(buffer);
+}
+
+size_t IPAddress::printTo(Print &p) const {
+  return p.print(toString());
+}
+
+/*
+ * HardwareSerial
+ */
+
+HardwareSerial Serial(STDIN_FILENO, STDOUT_FILENO);
+HardwareSerial Serial1(-1, -1);
+
+int HardwareSerial::available() {
+  if (_peek >= 0) {
+
+    return 1;
+  }
+  if (_in < 0) {
+
+    return 0;
+  }
+  struct pollfd pfd = { _in, POLLIN, 0 };
+
+  return poll(&pfd, 1, 0) > 0 && (pfd.revents & POLLIN) ? 1 : 0;
+}
+
+int HardwareSerial::read() {
+  if (_peek >= 0) {
+    int c = _peek;
+    _peek = -1;
+
+    return c;
+  }
+  uint8_t c;
+  if (!available()) {
+
+    return -1;
+  }
+  ssize_t r = ::read(_in, &c, 1);
+  if (r == 0) {
+
+    // End of input, as a closed serial monitor
+    _in = -1;
+  }
+
+  return r == 1 ? c : -1;
+}
+
+int HardwareSerial::peek() {
+  if (_peek < 0) {
+    _peek = read();
+  }
+
+  return _peek;
+}
+
+void HardwareSerial::flush() {
+  if (_out >= 0) {
+    fsync(_out);
+  }
+}
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size) {
+  if (_out < 0) {
+
+    return size;
+  }
+  size_t n = 0;
+  while (n < size) {
+    ssize_t w = ::write(_out, buffer + n, size - n);
+    if (w <= 0) {
+      break;
+    }
+    n += w;
+  }
+
+  return n;
+}
+
+/*
+ * Time
+ */
+
+namespace {
+
+const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+} // namespace
+
+unsigned long millis() {
+  return (unsigned long)(uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+unsigned long micros() {
+  return (unsigned long)(uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+void delay(unsigned long ms) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void delayMicroseconds(unsigned int us) {
+  std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+void yield() {
+  std::this_thread::yield();
+}
+
+/*
+ * Pins
+ */
+
+namespace {
+
+std::atomic<int> pinValues[HostPinsNum];
+std::function<void()> pinInterrupts[HostPinsNum];
+int pinInterruptModes[HostPinsNum];
+int analogBits = 10;
+
+// Interrupts run in caller thread of host::setDigital(), this lock masks them
+std::recursive_mutex interruptLock;
+
+int toLevel(int value) {
+  return value >= 2048 ? HIGH : LOW;
+}
+
+} // namespace
+
+void pinMode(pin_size_t pin, int mode) {
+  if (pin < HostPinsNum && (mode == INPUT_PULLUP)) {
+    pinValues[pin] = 4095;
+  }
+}
+
+void digitalWrite(pin_size_t pin, int value) {
+  if (pin < HostPinsNum) {
+    pinValues[pin] = value ? 4095 : 0;
+  }
+}
+
+int digitalRead(pin_size_t pin) {
+  if (pin == BTN_USER) {
+
+    // User button is active low and never pushed
+    return HIGH;
+  }
+
+  return pin < HostPinsNum ? toLevel(pinValues[pin]) : LOW;
+}
+
+int analogRead(pin_size_t pin) {
+  int value = pin < HostPinsNum ? pinValues[pin].load() : 0;
+
+  return analogBits >= 12 ? value << (analogBits - 12) : value >> (12 - analogBits);
+}
+
+void analogReadResolution(int bits) {
+  analogBits = bits;
+}
+
+void attachInterrupt(pin_size_t interrupt, void (*callback)(void), int mode) {
+  if (interrupt < HostPinsNum) {
+    std::lock_guard<std::recursive_mutex> lock(interruptLock);
+    pinInterrupts[interrupt] = callback;
+    pinInterruptModes[interrupt] = mode;
+  }
+}
+
+void attachInterruptParam(pin_size_t interrupt, void (*callback)(void *), int mode, void *param) {
+  if (interrupt < HostPinsNum) {
+    std::lock_guard<std::recursive_mutex> lock(interruptLock);
+    pinInterrupts[interrupt] = [callback, param]() { callback(param); };
+    pinInterruptModes[interrupt] = mode;
+  }
+}
+
+void detachInterrupt(pin_size_t interrupt) {
+  if (interrupt < HostPinsNum) {
+    std::lock_guard<std::recursive_mutex> lock(interruptLock);
+    pinInterrupts[interrupt] = nullptr;
+  }
+}
+
+void noInterrupts() {
+  interruptLock.lock();
+}
+
+void interrupts() {
+  interruptLock.unlock();
+}
+
+long random(long max) {
+  return max > 0 ? rand() % max : 0;
+}
+
+long random(long min, long max) {
+  return min < max ? min + random(max - min) : min;
+}
+
+void randomSeed(unsigned long seed) {
+  srand(seed);
+}
+
+/*
+ * Host simulation control
+ */
+
+namespace host {
+
+namespace {
+
+char **arguments = nullptr;
+
+} // namespace
+
+void setAnalog(pin_size_t pin, int value) {
+  if (pin >= HostPinsNum) {
+
+    return;
+  }
+  std::lock_guard<std::recursive_mutex> lock(interruptLock);
+  int previous = toLevel(pinValues[pin].exchange(value));
+  int level = toLevel(value);
+  int mode = pinInterruptModes[pin];
+  if (pinInterrupts[pin] && previous != level
+    && (mode == CHANGE || (mode == RISING && level) || (mode == FALLING && !level))
+  ) {
+    pinInterrupts[pin]();
+  }
+}
+
+void setDigital(pin_size_t pin, int value) {
+  setAnalog(pin, value ? 4095 : 0);
+}
+
+const char *getRoot() {
+  const char *root = getenv("OPTALINKER_HOST_ROOT");
+
+  return root && root[0] ? root : "optalinker_host";
+}
+
+uint16_t getPortOffset() {
+  const char *offset = getenv("OPTALINKER_HOST_PORT_OFFSET");
+
+  // Unprivileged process listens on port + 8000 by default
+  return offset ? atoi(offset) : (geteuid() == 0 ? 0 : 8000);
+}
+
+void setArguments(int argc, char **argv) {
+  (void)argc;
+  arguments = argv;
+}
+
+} // namespace host
+
+void NVIC_SystemReset() {
+  Serial.println("");
+  Serial.println("Host: system reset");
+  fflush(stdout);
+
+  // Restart process to simulate a reboot, flash and keys are kept
+  if (host::arguments) {
+    execv("/proc/self/exe", host::arguments);
+  }
+  _exit(0);
+}
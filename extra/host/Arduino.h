@@ -0,0 +1,472 @@
+/*
+ * OptaLinker
+ *
+ * Author: Jean-Christian Paul Denis
+ * Source: https://github.com/JcDenis/OptaLinker
+ *
+ * see README.md file
+ */
+
+#ifndef OPTALINKER_HOST_ARDUINO_H
+#define OPTALINKER_HOST_ARDUINO_H
+
+/**
+ * Host simulation of Arduino core API.
+ *
+ * Only the part of the API used by OptaLinker and its dependencies is provided.
+ * Pins are simulated in memory, Serial is bound to stdin/stdout.
+ */
+
+#ifndef ARDUINO
+#define ARDUINO 10607
+#endif
+#ifndef CORE_CM7
+#define CORE_CM7 1
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <ctype.h>
+#include <math.h>
+#include <time.h>
+
+#define HIGH 0x1
+#define LOW  0x0
+
+#define INPUT          0x0
+#define OUTPUT         0x1
+#define INPUT_PULLUP   0x2
+#define INPUT_PULLDOWN 0x3
+
+#define CHANGE  2
+#define FALLING 3
+#define RISING  4
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+#define PROGMEM
+#define memcpy_P memcpy
+#define strlen_P strlen
+
+#define SERIAL_8N1 0x06
+#define SERIAL_8N2 0x0E
+#define SERIAL_8E1 0x26
+#define SERIAL_8E2 0x2E
+#define SERIAL_8O1 0x36
+#define SERIAL_8O2 0x3E
+
+typedef uint8_t byte;
+typedef uint16_t word;
+typedef bool boolean;
+typedef uint8_t pin_size_t;
+
+/**
+ * Opta pins.
+ */
+enum HostPin : pin_size_t {
+  A0, A1, A2, A3, A4, A5, A6, A7,
+  D0, D1, D2, D3,
+  LED_D0, LED_D1, LED_D2, LED_D3,
+  LEDG, LEDR, LEDB,
+  BTN_USER,
+  PIN_SERIAL1_TX, PIN_SERIAL1_RX,
+  HostPinsNum
+};
+
+#define SERIAL_PORT_HARDWARE Serial1
+
+template <class T, class L> auto min(const T &a, const L &b) -> decltype((b < a) ? b : a) { return (b < a) ? b : a; }
+template <class T, class L> auto max(const T &a, const L &b) -> decltype((b < a) ? b : a) { return (a < b) ? b : a; }
+template <class T, class L, class H> auto constrain(const T &v, const L &l, const H &h) -> decltype((v < l) ? l : (v > h) ? h : v) { return (v < l) ? l : (v > h) ? h : v; }
+
+class __FlashStringHelper;
+#define F(string_literal) (reinterpret_cast<const __FlashStringHelper *>(string_literal))
+
+/**
+ * Arduino String.
+ */
+class String {
+
+public:
+  String(const char *cstr = "");
+  String(const char *cstr, unsigned int length);
+  String(const __FlashStringHelper *str) : String(reinterpret_cast<const char *>(str)) {}
+  String(const String &str);
+  String(String &&str);
+  explicit String(char c);
+  explicit String(unsigned char value, unsigned char base = 10);
+  explicit String(int value, unsigned char base = 10);
+  explicit String(unsigned int value, unsigned char base = 10);
+  explicit String(long value, unsigned char base = 10);
+  explicit String(unsigned long value, unsigned char base = 10);
+  explicit String(long long value, unsigned char base = 10);
+  explicit String(unsigned long long value, unsigned char base = 10);
+  explicit String(float value, unsigned char decimals = 2);
+  explicit String(double value, unsigned char decimals = 2);
+  ~String();
+
+  String &operator=(const String &rhs);
+  String &operator=(String &&rhs);
+  String &operator=(const char *cstr);
+
+  bool reserve(unsigned int size);
+  unsigned int length() const { return _len; }
+  bool isEmpty() const { return _len == 0; }
+  const char *c_str() const { return _buffer ? _buffer : ""; }
+  char *begin() { return _buffer; }
+  char *end() { return _buffer + _len; }
+  const char *begin() const { return c_str(); }
+  const char *end() const { return c_str() + _len; }
+
+  bool concat(const String &str);
+  bool concat(const char *cstr);
+  bool concat(const char *cstr, unsigned int length);
+  bool concat(const uint8_t *cstr, unsigned int length) { return concat((const char *)cstr, length); }
+  bool concat(char c);
+  bool concat(unsigned char value);
+  bool concat(int value);
+  bool concat(unsigned int value);
+  bool concat(long value);
+  bool concat(unsigned long value);
+  bool concat(long long value);
+  bool concat(unsigned long long value);
+  bool concat(float value);
+  bool concat(double value);
+
+  template <class T> String &operator+=(const T &rhs) { concat(rhs); return *this; }
+
+  explicit operator bool() const { return _buffer != nullptr; }
+
+  int compareTo(const String &s) const;
+  bool equals(const String &s) const;
+  bool equals(const char *cstr) const;
+  bool equalsIgnoreCase(const String &s) const;
+  bool operator==(const String &rhs) const { return equals(rhs); }
+  bool operator==(const char *cstr) const { return equals(cstr); }
+  bool operator!=(const String &rhs) const { return !equals(rhs); }
+  bool operator!=(const char *cstr) const { return !equals(cstr); }
+  bool operator<(const String &rhs) const { return compareTo(rhs) < 0; }
+  bool operator>(const String &rhs) const { return compareTo(rhs) > 0; }
+  bool operator<=(const String &rhs) const { return compareTo(rhs) <= 0; }
+  bool operator>=(const String &rhs) const { return compareTo(rhs) >= 0; }
+  bool startsWith(const String &prefix) const;
+  bool startsWith(const String &prefix, unsigned int offset) const;
+  bool endsWith(const String &suffix) const;
+
+  char charAt(unsigned int index) const;
+  void setCharAt(unsigned int index, char c);
+  char operator[](unsigned int index) const;
+  char &operator[](unsigned int index);
+  void getBytes(unsigned char *buf, unsigned int size, unsigned int index = 0) const;
+  void toCharArray(char *buf, unsigned int size, unsigned int index = 0) const { getBytes((unsigned char *)buf, size, index); }
+
+  int indexOf(char c, unsigned int from = 0) const;
+  int indexOf(const String &str, unsigned int from = 0) const;
+  int lastIndexOf(char c) const;
+  int lastIndexOf(char c, unsigned int from) const;
+  int lastIndexOf(const String &str) const;
+  int lastIndexOf(const String &str, unsigned int from) const;
+  String substring(unsigned int beginIndex) const { return substring(beginIndex, _len); }
+  String substring(unsigned int beginIndex, unsigned int endIndex) const;
+
+  void replace(char find, char replace);
+  void replace(const String &find, const String &replace);
+  void remove(unsigned int index);
+  void remove(unsigned int index, unsigned int count);
+  void toLowerCase();
+  void toUpperCase();
+  void trim();
+
+  long toInt() const;
+  float toFloat() const;
+  double toDouble() const;
+
+private:
+  char *_buffer = nullptr;
+  unsigned int _capacity = 0;
+  unsigned int _len = 0;
+
+  void invalidate();
+  String &copy(const char *cstr, unsigned int length);
+};
+
+String operator+(const String &lhs, const String &rhs);
+String operator+(const String &lhs, const char *cstr);
+String operator+(const char *cstr, const String &rhs);
+String operator+(const String &lhs, char c);
+String operator+(const String &lhs, unsigned char value);
+String operator+(const String &lhs, int value);
+String operator+(const String &lhs, unsigned int value);
+String operator+(const String &lhs, long value);
+String operator+(const String &lhs, unsigned long value);
+String operator+(const String &lhs, long long value);
+String operator+(const String &lhs, unsigned long long value);
+String operator+(const String &lhs, float value);
+String operator+(const String &lhs, double value);
+
+class Print;
+
+/**
+ * Arduino Printable interface.
+ */
+class Printable {
+
+public:
+  virtual ~Printable() {}
+  virtual size_t printTo(Print &p) const = 0;
+};
+
+/**
+ * Arduino Print.
+ */
+class Print {
+
+public:
+  virtual ~Print() {}
+
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t *buffer, size_t size);
+  size_t write(const char *str) { return str ? write((const uint8_t *)str, strlen(str)) : 0; }
+  size_t write(const char *buffer, size_t size) { return write((const uint8_t *)buffer, size); }
+  virtual int availableForWrite() { return 0; }
+  virtual void flush() {}
+
+  size_t print(const __FlashStringHelper *str) { return print(reinterpret_cast<const char *>(str)); }
+  size_t print(const String &str) { return write(str.c_str(), str.length()); }
+  size_t print(const char *str) { return write(str); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(unsigned char value, int base = DEC) { return print((unsigned long long)value, base); }
+  size_t print(int value, int base = DEC) { return print((long long)value, base); }
+  size_t print(unsigned int value, int base = DEC) { return print((unsigned long long)value, base); }
+  size_t print(long value, int base = DEC) { return print((long long)value, base); }
+  size_t print(unsigned long value, int base = DEC) { return print((unsigned long long)value, base); }
+  size_t print(long long value, int base = DEC);
+  size_t print(unsigned long long value, int base = DEC);
+  size_t print(double value, int digits = 2);
+  size_t print(const Printable &p) { return p.printTo(*this); }
+
+  template <class T> size_t println(const T &value) { size_t n = print(value); return n + println(); }
+  template <class T> size_t println(const T &value, int format) { size_t n = print(value, format); return n + println(); }
+  size_t println() { return write("\r\n"); }
+};
+
+/**
+ * Arduino Stream.
+ */
+class Stream : public Print {
+
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+
+  void setTimeout(unsigned long timeout) { _timeout = timeout; }
+  unsigned long getTimeout() { return _timeout; }
+
+  bool find(const char *target);
+  size_t readBytes(char *buffer, size_t length);
+  size_t readBytes(uint8_t *buffer, size_t length) { return readBytes((char *)buffer, length); }
+  size_t readBytesUntil(char terminator, char *buffer, size_t length);
+  size_t readBytesUntil(char terminator, uint8_t *buffer, size_t length) { return readBytesUntil(terminator, (char *)buffer, length); }
+  String readString();
+  String readStringUntil(char terminator);
+  long parseInt();
+
+protected:
+  unsigned long _timeout = 1000;
+
+  int timedRead();
+  int timedPeek();
+};
+
+/**
+ * Arduino IPv4 address.
+ */
+class IPAddress : public Printable {
+
+public:
+  IPAddress() { _address.dword = 0; }
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) { _address.bytes[0] = a; _address.bytes[1] = b; _address.bytes[2] = c; _address.bytes[3] = d; }
+  IPAddress(uint32_t address) { _address.dword = address; }
+  IPAddress(const uint8_t *address) { memcpy(_address.bytes, address, 4); }
+
+  bool fromString(const char *address);
+  bool fromString(const String &address) { return fromString(address.c_str()); }
+
+  operator uint32_t() const { return _address.dword; }
+  bool operator==(const IPAddress &addr) const { return _address.dword == addr._address.dword; }
+  bool operator!=(const IPAddress &addr) const { return _address.dword != addr._address.dword; }
+  bool operator==(const uint8_t *addr) const { return memcmp(addr, _address.bytes, 4) == 0; }
+  uint8_t operator[](int index) const { return _address.bytes[index]; }
+  uint8_t &operator[](int index) { return _address.bytes[index]; }
+  uint8_t *raw_address() { return _address.bytes; }
+
+  String toString() const;
+  size_t printTo(Print &p) const override;
+
+private:
+  union {
+    uint8_t bytes[4];
+    uint32_t dword;
+  } _address;
+};
+
+extern const IPAddress INADDR_NONE;
+
+/**
+ * Arduino network client interface.
+ */
+class Client : public Stream {
+
+public:
+  virtual int connect(IPAddress ip, uint16_t port) = 0;
+  virtual int connect(const char *host, uint16_t port) = 0;
+  virtual size_t write(uint8_t) = 0;
+  virtual size_t write(const uint8_t *buf, size_t size) = 0;
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int read(uint8_t *buf, size_t size) = 0;
+  virtual int peek() = 0;
+  virtual void flush() = 0;
+  virtual void stop() = 0;
+  virtual uint8_t connected() = 0;
+  virtual operator bool() = 0;
+
+protected:
+  uint8_t *rawIPAddress(IPAddress &addr) { return addr.raw_address(); }
+};
+
+/**
+ * Arduino network server interface.
+ */
+class Server : public Print {
+
+public:
+  virtual void begin() = 0;
+};
+
+/**
+ * Arduino UDP interface.
+ */
+class UDP : public Stream {
+
+public:
+  virtual uint8_t begin(uint16_t port) = 0;
+  virtual void stop() = 0;
+  virtual int beginPacket(IPAddress ip, uint16_t port) = 0;
+  virtual int beginPacket(const char *host, uint16_t port) = 0;
+  virtual int endPacket() = 0;
+  virtual size_t write(uint8_t) = 0;
+  virtual size_t write(const uint8_t *buffer, size_t size) = 0;
+  virtual int parsePacket() = 0;
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int read(unsigned char *buffer, size_t len) = 0;
+  virtual int read(char *buffer, size_t len) = 0;
+  virtual int peek() = 0;
+  virtual void flush() = 0;
+  virtual IPAddress remoteIP() = 0;
+  virtual uint16_t remotePort() = 0;
+
+protected:
+  uint8_t *rawIPAddress(IPAddress &addr) { return addr.raw_address(); }
+};
+
+/**
+ * Arduino hardware serial.
+ *
+ * Serial reads stdin and writes stdout, Serial1 (RS485) is not wired to anything.
+ */
+class HardwareSerial : public Stream {
+
+public:
+  HardwareSerial(int in, int out) : _in(in), _out(out) {}
+
+  void begin(unsigned long baudrate) { begin(baudrate, SERIAL_8N1); }
+  void begin(unsigned long baudrate, uint16_t config) { _baudrate = baudrate; (void)config; }
+  void end() { _baudrate = 0; }
+  operator bool() { return true; }
+
+  int available() override;
+  int read() override;
+  int peek() override;
+  void flush() override;
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t *buffer, size_t size) override;
+  using Print::write;
+
+private:
+  int _in;
+  int _out;
+  int _peek = -1;
+  unsigned long _baudrate = 0;
+};
+
+extern HardwareSerial Serial;
+extern HardwareSerial Serial1;
+
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+unsigned long millis();
+unsigned long micros();
+void yield();
+
+void pinMode(pin_size_t pin, int mode);
+void digitalWrite(pin_size_t pin, int value);
+int digitalRead(pin_size_t pin);
+int analogRead(pin_size_t pin);
+void analogReadResolution(int bits);
+void attachInterrupt(pin_size_t interrupt, void (*callback)(void), int mode);
+void attachInterruptParam(pin_size_t interrupt, void (*callback)(void *), int mode, void *param);
+void detachInterrupt(pin_size_t interrupt);
+inline pin_size_t digitalPinToInterrupt(pin_size_t pin) { return pin; }
+
+void noInterrupts();
+void interrupts();
+void NVIC_SystemReset();
+
+long random(long max);
+long random(long min, long max);
+void randomSeed(unsigned long seed);
+
+/**
+ * Host simulation control.
+ */
+namespace host {
+
+/**
+ * Set a simulated analog input value, from 0 to 4095 on 12 bits.
+ */
+void setAnalog(pin_size_t pin, int value);
+
+/**
+ * Set a simulated digital input state, interrupts are triggered accordingly.
+ *
+ * Analog and digital values are the same, digital level is high above half scale.
+ */
+void setDigital(pin_size_t pin, int value);
+
+/**
+ * Get directory where simulated flash, filesystems and keys are stored.
+ */
+const char *getRoot();
+
+/**
+ * Get offset added to listened TCP and UDP ports, as ports below 1024 need privileges.
+ */
+uint16_t getPortOffset();
+
+/**
+ * Keep process arguments to restart it on reboot.
+ */
+void setArguments(int argc, char **argv);
+
+} // namespace host
+
+#endif // #ifndef OPTALINKER_HOST_ARDUINO_H
@@ -0,0 +1,68 @@
+/*
+ * OptaLinker
+ *
+ * Author: Jean-Christian Paul Denis
+ * Source: https://github.com/JcDenis/OptaLinker
+ *
+ * see README.md file
+ */
+
+#ifndef OPTALINKER_HOST_ARDUINO_PORTENTA_OTA_H
+#define OPTALINKER_HOST_ARDUINO_PORTENTA_OTA_H
+
+#include <Arduino.h>
+#include <mbed.h>
+
+/**
+ * OTA bootloader interface.
+ *
+ * Host can download and check OTA file, but firmware is never applied.
+ */
+enum StorageTypePortenta {
+  QSPI_FLASH_FATFS,
+  QSPI_FLASH_FATFS_MBR,
+  SD_FATFS,
+  SD_FATFS_MBR
+};
+
+class Arduino_Portenta_OTA {
+
+public:
+  enum class Error : int {
+    None                 = 0,
+    NoCapableBootloader  = -1,
+    NoOtaStorage         = -2,
+    OtaStorageInit       = -3,
+    OtaStorageOpen       = -4,
+    OtaHeaderLength      = -5,
+    OtaHeaderCrc         = -6,
+    OtaHeaterMagicNumber = -7,
+    CaStorageInit        = -8,
+    CaStorageOpen        = -9
+  };
+
+  typedef void (*ArduinoPortentaOtaWatchdogResetFuncPointer)(void);
+
+  Arduino_Portenta_OTA(StorageTypePortenta storage, uint32_t data_offset) { (void)storage; (void)data_offset; }
+  virtual ~Arduino_Portenta_OTA() {}
+
+  bool isOtaCapable() { return true; }
+  Error begin() { return Error::None; }
+  Error update();
+  int download(const char *url, bool const is_https, void *cb = nullptr) { (void)url; (void)is_https; (void)cb; return -1; }
+  int decompress() { return -1; }
+  void reset();
+  void setFeedWatchdogFunc(ArduinoPortentaOtaWatchdogResetFuncPointer func) { _feedWatchdog = func; }
+  void feedWatchdog() { if (_feedWatchdog) _feedWatchdog(); }
+
+private:
+  ArduinoPortentaOtaWatchdogResetFuncPointer _feedWatchdog = nullptr;
+};
+
+class Arduino_Portenta_OTA_QSPI : public Arduino_Portenta_OTA {
+
+public:
+  Arduino_Portenta_OTA_QSPI(StorageTypePortenta storage, uint32_t data_offset) : Arduino_Portenta_OTA(storage, data_offset) {}
+};
+
+#endif // #ifndef OPTALINKER_HOST_ARDUINO_PORTENTA_OTA_H
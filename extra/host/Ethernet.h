@@ -0,0 +1,70 @@
+/*
+ * OptaLinker
+ *
+ * Author: Jean-Christian Paul Denis
+ * Source: https://github.com/JcDenis/OptaLinker
+ *
+ * see README.md file
+ */
+
+#ifndef OPTALINKER_HOST_ETHERNET_H
+#define OPTALINKER_HOST_ETHERNET_H
+
+#include <Arduino.h>
+#include "HostSocket.h"
+
+enum EthernetLinkStatus {
+  Unknown,
+  LinkON,
+  LinkOFF
+};
+
+enum EthernetHardwareStatus {
+  EthernetNoHardware,
+  EthernetMbed = 6
+};
+
+class EthernetClient : public HostClient {
+
+public:
+  EthernetClient() {}
+  explicit EthernetClient(int fd) : HostClient(fd) {}
+};
+
+class EthernetServer : public HostServer {
+
+public:
+  EthernetServer(uint16_t port = 80) : HostServer(port) {}
+
+  EthernetClient accept() { return EthernetClient(acceptSocket()); }
+  EthernetClient available() { return accept(); }
+};
+
+class EthernetUDP : public HostUDP {};
+
+/**
+ * Ethernet interface, it is always linked with host address.
+ */
+class EthernetClass {
+
+public:
+  int begin(uint8_t *mac = nullptr, unsigned long timeout = 60000, unsigned long responseTimeout = 4000);
+  int begin(uint8_t *mac, IPAddress ip, IPAddress dns, IPAddress gateway, IPAddress subnet, unsigned long timeout = 60000, unsigned long responseTimeout = 4000);
+  int maintain() { return 0; }
+  EthernetLinkStatus linkStatus() { return LinkON; }
+  EthernetHardwareStatus hardwareStatus() { return EthernetMbed; }
+  IPAddress localIP() { return _ip; }
+  IPAddress subnetMask() { return _subnet; }
+  IPAddress gatewayIP() { return _gateway; }
+  IPAddress dnsServerIP() { return _dns; }
+
+private:
+  IPAddress _ip;
+  IPAddress _dns;
+  IPAddress _gateway;
+  IPAddress _subnet;
+};
+
+extern EthernetClass Ethernet;
+
+#endif // #ifndef OPTALINKER_HOST_ETHERNET_H
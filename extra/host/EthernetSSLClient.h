@@ -0,0 +1,20 @@
+/*
+ * OptaLinker
+ *
+ * Author: Jean-Christian Paul Denis
+ * Source: https://github.com/JcDenis/OptaLinker
+ *
+ * see README.md file
+ */
+
+#ifndef OPTALINKER_HOST_ETHERNET_SSL_CLIENT_H
+#define OPTALINKER_HOST_ETHERNET_SSL_CLIENT_H
+
+#include <Ethernet.h>
+
+/**
+ * TLS is not simulated, it is a plain TCP client.
+ */
+class EthernetSSLClient : public EthernetClient {};
+
+#endif // #ifndef OPTALINKER_HOST_ETHERNET_SSL_CLIENT_H
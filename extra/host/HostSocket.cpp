@@ -0,0 +1,445 @@
+/*
+ * OptaLinker
+ *
+ * Author: Jean-Christian Paul Denis
+ * Source: https://github.com/JcDenis/OptaLinker
+ *
+ * see README.md file
+ */
+
+#include "HostSocket.h"
+
+#include <Ethernet.h>
+#include <WiFi.h>
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <ifaddrs.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+void setNonBlocking(int fd) {
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+}
+
+struct sockaddr_in toAddress(IPAddress ip, uint16_t port) {
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = (uint32_t)ip;
+
+  return addr;
+}
+
+} // namespace
+
+/*
+ * Client
+ */
+
+HostClient::HostClient(int fd) {
+  if (fd >= 0) {
+    _socket = std::make_shared<Socket>(fd);
+  }
+}
+
+HostClient::Socket::~Socket() {
+  if (fd >= 0) {
+    ::close(fd);
+  }
+}
+
+int HostClient::connect(IPAddress ip, uint16_t port) {
+  struct sockaddr_in addr = toAddress(ip, port);
+
+  return connect((const struct sockaddr *)&addr, sizeof(addr));
+}
+
+int HostClient::connect(const char *host, uint16_t port) {
+  IPAddress ip;
+
+  return host::resolve(host, ip) ? connect(ip, port) : 0;
+}
+
+int HostClient::connect(const struct sockaddr *addr, unsigned int len) {
+  stop();
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0) {
+
+    return 0;
+  }
+  setNonBlocking(fd);
+
+  // Connect with timeout
+  if (::connect(fd, addr, len) != 0) {
+    struct pollfd pfd = { fd, POLLOUT, 0 };
+    int error = 0;
+    socklen_t size = sizeof(error);
+    if (errno != EINPROGRESS
+      || poll(&pfd, 1, _timeout) <= 0
+      || getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &size) != 0
+      || error != 0
+    ) {
+      ::close(fd);
+
+      return 0;
+    }
+  }
+  int flag = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+  _socket = std::make_shared<Socket>(fd);
+
+  return 1;
+}
+
+size_t HostClient::write(const uint8_t *buf, size_t size) {
+  size_t n = 0;
+  while (*this && n < size) {
+    ssize_t w = send(_socket->fd, buf + n, size - n, MSG_NOSIGNAL);
+    if (w > 0) {
+      n += w;
+    } else if (w < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+
+      // Blocking write as device network stack does
+      struct pollfd pfd = { _socket->fd, POLLOUT, 0 };
+      if (poll(&pfd, 1, _timeout) <= 0) {
+        break;
+      }
+    } else {
+      break;
+    }
+  }
+
+  return n;
+}
+
+int HostClient::available() {
+  int count = 0;
+  if (!*this || ioctl(_socket->fd, FIONREAD, &count) != 0) {
+
+    return 0;
+  }
+
+  return count;
+}
+
+int HostClient::read() {
+  uint8_t c;
+
+  return read(&c, 1) == 1 ? c : -1;
+}
+
+int HostClient::read(uint8_t *buf, size_t size) {
+  if (!*this) {
+
+    return -1;
+  }
+  ssize_t r = recv(_socket->fd, buf, size, MSG_DONTWAIT);
+
+  return r > 0 ? r : -1;
+}
+
+int HostClient::peek() {
+  uint8_t c;
+  if (!*this) {
+
+    return -1;
+  }
+
+  return recv(_socket->fd, &c, 1, MSG_DONTWAIT | MSG_PEEK) == 1 ? c : -1;
+}
+
+void HostClient::stop() {
+  _socket.reset();
+}
+
+uint8_t HostClient::connected() {
+  if (!*this) {
+
+    return 0;
+  }
+  if (available() > 0) {
+
+    return 1;
+  }
+
+  // Peer closed connection if socket is readable without data
+  uint8_t c;
+  ssize_t r = recv(_socket->fd, &c, 1, MSG_DONTWAIT | MSG_PEEK);
+
+  return r == 0 || (r < 0 && errno != EAGAIN && errno != EWOULDBLOCK) ? 0 : 1;
+}
+
+IPAddress HostClient::remoteIP() {
+  struct sockaddr_in addr;
+  socklen_t len = sizeof(addr);
+  if (!*this || getpeername(_socket->fd, (struct sockaddr *)&addr, &len) != 0) {
+
+    return IPAddress();
+  }
+
+  return IPAddress((uint32_t)addr.sin_addr.s_addr);
+}
+
+uint16_t HostClient::remotePort() {
+  struct sockaddr_in addr;
+  socklen_t len = sizeof(addr);
+  if (!*this || getpeername(_socket->fd, (struct sockaddr *)&addr, &len) != 0) {
+
+    return 0;
+  }
+
+  return ntohs(addr.sin_port);
+}
+
+/*
+ * Server
+ */
+
+HostServer::Socket::~Socket() {
+  if (fd >= 0) {
+    ::close(fd);
+  }
+}
+
+void HostServer::begin() {
+  end();
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0) {
+
+    return;
+  }
+  int flag = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &flag, sizeof(flag));
+  uint16_t port = _port + host::getPortOffset();
+  struct sockaddr_in addr = toAddress(IPAddress(0, 0, 0, 0), port);
+  if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, 8) != 0) {
+    Serial.println(String("Host: can not listen on port ") + port + ", " + strerror(errno));
+    ::close(fd);
+
+    return;
+  }
+  setNonBlocking(fd);
+  _socket = std::make_shared<Socket>(fd);
+}
+
+void HostServer::end() {
+  _socket.reset();
+}
+
+int HostServer::acceptSocket() {
+  if (!_socket) {
+
+    return -1;
+  }
+  int fd = accept(_socket->fd, nullptr, nullptr);
+  if (fd >= 0) {
+    int flag = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+    setNonBlocking(fd);
+  }
+
+  return fd;
+}
+
+/*
+ * UDP
+ */
+
+int HostUDP::open() {
+  if (_fd < 0) {
+    _fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (_fd >= 0) {
+      setNonBlocking(_fd);
+    }
+  }
+
+  return _fd;
+}
+
+uint8_t HostUDP::begin(uint16_t port) {
+  stop();
+  if (open() < 0) {
+
+    return 0;
+  }
+
+  // Port 0 is an ephemeral client port, others are services
+  struct sockaddr_in addr = toAddress(IPAddress(0, 0, 0, 0), port ? port + host::getPortOffset() : 0);
+  if (bind(_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+    stop();
+
+    return 0;
+  }
+
+  return 1;
+}
+
+void HostUDP::stop() {
+  if (_fd >= 0) {
+    ::close(_fd);
+    _fd = -1;
+  }
+  _rx.clear();
+  _rxIndex = 0;
+}
+
+int HostUDP::beginPacket(IPAddress ip, uint16_t port) {
+  _tx.clear();
+  _txIp = ip;
+  _txPort = port;
+
+  return open() >= 0 ? 1 : 0;
+}
+
+int HostUDP::beginPacket(const char *host, uint16_t port) {
+  IPAddress ip;
+
+  return host::resolve(host, ip) ? beginPacket(ip, port) : 0;
+}
+
+size_t HostUDP::write(const uint8_t *buffer, size_t size) {
+  _tx.insert(_tx.end(), buffer, buffer + size);
+
+  return size;
+}
+
+int HostUDP::endPacket() {
+  struct sockaddr_in addr = toAddress(_txIp, _txPort);
+  ssize_t sent = _fd >= 0 ? sendto(_fd, _tx.data(), _tx.size(), 0, (struct sockaddr *)&addr, sizeof(addr)) : -1;
+  _tx.clear();
+
+  return sent >= 0 ? 1 : 0;
+}
+
+int HostUDP::parsePacket() {
+  uint8_t buffer[1500];
+  struct sockaddr_in addr;
+  socklen_t len = sizeof(addr);
+  _rx.clear();
+  _rxIndex = 0;
+  ssize_t r = _fd >= 0 ? recvfrom(_fd, buffer, sizeof(buffer), MSG_DONTWAIT, (struct sockaddr *)&addr, &len) : -1;
+  if (r <= 0) {
+
+    return 0;
+  }
+  _rx.assign(buffer, buffer + r);
+  _remoteIp = IPAddress((uint32_t)addr.sin_addr.s_addr);
+  _remotePort = ntohs(addr.sin_port);
+
+  return r;
+}
+
+int HostUDP::read() {
+  return available() ? _rx[_rxIndex++] : -1;
+}
+
+int HostUDP::read(unsigned char *buffer, size_t len) {
+  size_t n = min(len, (size_t)available());
+  memcpy(buffer, _rx.data() + _rxIndex, n);
+  _rxIndex += n;
+
+  return n;
+}
+
+/*
+ * Host network
+ */
+
+namespace host {
+
+bool resolve(const char *name, IPAddress &ip) {
+  if (ip.fromString(name)) {
+
+    return true;
+  }
+  struct addrinfo hints, *result = nullptr;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_INET;
+  if (getaddrinfo(name, nullptr, &hints, &result) != 0 || !result) {
+
+    return false;
+  }
+  ip = IPAddress((uint32_t)((struct sockaddr_in *)result->ai_addr)->sin_addr.s_addr);
+  freeaddrinfo(result);
+
+  return true;
+}
+
+IPAddress getLocalIp() {
+  struct ifaddrs *list = nullptr;
+  IPAddress ip(127, 0, 0, 1);
+  if (getifaddrs(&list) == 0) {
+    for (struct ifaddrs *i = list; i; i = i->ifa_next) {
+      if (i->ifa_addr && i->ifa_addr->sa_family == AF_INET) {
+        IPAddress found((uint32_t)((struct sockaddr_in *)i->ifa_addr)->sin_addr.s_addr);
+        if (found[0] != 127) {
+          ip = found;
+          break;
+        }
+      }
+    }
+    freeifaddrs(list);
+  }
+
+  return ip;
+}
+
+} // namespace host
+
+/*
+ * Ethernet and WiFi interfaces
+ */
+
+EthernetClass Ethernet;
+WiFiClass WiFi;
+
+int EthernetClass::begin(uint8_t *mac, unsigned long timeout, unsigned long responseTimeout) {
+  (void)mac; (void)timeout; (void)responseTimeout;
+  _ip = host::getLocalIp();
+
+  return 1;
+}
+
+int EthernetClass::begin(uint8_t *mac, IPAddress ip, IPAddress dns, IPAddress gateway, IPAddress subnet, unsigned long timeout, unsigned long responseTimeout) {
+  (void)mac; (void)timeout; (void)responseTimeout;
+
+  // Host keeps its own address, static one is only reported
+  _ip = ip;
+  _dns = dns;
+  _gateway = gateway;
+  _subnet = subnet;
+
+  return 1;
+}
+
+int WiFiClass::begin(const char *ssid, const char *passphrase) {
+  (void)passphrase;
+  _ssid = ssid;
+  if (_ip == IPAddress()) {
+    _ip = host::getLocalIp();
+  }
+  _status = WL_CONNECTED;
+
+  return _status;
+}
+
+int WiFiClass::beginAP(const char *ssid, const char *passphrase) {
+  (void)passphrase;
+  _ssid = ssid;
+  if (_ip == IPAddress()) {
+    _ip = host::getLocalIp();
+  }
+  _status = WL_AP_LISTENING;
+
+  return _status;
+}
@@ -0,0 +1,135 @@
+/*
+ * OptaLinker
+ *
+ * Author: Jean-Christian Paul Denis
+ * Source: https://github.com/JcDenis/OptaLinker
+ *
+ * see README.md file
+ */
+
+#ifndef OPTALINKER_HOST_SOCKET_H
+#define OPTALINKER_HOST_SOCKET_H
+
+#include <Arduino.h>
+
+#include <memory>
+#include <vector>
+
+/**
+ * Network client, server and UDP on top of POSIX sockets.
+ *
+ * Used by both Ethernet and WiFi, host has only one network.
+ * Client copies share the same socket as mbed core clients do.
+ */
+class HostClient : public Client {
+
+public:
+  HostClient() {}
+  explicit HostClient(int fd);
+
+  int connect(IPAddress ip, uint16_t port) override;
+  int connect(const char *host, uint16_t port) override;
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t *buf, size_t size) override;
+  using Print::write;
+  int available() override;
+  int read() override;
+  int read(uint8_t *buf, size_t size) override;
+  int peek() override;
+  void flush() override {}
+  void stop() override;
+  uint8_t connected() override;
+  operator bool() override { return _socket && _socket->fd >= 0; }
+
+  IPAddress remoteIP();
+  uint16_t remotePort();
+  void setSocketTimeout(unsigned long timeout) { _timeout = timeout; }
+
+private:
+  struct Socket {
+    int fd;
+    Socket(int f) : fd(f) {}
+    ~Socket();
+  };
+
+  std::shared_ptr<Socket> _socket;
+  unsigned long _timeout = 5000;
+
+  int connect(const struct sockaddr *addr, unsigned int len);
+};
+
+class HostServer : public Server {
+
+public:
+  HostServer(uint16_t port = 80) : _port(port) {}
+
+  void begin() override;
+  void end();
+  size_t write(uint8_t c) override { (void)c; return 0; }
+  using Print::write;
+
+protected:
+  int acceptSocket();
+
+private:
+  struct Socket {
+    int fd;
+    Socket(int f) : fd(f) {}
+    ~Socket();
+  };
+
+  uint16_t _port;
+  std::shared_ptr<Socket> _socket;
+};
+
+class HostUDP : public UDP {
+
+public:
+  ~HostUDP() { stop(); }
+
+  uint8_t begin(uint16_t port) override;
+  void stop() override;
+  int beginPacket(IPAddress ip, uint16_t port) override;
+  int beginPacket(const char *host, uint16_t port) override;
+  int endPacket() override;
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t *buffer, size_t size) override;
+  using Print::write;
+  int parsePacket() override;
+  int available() override { return _rx.size() - _rxIndex; }
+  int read() override;
+  int read(unsigned char *buffer, size_t len) override;
+  int read(char *buffer, size_t len) override { return read((unsigned char *)buffer, len); }
+  int peek() override { return available() ? _rx[_rxIndex] : -1; }
+  void flush() override {}
+  IPAddress remoteIP() override { return _remoteIp; }
+  uint16_t remotePort() override { return _remotePort; }
+
+private:
+  int _fd = -1;
+  std::vector<uint8_t> _tx;
+  std::vector<uint8_t> _rx;
+  size_t _rxIndex = 0;
+  IPAddress _txIp;
+  uint16_t _txPort = 0;
+  IPAddress _remoteIp;
+  uint16_t _remotePort = 0;
+
+  int open();
+};
+
+namespace host {
+
+/**
+ * Resolve a host name to an IPv4 address.
+ */
+bool resolve(const char *name, IPAddress &ip);
+
+/**
+ * Get host first non loopback IPv4 address.
+ */
+IPAddress getLocalIp();
+
+} // namespace host
+
+#endif // #ifndef OPTALINKER_HOST_SOCKET_H
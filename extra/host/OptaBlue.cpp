@@ -0,0 +1,158 @@
+/*
+ * OptaLinker
+ *
+ * Author: Jean-Christian Paul Denis
+ * Source: https://github.com/JcDenis/OptaLinker
+ *
+ * see README.md file
+ */
+
+#include <OptaBlue.h>
+
+#include <atomic>
+
+Opta::Controller OptaController;
+
+namespace {
+
+struct HostExpansion {
+  uint8_t type = EXPANSION_NOT_VALID;
+  std::atomic<float> voltage[OPTA_DIGITAL_IN_NUM];
+  std::atomic<int> output[OPTA_DIGITAL_OUT_NUM];
+  int pending[OPTA_DIGITAL_OUT_NUM];
+  std::atomic<uint32_t> updates;
+};
+
+HostExpansion expansions[OPTA_CONTROLLER_MAX_EXPANSION_NUM];
+uint8_t expansionsNum = 0;
+Opta::Expansion handles[OPTA_CONTROLLER_MAX_EXPANSION_NUM];
+Opta::Expansion invalid;
+
+HostExpansion *find(uint8_t index, uint8_t type) {
+  return index < expansionsNum && expansions[index].type == type ? &expansions[index] : nullptr;
+}
+
+} // namespace
+
+namespace Opta {
+
+void Expansion::bind(Expansion &e, uint8_t type) {
+  _index = e.getIndex();
+  _type = e.getType() == type ? type : EXPANSION_NOT_VALID;
+}
+
+int DigitalExpansion::digitalRead(int pin, bool update) {
+  (void)update;
+
+  // Digital expansions inputs threshold
+  return pinVoltage(pin) > 5.0 ? HIGH : LOW;
+}
+
+float DigitalExpansion::pinVoltage(uint8_t pin, bool update) {
+  (void)update;
+  HostExpansion *e = find(_index, _type);
+
+  return e && pin < OPTA_DIGITAL_IN_NUM ? e->voltage[pin].load() : 0;
+}
+
+int DigitalExpansion::pinAnalog(uint8_t pin, bool update) {
+  return (int)(pinVoltage(pin, update) / 24.0 * 4095);
+}
+
+void DigitalExpansion::digitalWrite(int pin, int value, bool update) {
+  HostExpansion *e = find(_index, _type);
+  if (e && pin >= 0 && pin < OPTA_DIGITAL_OUT_NUM) {
+    e->pending[pin] = value ? HIGH : LOW;
+  }
+  if (update) {
+    updateDigitalOutputs();
+  }
+}
+
+void DigitalExpansion::updateDigitalOutputs() {
+  HostExpansion *e = find(_index, _type);
+  if (e) {
+    // one bus transaction for all outputs
+    for (uint8_t pin = 0; pin < OPTA_DIGITAL_OUT_NUM; pin++) {
+      e->output[pin] = e->pending[pin];
+    }
+    e->updates++;
+  }
+}
+
+float AnalogExpansion::pinVoltage(uint8_t ch, bool update) {
+  (void)update;
+  HostExpansion *e = find(_index, _type);
+
+  return e && ch < OA_AN_CHANNELS_NUM ? e->voltage[ch].load() : 0;
+}
+
+float AnalogExpansion::pinCurrent(uint8_t ch, bool update) {
+
+  // Simulated channel value is read as mA
+  return pinVoltage(ch, update);
+}
+
+float AnalogExpansion::getRtd(uint8_t ch) {
+  return pinVoltage(ch);
+}
+
+uint8_t Controller::getExpansionNum() {
+  return expansionsNum;
+}
+
+uint8_t Controller::getExpansionType(uint8_t i) {
+  return i < expansionsNum ? expansions[i].type : EXPANSION_NOT_VALID;
+}
+
+Expansion &Controller::getExpansion(uint8_t i) {
+  if (i >= expansionsNum) {
+
+    return invalid;
+  }
+  handles[i] = Expansion(i, expansions[i].type);
+
+  return handles[i];
+}
+
+} // namespace Opta
+
+namespace host {
+
+void setExpansions(const char *list) {
+  expansionsNum = 0;
+  while (list && *list && expansionsNum < OPTA_CONTROLLER_MAX_EXPANSION_NUM) {
+    size_t len = strcspn(list, ",");
+    uint8_t type = EXPANSION_NOT_VALID;
+    if (len == 4 && strncmp(list, "dmec", 4) == 0) {
+      type = EXPANSION_OPTA_DIGITAL_MEC;
+    } else if (len == 4 && strncmp(list, "dsts", 4) == 0) {
+      type = EXPANSION_OPTA_DIGITAL_STS;
+    } else if (len == 6 && strncmp(list, "analog", 6) == 0) {
+      type = EXPANSION_OPTA_ANALOG;
+    }
+    if (type != EXPANSION_NOT_VALID) {
+      expansions[expansionsNum++].type = type;
+    }
+    list += len;
+    if (*list == ',') {
+      list++;
+    }
+  }
+}
+
+void setExpansionVoltage(uint8_t expansion, uint8_t pin, float voltage) {
+  if (expansion < expansionsNum && pin < OPTA_DIGITAL_IN_NUM) {
+    expansions[expansion].voltage[pin] = voltage;
+  }
+}
+
+int getExpansionOutput(uint8_t expansion, uint8_t pin) {
+  return expansion < expansionsNum && pin < OPTA_DIGITAL_OUT_NUM ? expansions[expansion].output[pin].load() : LOW;
+}
+
+uint32_t getExpansionUpdates(uint8_t expansion) {
+  return expansion < expansionsNum ? expansions[expansion].updates.load() : 0;
+}
+
+} // namespace host
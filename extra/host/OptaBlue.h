@@ -0,0 +1,139 @@
+/*
+ * OptaLinker
+ *
+ * Author: Jean-Christian Paul Denis
+ * Source: https://github.com/JcDenis/OptaLinker
+ *
+ * see README.md file
+ */
+
+#ifndef OPTALINKER_HOST_OPTABLUE_H
+#define OPTALINKER_HOST_OPTABLUE_H
+
+/**
+ * Host simulation of Opta Blueprint expansions.
+ *
+ * Expansions are declared by host::setExpansions(),
+ * inputs voltages are set by host::setExpansionVoltage().
+ */
+
+#include <Arduino.h>
+
+#define OPTA_CONTROLLER_MAX_EXPANSION_NUM 5
+#define OPTA_DIGITAL_IN_NUM 16
+#define OPTA_DIGITAL_OUT_NUM 8
+#define OA_AN_CHANNELS_NUM 8
+
+#define EXPANSION_NOT_VALID 0
+#define EXPANSION_OPTA_DIGITAL_MEC 1
+#define EXPANSION_OPTA_DIGITAL_STS 2
+#define EXPANSION_OPTA_ANALOG 3
+
+namespace Opta {
+
+class Expansion {
+
+public:
+  Expansion() {}
+  Expansion(uint8_t index, uint8_t type) : _index(index), _type(type) {}
+
+  operator bool() { return _type != EXPANSION_NOT_VALID; }
+  uint8_t getIndex() { return _index; }
+  uint8_t getType() { return _type; }
+
+protected:
+  uint8_t _index = 255;
+  uint8_t _type = EXPANSION_NOT_VALID;
+
+  void bind(Expansion &e, uint8_t type);
+};
+
+class DigitalExpansion : public Expansion {
+
+public:
+  int digitalRead(int pin, bool update = false);
+  float pinVoltage(uint8_t pin, bool update = false);
+  int pinAnalog(uint8_t pin, bool update = false);
+  void updateDigitalInputs() {}
+  void updateAnalogInputs() {}
+  void digitalWrite(int pin, int value, bool update = false);
+  void updateDigitalOutputs();
+  void switchLedOn(uint8_t pin, bool update = true) { (void)pin; (void)update; }
+  void switchLedOff(uint8_t pin, bool update = true) { (void)pin; (void)update; }
+  void updateLeds() {}
+};
+
+class DigitalMechExpansion : public DigitalExpansion {
+
+public:
+  DigitalMechExpansion() {}
+  DigitalMechExpansion(Expansion &e) { bind(e, EXPANSION_OPTA_DIGITAL_MEC); }
+  DigitalMechExpansion &operator=(Expansion &e) { bind(e, EXPANSION_OPTA_DIGITAL_MEC); return *this; }
+};
+
+class DigitalStSolidExpansion : public DigitalExpansion {
+
+public:
+  DigitalStSolidExpansion() {}
+  DigitalStSolidExpansion(Expansion &e) { bind(e, EXPANSION_OPTA_DIGITAL_STS); }
+  DigitalStSolidExpansion &operator=(Expansion &e) { bind(e, EXPANSION_OPTA_DIGITAL_STS); return *this; }
+};
+
+class AnalogExpansion : public Expansion {
+
+public:
+  AnalogExpansion() {}
+  AnalogExpansion(Expansion &e) { bind(e, EXPANSION_OPTA_ANALOG); }
+  AnalogExpansion &operator=(Expansion &e) { bind(e, EXPANSION_OPTA_ANALOG); return *this; }
+
+  void beginChannelAsVoltageAdc(uint8_t ch) { (void)ch; }
+  void beginChannelAsCurrentAdc(uint8_t ch) { (void)ch; }
+  void beginChannelAsRtd(uint8_t ch, bool use_3_wires, float current_mA) { (void)ch; (void)use_3_wires; (void)current_mA; }
+  void beginChannelAsDigitalInput(uint8_t ch) { (void)ch; }
+  void updateAnalogInputs() {}
+  float pinVoltage(uint8_t ch, bool update = true);
+  float pinCurrent(uint8_t ch, bool update = true);
+  float getRtd(uint8_t ch);
+};
+
+class Controller {
+
+public:
+  void begin() {}
+  void update() {}
+  uint8_t getExpansionNum();
+  uint8_t getExpansionType(uint8_t i);
+  Expansion &getExpansion(uint8_t i);
+};
+
+} // namespace Opta
+
+using namespace Opta;
+
+extern Opta::Controller OptaController;
+
+namespace host {
+
+/**
+ * Declare attached expansions as comma separated list of "dmec", "dsts" and "analog".
+ */
+void setExpansions(const char *list);
+
+/**
+ * Set a simulated expansion input voltage, or analog channel value.
+ */
+void setExpansionVoltage(uint8_t expansion, uint8_t pin, float voltage);
+
+/**
+ * Get a simulated expansion output state.
+ */
+int getExpansionOutput(uint8_t expansion, uint8_t pin);
+
+/**
+ * Get number of outputs bus transactions of a simulated expansion.
+ */
+uint32_t getExpansionUpdates(uint8_t expansion);
+
+} // namespace host
+
+#endif // #ifndef OPTALINKER_HOST_OPTABLUE_H
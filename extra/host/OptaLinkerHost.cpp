@@ -0,0 +1,199 @@
+/*
+ * OptaLinker
+ *
+ * Author: Jean-Christian Paul Denis
+ * Source: https://github.com/JcDenis/OptaLinker
+ *
+ * see README.md file
+ */
+
+/**
+ * Host simulation of OptaLinker.
+ *
+ * Runs OptaLinker setup and loop unmodified on Linux and reports loop time.
+ * See README.md file, "Host simulation" section, to build it.
+ *
+ * Usage: optalinker_host [--expansions dmec,dsts] [--toggle ms] [--pulse hz] [--capture bits] [--report ms] [--loops n] [--max-p99 us]
+ *   --expansions = attached expansions, dmec, dsts or analog
+ *   --toggle     = toggle all inputs every ms, to simulate activity
+ *   --pulse      = square signal of hz on input I0.0, from its own thread as a pin would do
+ *   --capture    = board inputs in edge capture mode, as bits
+ *   --report     = print loop time statistics every ms, default 10000
+ *   --loops      = stop after n loops, default never
+ *   --max-p99    = with --loops, exit with error if 99th percentile of loop time is above us
+ */
+
+#include <OptaLinker.h>
+#include <OptaBlue.h>
+
+#include <thread>
+
+using namespace optalinker;
+
+namespace {
+
+/**
+ * Loop time histogram, 1us buckets up to 10ms then 1ms buckets up to 1s.
+ */
+constexpr uint32_t HistogramFine   = 10000;
+constexpr uint32_t HistogramCoarse = 1000;
+constexpr uint32_t HistogramSize   = HistogramFine + HistogramCoarse;
+
+struct LoopStats {
+  uint32_t histogram[HistogramSize];
+  uint64_t count;
+  uint64_t sum;
+  uint32_t fastest;
+  uint32_t slowest;
+
+  void reset() {
+    memset(histogram, 0, sizeof(histogram));
+    count = sum = 0;
+    fastest = UINT32_MAX;
+    slowest = 0;
+  }
+
+  void add(uint32_t us) {
+    uint32_t bucket = us < HistogramFine ? us : HistogramFine + min((us - HistogramFine) / 1000, HistogramCoarse - 1);
+    histogram[bucket]++;
+    count++;
+    sum += us;
+    if (us < fastest) fastest = us;
+    if (us > slowest) slowest = us;
+  }
+
+  uint32_t percentile(uint8_t p) {
+    uint64_t target = (count * p + 99) / 100, seen = 0;
+    for (uint32_t b = 0; b < HistogramSize; b++) {
+      seen += histogram[b];
+      if (seen >= target && seen > 0) {
+
+        return b < HistogramFine ? b : HistogramFine + (b - HistogramFine) * 1000;
+      }
+    }
+
+    return slowest;
+  }
+
+  void print(uint32_t elapsed) {
+    if (!count) {
+
+      return;
+    }
+    char line[160];
+    snprintf(line, sizeof(line), "Host: %llu loops in %lums, %llu loops/s, loop time us min %lu avg %llu p50 %lu p99 %lu max %lu",
+      (unsigned long long)count, (unsigned long)elapsed, (unsigned long long)(count * 1000 / max(elapsed, (uint32_t)1)),
+      (unsigned long)fastest, (unsigned long long)(sum / count), (unsigned long)percentile(50), (unsigned long)percentile(99), (unsigned long)slowest);
+    Serial.println(line);
+  }
+};
+
+LoopStats stats;
+
+void toggleInputs(uint8_t level) {
+  for (pin_size_t pin = A0; pin <= A7; pin++) {
+    host::setAnalog(pin, level ? 4095 : 0);
+  }
+  for (uint8_t e = 0; e < OptaController.getExpansionNum(); e++) {
+    for (uint8_t pin = 0; pin < OPTA_DIGITAL_IN_NUM; pin++) {
+      host::setExpansionVoltage(e, pin, level ? 24.0 : 0);
+    }
+  }
+}
+
+void pulse(uint32_t hz) {
+  auto half = std::chrono::microseconds(500000 / hz);
+  auto next = std::chrono::steady_clock::now();
+  for (uint8_t level = 1; ; level = !level) {
+    host::setDigital(A0, level);
+    next += half;
+    std::this_thread::sleep_until(next);
+  }
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  uint32_t toggle = 0, report = 10000, maxP99 = 0, hz = 0, capture = 0;
+  uint64_t loops = 0;
+
+  host::setArguments(argc, argv);
+  for (int a = 1; a < argc; a++) {
+    if (strcmp(argv[a], "--expansions") == 0 && a + 1 < argc) {
+      host::setExpansions(argv[++a]);
+    } else if (strcmp(argv[a], "--toggle") == 0 && a + 1 < argc) {
+      toggle = atol(argv[++a]);
+    } else if (strcmp(argv[a], "--pulse") == 0 && a + 1 < argc) {
+      hz = atol(argv[++a]);
+    } else if (strcmp(argv[a], "--capture") == 0 && a + 1 < argc) {
+      capture = strtol(argv[++a], nullptr, 0);
+    } else if (strcmp(argv[a], "--report") == 0 && a + 1 < argc) {
+      report = atol(argv[++a]);
+    } else if (strcmp(argv[a], "--loops") == 0 && a + 1 < argc) {
+      loops = atoll(argv[++a]);
+    } else if (strcmp(argv[a], "--max-p99") == 0 && a + 1 < argc) {
+      maxP99 = atol(argv[++a]);
+    } else {
+      printf("Usage: %s [--expansions dmec,dsts] [--toggle ms] [--pulse hz] [--capture bits] [--report ms] [--loops n] [--max-p99 us]\n", argv[0]);
+
+      return 2;
+    }
+  }
+
+  OptaLinker &linker = OptaLinker::getInstance();
+  for (uint8_t i = 0; i < 8; i++) {
+    if ((capture >> i) & 1) {
+      linker.io->setCapture(i, 1);
+    }
+  }
+  if (!linker.setup()) {
+    Serial.println("Host: library setup failed");
+
+    return 1;
+  }
+
+  if (hz > 0) {
+    std::thread(pulse, hz).detach();
+  }
+
+  // Run library loop in main thread to measure it
+  uint8_t level = 0;
+  uint32_t toggleLast = millis(), reportLast = millis();
+  uint64_t total = 0;
+  stats.reset();
+  while (!loops || total < loops) {
+    uint32_t start = micros();
+    uint8_t ret = linker.loop();
+    stats.add(micros() - start);
+    total++;
+
+    if (!ret) {
+      Serial.println("Host: library is stopped");
+
+      return 1;
+    }
+
+    uint32_t now = millis();
+    if (toggle && now - toggleLast >= toggle) {
+      toggleLast = now;
+      level = !level;
+      toggleInputs(level);
+    }
+    if (report && now - reportLast >= report && !loops) {
+      stats.print(now - reportLast);
+      stats.reset();
+      reportLast = now;
+    }
+
+    yield();
+  }
+
+  stats.print(millis() - reportLast);
+  if (maxP99 && stats.percentile(99) > maxP99) {
+    Serial.println(String("Host: loop time p99 above ") + maxP99 + "us");
+
+    return 1;
+  }
+
+  return 0;
+}
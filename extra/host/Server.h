@@ -0,0 +1,15 @@
+/*
+ * OptaLinker
+ *
+ * Author: Jean-Christian Paul Denis
+ * Source: https://github.com/JcDenis/OptaLinker
+ *
+ * see README.md file
+ */
+
+#ifndef OPTALINKER_HOST_SERVER_H
+#define OPTALINKER_HOST_SERVER_H
+
+#include <Arduino.h>
+
+#endif // #ifndef OPTALINKER_HOST_SERVER_H
@@ -0,0 +1,75 @@
+/*
+ * OptaLinker
+ *
+ * Author: Jean-Christian Paul Denis
+ * Source: https://github.com/JcDenis/OptaLinker
+ *
+ * see README.md file
+ */
+
+#ifndef OPTALINKER_HOST_WIFI_H
+#define OPTALINKER_HOST_WIFI_H
+
+#include <Arduino.h>
+#include "HostSocket.h"
+
+enum wl_status_t {
+  WL_NO_SHIELD = 255,
+  WL_NO_MODULE = WL_NO_SHIELD,
+  WL_IDLE_STATUS = 0,
+  WL_NO_SSID_AVAIL,
+  WL_SCAN_COMPLETED,
+  WL_CONNECTED,
+  WL_CONNECT_FAILED,
+  WL_CONNECTION_LOST,
+  WL_DISCONNECTED,
+  WL_AP_LISTENING,
+  WL_AP_CONNECTED,
+  WL_AP_FAILED
+};
+
+class WiFiClient : public HostClient {
+
+public:
+  WiFiClient() {}
+  explicit WiFiClient(int fd) : HostClient(fd) {}
+};
+
+class WiFiServer : public HostServer {
+
+public:
+  WiFiServer(uint16_t port = 80) : HostServer(port) {}
+
+  WiFiClient accept() { return WiFiClient(acceptSocket()); }
+  WiFiClient available() { return accept(); }
+};
+
+class WiFiUDP : public HostUDP {};
+
+/**
+ * WiFi interface, station and access point share host address.
+ */
+class WiFiClass {
+
+public:
+  int begin(const char *ssid, const char *passphrase);
+  int beginAP(const char *ssid, const char *passphrase);
+  void config(IPAddress ip) { _ip = ip; }
+  void config(IPAddress ip, IPAddress dns, IPAddress gateway, IPAddress subnet) { _ip = ip; (void)dns; (void)gateway; (void)subnet; }
+  void setTimeout(unsigned long timeout) { (void)timeout; }
+  void disconnect() { _status = WL_DISCONNECTED; }
+  void end() { _status = WL_IDLE_STATUS; }
+  uint8_t status() { return _status; }
+  IPAddress localIP() { return _ip; }
+  const char *SSID() { return _ssid.c_str(); }
+  int32_t RSSI() { return _status == WL_CONNECTED ? -50 : 0; }
+
+private:
+  uint8_t _status = WL_IDLE_STATUS;
+  IPAddress _ip;
+  String _ssid;
+};
+
+extern WiFiClass WiFi;
+
+#endif // #ifndef OPTALINKER_HOST_WIFI_H
@@ -0,0 +1,27 @@
+/*
+ * OptaLinker
+ *
+ * Author: Jean-Christian Paul Denis
+ * Source: https://github.com/JcDenis/OptaLinker
+ *
+ * see README.md file
+ */
+
+#ifndef OPTALINKER_HOST_KVSTORE_GLOBAL_API_H
+#define OPTALINKER_HOST_KVSTORE_GLOBAL_API_H
+
+#include <mbed.h>
+
+typedef mbed::KVStore::info_t kv_info_t;
+typedef struct _opaque_kv_key_iterator *kv_iterator_t;
+
+int kv_set(const char *full_name_key, const void *buffer, size_t size, uint32_t create_flags);
+int kv_get(const char *full_name_key, void *buffer, size_t buffer_size, size_t *actual_size);
+int kv_get_info(const char *full_name_key, kv_info_t *info);
+int kv_remove(const char *full_name_key);
+int kv_iterator_open(kv_iterator_t *it, const char *full_prefix);
+int kv_iterator_next(kv_iterator_t it, char *key, size_t key_size);
+int kv_iterator_close(kv_iterator_t it);
+int kv_reset(const char *kvstore_path);
+
+#endif // #ifndef OPTALINKER_HOST_KVSTORE_GLOBAL_API_H
@@ -0,0 +1,816 @@
+/*
+ * OptaLinker
+ *
+ * Author: Jean-Christian Paul Denis
+ * Source: https://github.com/JcDenis/OptaLinker
+ *
+ * see README.md file
+ */
+
+#include <Arduino.h>
+#include <mbed.h>
+#include <kvstore_global_api.h>
+#include <mbed_mktime.h>
+#include <mbedtls/base64.h>
+#include <opta_info.h>
+#include <wiced_resource.h>
+#include <Arduino_Portenta_OTA.h>
+#include <fwWifiCertificates.h>
+
+#include <string>
+#include <vector>
+
+#include <dirent.h>
+#include <dlfcn.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+/**
+ * Simulated QSPI flash size and sector size.
+ */
+constexpr mbed::bd_size_t HostFlashSize  = 16 * 1024 * 1024;
+constexpr mbed::bd_size_t HostFlashErase = 4096;
+
+/**
+ * Filesystems names, files opened in /name/ are redirected to host root.
+ */
+const char *const HostFileSystems[] = { "fs", "wlan", "user" };
+
+std::string hostPath(const char *name) {
+  std::string path = host::getRoot();
+  mkdir(path.c_str(), 0755);
+  if (name && name[0]) {
+    path += "/";
+    path += name;
+  }
+
+  return path;
+}
+
+/**
+ * Get host path of a device path, or device path if it is not on a filesystem.
+ */
+const char *mapPath(const char *path, char *buffer, size_t size) {
+  if (!path || path[0] != '/') {
+
+    return path;
+  }
+  for (const char *name : HostFileSystems) {
+    size_t len = strlen(name);
+    if (strncmp(path + 1, name, len) == 0 && path[len + 1] == '/') {
+      snprintf(buffer, size, "%s%s", host::getRoot(), path);
+
+      return buffer;
+    }
+  }
+
+  return path;
+}
+
+void removeTree(const std::string &path) {
+  DIR *dir = opendir(path.c_str());
+  if (dir) {
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != nullptr) {
+      if (strcmp(entry->d_name, ".") && strcmp(entry->d_name, "..")) {
+        removeTree(path + "/" + entry->d_name);
+      }
+    }
+    closedir(dir);
+    rmdir(path.c_str());
+  } else {
+    unlink(path.c_str());
+  }
+}
+
+/**
+ * QSPI flash stored in host root "flash.bin" file.
+ */
+class HostFlashBlockDevice : public mbed::BlockDevice {
+
+public:
+  int init() override {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_file) {
+
+      return mbed::BD_ERROR_OK;
+    }
+    std::string path = hostPath("flash.bin");
+    _file = fopen(path.c_str(), "r+b");
+    if (!_file) {
+      _file = fopen(path.c_str(), "w+b");
+      if (!_file) {
+
+        return mbed::BD_ERROR_DEVICE_ERROR;
+      }
+      std::vector<uint8_t> erased(HostFlashErase, 0xFF);
+      for (mbed::bd_addr_t a = 0; a < HostFlashSize; a += HostFlashErase) {
+        fwrite(erased.data(), 1, erased.size(), _file);
+      }
+      fflush(_file);
+    }
+
+    return mbed::BD_ERROR_OK;
+  }
+
+  int deinit() override {
+    return mbed::BD_ERROR_OK;
+  }
+
+  int sync() override {
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    return _file && fflush(_file) == 0 ? mbed::BD_ERROR_OK : mbed::BD_ERROR_DEVICE_ERROR;
+  }
+
+  int read(void *buffer, mbed::bd_addr_t addr, mbed::bd_size_t size) override {
+    if (init() != mbed::BD_ERROR_OK || addr + size > HostFlashSize) {
+
+      return mbed::BD_ERROR_DEVICE_ERROR;
+    }
+    std::lock_guard<std::mutex> lock(_mutex);
+    fseek(_file, addr, SEEK_SET);
+
+    return fread(buffer, 1, size, _file) == size ? mbed::BD_ERROR_OK : mbed::BD_ERROR_DEVICE_ERROR;
+  }
+
+  int program(const void *buffer, mbed::bd_addr_t addr, mbed::bd_size_t size) override {
+    if (init() != mbed::BD_ERROR_OK || addr + size > HostFlashSize) {
+
+      return mbed::BD_ERROR_DEVICE_ERROR;
+    }
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    // Programming only clears bits, like NOR flash
+    std::vector<uint8_t> data(size);
+    fseek(_file, addr, SEEK_SET);
+    if (fread(data.data(), 1, size, _file) != size) {
+
+      return mbed::BD_ERROR_DEVICE_ERROR;
+    }
+    for (mbed::bd_size_t i = 0; i < size; i++) {
+      data[i] &= ((const uint8_t *)buffer)[i];
+    }
+    fseek(_file, addr, SEEK_SET);
+
+    return fwrite(data.data(), 1, size, _file) == size ? mbed::BD_ERROR_OK : mbed::BD_ERROR_DEVICE_ERROR;
+  }
+
+  int erase(mbed::bd_addr_t addr, mbed::bd_size_t size) override {
+    if (init() != mbed::BD_ERROR_OK || addr % HostFlashErase || size % HostFlashErase || addr + size > HostFlashSize) {
+
+      return mbed::BD_ERROR_DEVICE_ERROR;
+    }
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::vector<uint8_t> erased(HostFlashErase, 0xFF);
+    fseek(_file, addr, SEEK_SET);
+    for (mbed::bd_size_t done = 0; done < size; done += HostFlashErase) {
+      if (fwrite(erased.data(), 1, erased.size(), _file) != erased.size()) {
+
+        return mbed::BD_ERROR_DEVICE_ERROR;
+      }
+    }
+
+    return mbed::BD_ERROR_OK;
+  }
+
+  mbed::bd_size_t get_read_size() const override { return 1; }
+  mbed::bd_size_t get_program_size() const override { return 1; }
+  mbed::bd_size_t get_erase_size() const override { return HostFlashErase; }
+  mbed::bd_size_t size() const override { return HostFlashSize; }
+  const char *get_type() const override { return "QSPIF"; }
+
+private:
+  FILE *_file = nullptr;
+  std::mutex _mutex;
+};
+
+/**
+ * MBR partition table.
+ */
+constexpr uint16_t MbrTable     = 446;
+constexpr uint16_t MbrEntry     = 16;
+constexpr uint16_t MbrSector    = 512;
+
+uint32_t get32(const uint8_t *p) {
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+void put32(uint8_t *p, uint32_t v) {
+  p[0] = v; p[1] = v >> 8; p[2] = v >> 16; p[3] = v >> 24;
+}
+
+std::string keyPath(const char *key) {
+  std::string path = hostPath("kv");
+  mkdir(path.c_str(), 0755);
+  path += "/";
+  for (const char *p = key; *p; p++) {
+    if (isalnum((unsigned char)*p) || *p == '_' || *p == '-' || *p == '.') {
+      path += *p;
+    } else {
+      char escaped[4];
+      snprintf(escaped, sizeof(escaped), "%%%02X", (unsigned char)*p);
+      path += escaped;
+    }
+  }
+
+  return path;
+}
+
+std::string keyName(const char *file) {
+  std::string key;
+  for (const char *p = file; *p; p++) {
+    unsigned int c;
+    if (*p == '%' && sscanf(p + 1, "%2X", &c) == 1) {
+      key += (char)c;
+      p += 2;
+    } else {
+      key += *p;
+    }
+  }
+
+  return key;
+}
+
+const char *keyStrip(const char *key) {
+  return strncmp(key, "/kv/", 4) == 0 ? key + 4 : key;
+}
+
+std::mutex keyMutex;
+
+} // namespace
+
+namespace mbed {
+
+/*
+ * Watchdog
+ */
+
+Watchdog &Watchdog::get_instance() {
+  static Watchdog instance;
+
+  return instance;
+}
+
+bool Watchdog::start(uint32_t timeout) {
+  const char *enabled = getenv("OPTALINKER_HOST_WATCHDOG");
+  if (enabled && strcmp(enabled, "0") == 0) {
+
+    return false;
+  }
+  _timeout = timeout;
+  _kicked = millis();
+  if (!_running) {
+    _running = true;
+    std::thread([this]() {
+      while (_running) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        if (_running && millis() - _kicked > _timeout) {
+          Serial.println("");
+          Serial.println("Host: watchdog timeout");
+          NVIC_SystemReset();
+        }
+      }
+    }).detach();
+  }
+
+  return true;
+}
+
+bool Watchdog::stop() {
+  _running = false;
+
+  return true;
+}
+
+void Watchdog::kick() {
+  _kicked = millis();
+}
+
+/*
+ * Block devices
+ */
+
+BlockDevice *BlockDevice::get_default_instance() {
+  static HostFlashBlockDevice instance;
+
+  return &instance;
+}
+
+int MBRBlockDevice::partition(BlockDevice *bd, int part, uint8_t type, bd_addr_t start) {
+  return partition(bd, part, type, start, bd->size());
+}
+
+int MBRBlockDevice::partition(BlockDevice *bd, int part, uint8_t type, bd_addr_t start, bd_addr_t stop) {
+  if (part < 1 || part > 4) {
+
+    return BD_ERROR_DEVICE_ERROR;
+  }
+
+  // Negative addresses are relative to device end
+  if ((int64_t)start < 0) {
+    start += bd->size();
+  }
+  if ((int64_t)stop < 0) {
+    stop += bd->size();
+  }
+
+  // First sector holds MBR
+  if (start < bd->get_erase_size()) {
+    start = bd->get_erase_size();
+  }
+  if (stop <= start || stop > bd->size()) {
+
+    return BD_ERROR_DEVICE_ERROR;
+  }
+
+  std::vector<uint8_t> sector(bd->get_erase_size());
+  if (bd->read(sector.data(), 0, sector.size()) != BD_ERROR_OK) {
+
+    return BD_ERROR_DEVICE_ERROR;
+  }
+  if (sector[510] != 0x55 || sector[511] != 0xAA) {
+    memset(sector.data(), 0, MbrSector);
+    sector[510] = 0x55;
+    sector[511] = 0xAA;
+  }
+  uint8_t *entry = &sector[MbrTable + (part - 1) * MbrEntry];
+  memset(entry, 0, MbrEntry);
+  entry[4] = type;
+  put32(entry + 8, start / MbrSector);
+  put32(entry + 12, (stop - start) / MbrSector);
+
+  if (bd->erase(0, sector.size()) != BD_ERROR_OK) {
+
+    return BD_ERROR_DEVICE_ERROR;
+  }
+
+  return bd->program(sector.data(), 0, sector.size());
+}
+
+int MBRBlockDevice::load() const {
+  uint8_t sector[MbrSector];
+  MBRBlockDevice *self = const_cast<MBRBlockDevice *>(this);
+  self->_start = self->_stop = self->_type = 0;
+  if (_part < 1 || _part > 4
+    || _bd->init() != BD_ERROR_OK
+    || _bd->read(sector, 0, MbrSector) != BD_ERROR_OK
+    || sector[510] != 0x55 || sector[511] != 0xAA
+  ) {
+
+    return BD_ERROR_DEVICE_ERROR;
+  }
+  const uint8_t *entry = &sector[MbrTable + (_part - 1) * MbrEntry];
+  self->_type = entry[4];
+  self->_start = (bd_addr_t)get32(entry + 8) * MbrSector;
+  self->_stop = self->_start + (bd_addr_t)get32(entry + 12) * MbrSector;
+
+  return _type ? BD_ERROR_OK : BD_ERROR_DEVICE_ERROR;
+}
+
+int MBRBlockDevice::init() {
+  return load();
+}
+
+int MBRBlockDevice::read(void *buffer, bd_addr_t addr, bd_size_t size) {
+  return addr + size <= this->size() ? _bd->read(buffer, _start + addr, size) : BD_ERROR_DEVICE_ERROR;
+}
+
+int MBRBlockDevice::program(const void *buffer, bd_addr_t addr, bd_size_t size) {
+  return addr + size <= this->size() ? _bd->program(buffer, _start + addr, size) : BD_ERROR_DEVICE_ERROR;
+}
+
+int MBRBlockDevice::erase(bd_addr_t addr, bd_size_t size) {
+  return addr + size <= this->size() ? _bd->erase(_start + addr, size) : BD_ERROR_DEVICE_ERROR;
+}
+
+bd_addr_t MBRBlockDevice::get_partition_start() const {
+  load();
+
+  return _start;
+}
+
+bd_addr_t MBRBlockDevice::get_partition_stop() const {
+  load();
+
+  return _stop;
+}
+
+uint8_t MBRBlockDevice::get_partition_type() const {
+  load();
+
+  return _type;
+}
+
+/*
+ * Filesystems
+ */
+
+int FileSystem::mount(BlockDevice *bd) {
+  struct stat st;
+  (void)bd;
+
+  return _name && stat(hostPath(_name).c_str(), &st) == 0 && S_ISDIR(st.st_mode) ? 0 : -19;
+}
+
+int FileSystem::unmount() {
+  return 0;
+}
+
+int FileSystem::reformat(BlockDevice *bd) {
+  (void)bd;
+  if (!_name) {
+
+    return -22;
+  }
+  std::string path = hostPath(_name);
+  removeTree(path);
+
+  return mkdir(path.c_str(), 0755) == 0 ? 0 : -5;
+}
+
+/*
+ * Key value store
+ */
+
+int KVStore::set(const char *key, const void *buffer, size_t size, uint32_t create_flags) {
+  (void)create_flags;
+  if (!key || !key[0]) {
+
+    return MBED_ERROR_INVALID_ARGUMENT;
+  }
+  std::lock_guard<std::mutex> lock(keyMutex);
+  std::string path = keyPath(key);
+  std::string temp = path + ".tmp";
+  FILE *file = fopen(temp.c_str(), "wb");
+  if (!file) {
+
+    return MBED_ERROR_FAILED_OPERATION;
+  }
+  size_t written = size ? fwrite(buffer, 1, size, file) : 0;
+  if (fclose(file) != 0 || written != size || rename(temp.c_str(), path.c_str()) != 0) {
+
+    return MBED_ERROR_FAILED_OPERATION;
+  }
+
+  return MBED_SUCCESS;
+}
+
+int KVStore::get(const char *key, void *buffer, size_t buffer_size, size_t *actual_size, size_t offset) {
+  std::lock_guard<std::mutex> lock(keyMutex);
+  FILE *file = fopen(keyPath(key).c_str(), "rb");
+  if (!file) {
+
+    return MBED_ERROR_ITEM_NOT_FOUND;
+  }
+  fseek(file, 0, SEEK_END);
+  long size = ftell(file);
+  if ((long)offset > size) {
+    fclose(file);
+
+    return MBED_ERROR_INVALID_SIZE;
+  }
+  fseek(file, offset, SEEK_SET);
+  size_t read = fread(buffer, 1, buffer_size, file);
+  fclose(file);
+  if (actual_size) {
+    *actual_size = read;
+  }
+
+  return MBED_SUCCESS;
+}
+
+int KVStore::get_info(const char *key, info_t *info) {
+  std::lock_guard<std::mutex> lock(keyMutex);
+  struct stat st;
+  if (stat(keyPath(key).c_str(), &st) != 0) {
+
+    return MBED_ERROR_ITEM_NOT_FOUND;
+  }
+  if (info) {
+    info->size = st.st_size;
+    info->flags = 0;
+  }
+
+  return MBED_SUCCESS;
+}
+
+int KVStore::remove(const char *key) {
+  std::lock_guard<std::mutex> lock(keyMutex);
+
+  return unlink(keyPath(key).c_str()) == 0 ? MBED_SUCCESS : MBED_ERROR_ITEM_NOT_FOUND;
+}
+
+KVMap &KVMap::get_instance() {
+  static KVMap instance;
+
+  return instance;
+}
+
+int KVMap::lookup(const char *full_name, KVStore **kv_instance, size_t *key_index, uint32_t *flags_mask) {
+  static KVStore store;
+  if (!full_name) {
+
+    return MBED_ERROR_INVALID_ARGUMENT;
+  }
+  *kv_instance = &store;
+  *key_index = keyStrip(full_name) - full_name;
+  if (flags_mask) {
+    *flags_mask = 0xFFFFFFFF;
+  }
+
+  return MBED_SUCCESS;
+}
+
+} // namespace mbed
+
+/*
+ * Key value store global API
+ */
+
+struct _opaque_kv_key_iterator {
+  std::vector<std::string> keys;
+  size_t index;
+};
+
+int kv_set(const char *full_name_key, const void *buffer, size_t size, uint32_t create_flags) {
+  mbed::KVStore *kv;
+  size_t index;
+  mbed::KVMap::get_instance().lookup(full_name_key, &kv, &index);
+
+  return kv->set(full_name_key + index, buffer, size, create_flags);
+}
+
+int kv_get(const char *full_name_key, void *buffer, size_t buffer_size, size_t *actual_size) {
+  mbed::KVStore *kv;
+  size_t index;
+  mbed::KVMap::get_instance().lookup(full_name_key, &kv, &index);
+
+  return kv->get(full_name_key + index, buffer, buffer_size, actual_size);
+}
+
+int kv_get_info(const char *full_name_key, kv_info_t *info) {
+  mbed::KVStore *kv;
+  size_t index;
+  mbed::KVMap::get_instance().lookup(full_name_key, &kv, &index);
+
+  return kv->get_info(full_name_key + index, info);
+}
+
+int kv_remove(const char *full_name_key) {
+  mbed::KVStore *kv;
+  size_t index;
+  mbed::KVMap::get_instance().lookup(full_name_key, &kv, &index);
+
+  return kv->remove(full_name_key + index);
+}
+
+int kv_iterator_open(kv_iterator_t *it, const char *full_prefix) {
+  const char *prefix = full_prefix ? keyStrip(full_prefix) : "";
+  std::lock_guard<std::mutex> lock(keyMutex);
+  DIR *dir = opendir(hostPath("kv").c_str());
+  *it = new _opaque_kv_key_iterator{ {}, 0 };
+  if (dir) {
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != nullptr) {
+      size_t len = strlen(entry->d_name);
+      if (entry->d_name[0] == '.' || (len > 4 && strcmp(entry->d_name + len - 4, ".tmp") == 0)) {
+        continue;
+      }
+      std::string key = keyName(entry->d_name);
+      if (key.compare(0, strlen(prefix), prefix) == 0) {
+        (*it)->keys.push_back(key);
+      }
+    }
+    closedir(dir);
+  }
+
+  return MBED_SUCCESS;
+}
+
+int kv_iterator_next(kv_iterator_t it, char *key, size_t key_size) {
+  if (!it || it->index >= it->keys.size()) {
+
+    return MBED_ERROR_ITEM_NOT_FOUND;
+  }
+  const std::string &next = it->keys[it->index++];
+  if (next.size() + 1 > key_size) {
+
+    return MBED_ERROR_INVALID_SIZE;
+  }
+  memcpy(key, next.c_str(), next.size() + 1);
+
+  return MBED_SUCCESS;
+}
+
+int kv_iterator_close(kv_iterator_t it) {
+  delete it;
+
+  return MBED_SUCCESS;
+}
+
+int kv_reset(const char *kvstore_path) {
+  (void)kvstore_path;
+  std::lock_guard<std::mutex> lock(keyMutex);
+  removeTree(hostPath("kv"));
+
+  return MBED_SUCCESS;
+}
+
+/*
+ * RTOS
+ */
+
+namespace rtos {
+
+osStatus Thread::start(mbed::Callback<void()> task) {
+  if (_started) {
+
+    return osErrorResource;
+  }
+  _started = true;
+  std::thread([task]() { task(); }).detach();
+
+  return osOK;
+}
+
+void Semaphore::acquire() {
+  std::unique_lock<std::mutex> lock(_mutex);
+  _cv.wait(lock, [this]() { return _count > 0; });
+  _count--;
+}
+
+bool Semaphore::try_acquire() {
+  std::lock_guard<std::mutex> lock(_mutex);
+  if (_count <= 0) {
+
+    return false;
+  }
+  _count--;
+
+  return true;
+}
+
+bool Semaphore::try_acquire_for(uint32_t millisec) {
+  std::unique_lock<std::mutex> lock(_mutex);
+  if (!_cv.wait_for(lock, std::chrono::milliseconds(millisec), [this]() { return _count > 0; })) {
+
+    return false;
+  }
+  _count--;
+
+  return true;
+}
+
+osStatus Semaphore::release() {
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_count >= _max) {
+
+      return osErrorResource;
+    }
+    _count++;
+  }
+  _cv.notify_one();
+
+  return osOK;
+}
+
+} // namespace rtos
+
+/*
+ * Time
+ */
+
+void set_time(time_t t) {
+  (void)t;
+}
+
+bool _rtc_localtime(time_t timestamp, struct tm *time_info, rtc_leap_year_support_t leap_year_support) {
+  (void)leap_year_support;
+
+  return gmtime_r(&timestamp, time_info) != nullptr;
+}
+
+bool _rtc_maketime(const struct tm *time_info, time_t *seconds, rtc_leap_year_support_t leap_year_support) {
+  (void)leap_year_support;
+  struct tm t = *time_info;
+  *seconds = timegm(&t);
+
+  return *seconds != (time_t)-1;
+}
+
+/*
+ * Base64
+ */
+
+namespace {
+
+const char Base64Chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+} // namespace
+
+int mbedtls_base64_encode(unsigned char *dst, size_t dlen, size_t *olen, const unsigned char *src, size_t slen) {
+  size_t needed = (slen + 2) / 3 * 4;
+  if (!dst || dlen < needed + 1) {
+    *olen = needed + 1;
+
+    return MBEDTLS_ERR_BASE64_BUFFER_TOO_SMALL;
+  }
+  unsigned char *p = dst;
+  for (size_t i = 0; i < slen; i += 3) {
+    uint32_t n = (uint32_t)src[i] << 16;
+    if (i + 1 < slen) n |= (uint32_t)src[i + 1] << 8;
+    if (i + 2 < slen) n |= src[i + 2];
+    *p++ = Base64Chars[(n >> 18) & 0x3F];
+    *p++ = Base64Chars[(n >> 12) & 0x3F];
+    *p++ = i + 1 < slen ? Base64Chars[(n >> 6) & 0x3F] : '=';
+    *p++ = i + 2 < slen ? Base64Chars[n & 0x3F] : '=';
+  }
+  *p = '\0';
+  *olen = p - dst;
+
+  return 0;
+}
+
+int mbedtls_base64_decode(unsigned char *dst, size_t dlen, size_t *olen, const unsigned char *src, size_t slen) {
+  uint32_t n = 0;
+  size_t count = 0, bits = 0;
+  for (size_t i = 0; i < slen; i++) {
+    if (src[i] == '=' || src[i] == '\r' || src[i] == '\n' || src[i] == ' ') {
+      continue;
+    }
+    const char *c = strchr(Base64Chars, src[i]);
+    if (!c || !src[i]) {
+
+      return MBEDTLS_ERR_BASE64_INVALID_CHARACTER;
+    }
+    n = (n << 6) | (c - Base64Chars);
+    bits += 6;
+    if (bits >= 8) {
+      bits -= 8;
+      if (dst && count < dlen) {
+        dst[count] = (n >> bits) & 0xFF;
+      }
+      count++;
+    }
+  }
+  *olen = count;
+
+  return !dst || count > dlen ? MBEDTLS_ERR_BASE64_BUFFER_TOO_SMALL : 0;
+}
+
+/*
+ * Board
+ */
+
+OptaBoardInfo *boardInfo() {
+  static OptaBoardInfo info;
+  const char *type = getenv("OPTALINKER_HOST_BOARD");
+  memset(&info, 0, sizeof(info));
+  info.magic = 0xB5;
+  info._board_functionalities.usb = 1;
+  info._board_functionalities.ethernet = 1;
+  info._board_functionalities.rs485 = !type || strcmp(type, "lite") != 0;
+  info._board_functionalities.wifi = !type || strcmp(type, "wifi") == 0;
+
+  return &info;
+}
+
+// Blank image of the size written to Wifi partition
+const unsigned char wifi_firmware_image_data[wifi_firmware_file_size] = {};
+
+Arduino_Portenta_OTA::Error Arduino_Portenta_OTA::update() {
+  Serial.println(String("Host: OTA firmware stored in ") + host::getRoot() + "/fs, it is not applied");
+
+  return Error::None;
+}
+
+void Arduino_Portenta_OTA::reset() {
+  Serial.println("Host: OTA reset skipped");
+}
+
+/*
+ * Files opened on device filesystems are redirected to host root directory.
+ *
+ * These override C library functions for the whole process.
+ */
+
+extern "C" FILE *fopen(const char *path, const char *mode) {
+  typedef FILE *(*fopen_t)(const char *, const char *);
+  static fopen_t real = (fopen_t)dlsym(RTLD_NEXT, "fopen");
+  char buffer[PATH_MAX];
+
+  return real(mapPath(path, buffer, sizeof(buffer)), mode);
+}
+
+extern "C" int remove(const char *path) __THROW {
+  typedef int (*remove_t)(const char *);
+  static remove_t real = (remove_t)dlsym(RTLD_NEXT, "remove");
+  char buffer[PATH_MAX];
+
+  return real(mapPath(path, buffer, sizeof(buffer)));
+}
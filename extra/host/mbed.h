@@ -0,0 +1,405 @@
+/*
+ * OptaLinker
+ *
+ * Author: Jean-Christian Paul Denis
+ * Source: https://github.com/JcDenis/OptaLinker
+ *
+ * see README.md file
+ */
+
+#ifndef OPTALINKER_HOST_MBED_H
+#define OPTALINKER_HOST_MBED_H
+
+/**
+ * Host simulation of mbed OS API.
+ *
+ * RTOS objects use std threads, priorities are ignored.
+ * Flash memory is a file, filesystems are directories, keys are files,
+ * all of them in host root directory (see host::getRoot()).
+ */
+
+#include <Arduino.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+typedef enum {
+  osPriorityIdle         = 1,
+  osPriorityLow          = 8,
+  osPriorityBelowNormal  = 16,
+  osPriorityNormal       = 24,
+  osPriorityAboveNormal  = 32,
+  osPriorityHigh         = 40,
+  osPriorityRealtime     = 48
+} osPriority_t;
+
+typedef int32_t osStatus;
+#define osOK 0
+#define osErrorResource -3
+
+#define OS_STACK_SIZE 4096
+
+#define MBED_SUCCESS 0
+#define MBED_ERROR_ITEM_NOT_FOUND -311
+#define MBED_ERROR_INVALID_ARGUMENT -257
+#define MBED_ERROR_INVALID_SIZE -301
+#define MBED_ERROR_FAILED_OPERATION -315
+
+namespace mbed {
+
+/**
+ * Callback, a std::function accepting object and method pairs.
+ */
+template <typename F> class Callback;
+
+template <typename R, typename... A> class Callback<R(A...)> {
+
+public:
+  Callback() {}
+  Callback(std::nullptr_t) {}
+  Callback(R (*func)(A...)) { if (func) _func = func; }
+  template <typename T> Callback(T *obj, R (T::*method)(A...)) : _func([obj, method](A... args) { return (obj->*method)(args...); }) {}
+  template <typename T> Callback(const T *obj, R (T::*method)(A...) const) : _func([obj, method](A... args) { return (obj->*method)(args...); }) {}
+  template <typename L, typename = typename std::enable_if<!std::is_pointer<L>::value && !std::is_same<typename std::decay<L>::type, Callback>::value>::type>
+  Callback(L lambda) : _func(lambda) {}
+
+  R operator()(A... args) const { return _func(args...); }
+  R call(A... args) const { return _func(args...); }
+  explicit operator bool() const { return (bool)_func; }
+
+private:
+  std::function<R(A...)> _func;
+};
+
+template <typename R, typename... A> Callback<R(A...)> callback(R (*func)(A...)) {
+  return Callback<R(A...)>(func);
+}
+
+template <typename T, typename R, typename... A> Callback<R(A...)> callback(T *obj, R (T::*method)(A...)) {
+  return Callback<R(A...)>(obj, method);
+}
+
+template <typename T, typename R, typename... A> Callback<R(A...)> callback(const T *obj, R (T::*method)(A...) const) {
+  return Callback<R(A...)>(obj, method);
+}
+
+/**
+ * Watchdog, on expiry it prints a message and reboots like device does.
+ */
+class Watchdog {
+
+public:
+  static Watchdog &get_instance();
+
+  bool start(uint32_t timeout);
+  bool stop();
+  void kick();
+  uint32_t get_timeout() const { return _timeout; }
+  uint32_t get_max_timeout() const { return 32760; }
+  bool is_running() const { return _running; }
+
+private:
+  Watchdog() {}
+
+  volatile bool _running = false;
+  volatile uint32_t _timeout = 0;
+  volatile uint32_t _kicked = 0;
+};
+
+typedef uint64_t bd_addr_t;
+typedef uint64_t bd_size_t;
+
+enum {
+  BD_ERROR_OK = 0,
+  BD_ERROR_DEVICE_ERROR = -4001
+};
+
+/**
+ * Block device, default instance is the 16MB QSPI flash stored in a file.
+ */
+class BlockDevice {
+
+public:
+  virtual ~BlockDevice() {}
+
+  static BlockDevice *get_default_instance();
+
+  virtual int init() = 0;
+  virtual int deinit() = 0;
+  virtual int sync() { return BD_ERROR_OK; }
+  virtual int read(void *buffer, bd_addr_t addr, bd_size_t size) = 0;
+  virtual int program(const void *buffer, bd_addr_t addr, bd_size_t size) = 0;
+  virtual int erase(bd_addr_t addr, bd_size_t size) = 0;
+  virtual bd_size_t get_read_size() const = 0;
+  virtual bd_size_t get_program_size() const = 0;
+  virtual bd_size_t get_erase_size() const = 0;
+  virtual bd_size_t get_erase_size(bd_addr_t addr) const { (void)addr; return get_erase_size(); }
+  virtual int get_erase_value() const { return 0xFF; }
+  virtual bd_size_t size() const = 0;
+  virtual const char *get_type() const = 0;
+};
+
+/**
+ * MBR partition of a block device.
+ */
+class MBRBlockDevice : public BlockDevice {
+
+public:
+  MBRBlockDevice(BlockDevice *bd, int part) : _bd(bd), _part(part) {}
+
+  static int partition(BlockDevice *bd, int part, uint8_t type, bd_addr_t start);
+  static int partition(BlockDevice *bd, int part, uint8_t type, bd_addr_t start, bd_addr_t stop);
+
+  int init() override;
+  int deinit() override { return BD_ERROR_OK; }
+  int read(void *buffer, bd_addr_t addr, bd_size_t size) override;
+  int program(const void *buffer, bd_addr_t addr, bd_size_t size) override;
+  int erase(bd_addr_t addr, bd_size_t size) override;
+  bd_size_t get_read_size() const override { return _bd->get_read_size(); }
+  bd_size_t get_program_size() const override { return _bd->get_program_size(); }
+  bd_size_t get_erase_size() const override { return _bd->get_erase_size(); }
+  bd_size_t size() const override { return _stop - _start; }
+  const char *get_type() const override { return _bd->get_type(); }
+
+  bd_addr_t get_partition_start() const;
+  bd_addr_t get_partition_stop() const;
+  uint8_t get_partition_type() const;
+  int get_partition_number() const { return _part; }
+
+private:
+  BlockDevice *_bd;
+  int _part;
+  bd_addr_t _start = 0;
+  bd_addr_t _stop = 0;
+  uint8_t _type = 0;
+
+  int load() const;
+};
+
+/**
+ * Filesystem, mounted as a directory of host root named as filesystem.
+ *
+ * Files opened with a path beginning with /name/ are redirected to it.
+ */
+class FileSystem {
+
+public:
+  FileSystem(const char *name) : _name(name) {}
+  virtual ~FileSystem() {}
+
+  virtual int mount(BlockDevice *bd);
+  virtual int unmount();
+  virtual int reformat(BlockDevice *bd = nullptr);
+
+private:
+  const char *_name;
+};
+
+class FATFileSystem : public FileSystem {
+
+public:
+  FATFileSystem(const char *name = nullptr, BlockDevice *bd = nullptr) : FileSystem(name) { if (bd) mount(bd); }
+};
+
+class LittleFileSystem : public FileSystem {
+
+public:
+  LittleFileSystem(const char *name = nullptr, BlockDevice *bd = nullptr) : FileSystem(name) { if (bd) mount(bd); }
+};
+
+/**
+ * Software CRC.
+ */
+enum crc_polynomial {
+  POLY_7BIT_SD     = 0x09,
+  POLY_8BIT_CCITT  = 0x07,
+  POLY_16BIT_CCITT = 0x1021,
+  POLY_16BIT_IBM   = 0x8005,
+  POLY_32BIT_ANSI  = 0x04C11DB7
+};
+
+template <uint32_t polynomial = POLY_32BIT_ANSI, int width = 32> class MbedCRC {
+
+public:
+  MbedCRC() : MbedCRC(
+      polynomial == POLY_32BIT_ANSI || polynomial == POLY_16BIT_CCITT ? (uint32_t)(((uint64_t)1 << width) - 1) : 0,
+      polynomial == POLY_32BIT_ANSI ? (uint32_t)(((uint64_t)1 << width) - 1) : 0,
+      polynomial == POLY_32BIT_ANSI || polynomial == POLY_16BIT_IBM,
+      polynomial == POLY_32BIT_ANSI || polynomial == POLY_16BIT_IBM) {}
+
+  /**
+   * Like mbed, initial value is given in non reflected order, it is reflected into register for reflected data.
+   */
+  MbedCRC(uint32_t initial_xor, uint32_t final_xor, bool reflect_data, bool reflect_remainder)
+    : _initial(initial_xor), _final(final_xor), _reflectData(reflect_data), _reflectRemainder(reflect_remainder) {}
+
+  int32_t compute(const void *buffer, uint32_t size, uint32_t *crc) {
+    compute_partial_start(crc);
+    compute_partial(buffer, size, crc);
+
+    return compute_partial_stop(crc);
+  }
+
+  int32_t compute_partial_start(uint32_t *crc) {
+    *crc = (_reflectData ? reflect(_initial, width) : _initial) & mask();
+
+    return 0;
+  }
+
+  int32_t compute_partial(const void *buffer, uint32_t size, uint32_t *crc) {
+    const uint8_t *data = (const uint8_t *)buffer;
+    uint32_t r = *crc;
+    if (_reflectData) {
+      uint32_t poly = reflect(polynomial, width);
+      while (size--) {
+        r ^= *data++;
+        for (uint8_t b = 0; b < 8; b++) {
+          r = (r & 1) ? (r >> 1) ^ poly : r >> 1;
+        }
+      }
+    } else {
+      uint32_t top = (uint32_t)1 << (width - 1);
+      while (size--) {
+        r ^= width >= 8 ? (uint32_t)*data++ << (width - 8) : *data++ >> (8 - width);
+        for (uint8_t b = 0; b < 8; b++) {
+          r = (r & top) ? (r << 1) ^ polynomial : r << 1;
+        }
+        r &= mask();
+      }
+    }
+    *crc = r & mask();
+
+    return 0;
+  }
+
+  int32_t compute_partial_stop(uint32_t *crc) {
+    uint32_t r = *crc;
+    if (_reflectData != _reflectRemainder) {
+      r = reflect(r, width);
+    }
+    *crc = (r ^ _final) & mask();
+
+    return 0;
+  }
+
+private:
+  uint32_t _initial;
+  uint32_t _final;
+  bool _reflectData;
+  bool _reflectRemainder;
+
+  static uint32_t mask() { return (uint32_t)(((uint64_t)1 << width) - 1); }
+
+  static uint32_t reflect(uint32_t value, int bits) {
+    uint32_t r = 0;
+    for (int i = 0; i < bits; i++) {
+      if (value & ((uint32_t)1 << i)) {
+        r |= (uint32_t)1 << (bits - 1 - i);
+      }
+    }
+
+    return r;
+  }
+};
+
+/**
+ * Key value store, one file per key in host root "kv" directory.
+ */
+class KVStore {
+
+public:
+  typedef struct info {
+    size_t size;
+    uint32_t flags;
+  } info_t;
+
+  int set(const char *key, const void *buffer, size_t size, uint32_t create_flags);
+  int get(const char *key, void *buffer, size_t buffer_size, size_t *actual_size = NULL, size_t offset = 0);
+  int get_info(const char *key, info_t *info);
+  int remove(const char *key);
+};
+
+class KVMap {
+
+public:
+  static KVMap &get_instance();
+
+  int lookup(const char *full_name, KVStore **kv_instance, size_t *key_index, uint32_t *flags_mask = NULL);
+};
+
+} // namespace mbed
+
+namespace rtos {
+
+/**
+ * Thread, started detached as threads never end in OptaLinker.
+ */
+class Thread {
+
+public:
+  Thread(osPriority_t priority = osPriorityNormal, uint32_t stack_size = OS_STACK_SIZE, unsigned char *stack_mem = nullptr, const char *name = nullptr) {
+    (void)priority; (void)stack_size; (void)stack_mem; (void)name;
+  }
+
+  osStatus start(mbed::Callback<void()> task);
+
+private:
+  bool _started = false;
+};
+
+/**
+ * Recursive mutex, as rtos::Mutex is.
+ */
+class Mutex {
+
+public:
+  void lock() { _mutex.lock(); }
+  bool trylock() { return _mutex.try_lock(); }
+  void unlock() { _mutex.unlock(); }
+
+private:
+  std::recursive_mutex _mutex;
+};
+
+class Semaphore {
+
+public:
+  Semaphore(int32_t count = 0, uint16_t max_count = 0xFFFF) : _count(count), _max(max_count) {}
+
+  void acquire();
+  bool try_acquire();
+  bool try_acquire_for(uint32_t millisec);
+  template <class R, class P> bool try_acquire_for(std::chrono::duration<R, P> rel_time) {
+    return try_acquire_for((uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(rel_time).count());
+  }
+  osStatus release();
+
+private:
+  std::mutex _mutex;
+  std::condition_variable _cv;
+  int32_t _count;
+  uint16_t _max;
+};
+
+namespace ThisThread {
+
+inline void sleep_for(uint32_t millisec) { std::this_thread::sleep_for(std::chrono::milliseconds(millisec)); }
+template <class R, class P> void sleep_for(std::chrono::duration<R, P> rel_time) { std::this_thread::sleep_for(rel_time); }
+inline void yield() { std::this_thread::yield(); }
+
+} // namespace ThisThread
+
+} // namespace rtos
+
+using namespace mbed;
+using namespace std::chrono_literals;
+
+/**
+ * Real time clock is the host clock, it is not set.
+ */
+void set_time(time_t t);
+
+#endif // #ifndef OPTALINKER_HOST_MBED_H
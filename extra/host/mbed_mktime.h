@@ -0,0 +1,23 @@
+/*
+ * OptaLinker
+ *
+ * Author: Jean-Christian Paul Denis
+ * Source: https://github.com/JcDenis/OptaLinker
+ *
+ * see README.md file
+ */
+
+#ifndef OPTALINKER_HOST_MBED_MKTIME_H
+#define OPTALINKER_HOST_MBED_MKTIME_H
+
+#include <time.h>
+
+typedef enum {
+  RTC_FULL_LEAP_YEAR_SUPPORT,
+  RTC_4_YEAR_LEAP_YEAR_SUPPORT
+} rtc_leap_year_support_t;
+
+bool _rtc_localtime(time_t timestamp, struct tm *time_info, rtc_leap_year_support_t leap_year_support);
+bool _rtc_maketime(const struct tm *time_info, time_t *seconds, rtc_leap_year_support_t leap_year_support);
+
+#endif // #ifndef OPTALINKER_HOST_MBED_MKTIME_H
@@ -0,0 +1,38 @@
+/*
+ * OptaLinker
+ *
+ * Author: Jean-Christian Paul Denis
+ * Source: https://github.com/JcDenis/OptaLinker
+ *
+ * see README.md file
+ */
+
+#ifndef OPTALINKER_HOST_OPTA_INFO_H
+#define OPTALINKER_HOST_OPTA_INFO_H
+
+#include <stdint.h>
+
+/**
+ * Board information, host board has Wifi, RS485 and Ethernet.
+ */
+struct __attribute__((packed)) OptaBoardInfo {
+  uint8_t magic;
+  uint8_t version;
+  union {
+    uint16_t value;
+    struct {
+      uint8_t usb : 1;
+      uint8_t ethernet : 1;
+      uint8_t wifi : 1;
+      uint8_t rs485 : 1;
+    } _board_functionalities;
+  };
+  uint16_t revision;
+  uint8_t external_flash_size;
+  uint16_t vid;
+  uint16_t pid;
+  uint8_t mac_address[6];
+  uint8_t mac_address_2[6];
+};
+
+#endif // #ifndef OPTALINKER_HOST_OPTA_INFO_H
@@ -0,0 +1,20 @@
+/*
+ * OptaLinker
+ *
+ * Author: Jean-Christian Paul Denis
+ * Source: https://github.com/JcDenis/OptaLinker
+ *
+ * see README.md file
+ */
+
+#ifndef OPTALINKER_HOST_WICED_RESOURCE_H
+#define OPTALINKER_HOST_WICED_RESOURCE_H
+
+#include <stdint.h>
+
+/**
+ * Wifi module firmware, host one is a placeholder, its size comes from fwWifiCertificates.h
+ */
+extern const unsigned char wifi_firmware_image_data[];
+
+#endif // #ifndef OPTALINKER_HOST_WICED_RESOURCE_H
@@ -0,0 +1,324 @@
+/* Parallel OTA packager: cc -O2 -pthread -o bin2ota bin2ota.c */
+/* Compress, add OTA header and CRC32 to many .bin files, then check each result by decompressing it */
+
+#include <pthread.h>
+#include <time.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#define LZSS_LOCAL _Thread_local
+#include "lzss.c"
+
+#define HEADER 20  /* length, crc, magic, version */
+#define CHUNK (1 << 16)
+#define MAX_BOARDS 16
+
+struct board {
+    char const * name;
+    unsigned long magic;
+};
+
+/* Same list as bin2ota.py */
+struct board const boards[] = {
+    { "MKR_WIFI_1010", 0x23418054 },
+    { "NANO_33_IOT", 0x23418057 },
+    { "PORTENTA_H7_M7", 0x2341025B },
+    { "NANO_RP2040_CONNECT", 0x2341005E },
+    { "NICLA_VISION", 0x2341025F },
+    { "OPTA", 0x23410064 },
+    { "GIGA", 0x23410266 },
+    { "NANO_ESP32", 0x23410070 },
+    { "ESP32", 0x45535033 },
+    { "UNOR4WIFI", 0x23411002 },
+    { "PORTENTA_C33", 0x23410068 },
+};
+
+struct job {
+    char const * bin;
+    struct board const * board;
+    char ota[1024];
+    unsigned long text, code;
+    int ok;
+};
+
+struct job *jobs;
+int job_count = 0, job_next = 0;
+int delta = 0, verify = 1;
+pthread_mutex_t job_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+unsigned long crc_table[256];
+
+void crc_init(void)
+{
+    unsigned long c;
+    int i, k;
+
+    for (i = 0; i < 256; i++) {
+        c = i;
+        for (k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320UL ^ (c >> 1) : c >> 1;
+        crc_table[i] = c;
+    }
+}
+
+unsigned long crc_update(unsigned long crc, unsigned char const * data, size_t length)
+{
+    crc ^= 0xFFFFFFFFUL;
+    while (length--) crc = crc_table[(crc ^ *data++) & 0xFF] ^ (crc >> 8);
+    return crc ^ 0xFFFFFFFFUL;
+}
+
+void put32(unsigned char * p, unsigned long v)
+{
+    p[0] = v & 0xFF;  p[1] = (v >> 8) & 0xFF;  p[2] = (v >> 16) & 0xFF;  p[3] = (v >> 24) & 0xFF;
+}
+
+unsigned long get32(unsigned char const * p)
+{
+    return p[0] | (p[1] << 8) | ((unsigned long)p[2] << 16) | ((unsigned long)p[3] << 24);
+}
+
+/* CRC32 of file from offset to end, return bytes read */
+unsigned long crc_file(FILE * f, long offset, unsigned long * crc)
+{
+    unsigned char chunk[CHUNK];
+    unsigned long total = 0;
+    size_t n;
+
+    *crc = 0;
+    fseek(f, offset, SEEK_SET);
+    while ((n = fread(chunk, 1, CHUNK, f)) > 0) {
+        *crc = crc_update(*crc, chunk, n);
+        total += n;
+    }
+    return total;
+}
+
+/* Compress bin into ota after a blank header, then fill header */
+int pack(struct job * job)
+{
+    unsigned char header[HEADER];
+    unsigned long crc, length;
+
+    infile = fopen(job->bin, "rb");
+    if (infile == NULL) return 0;
+
+    outfile = fopen(job->ota, "w+b");
+    if (outfile == NULL) {
+        fclose(infile);
+        return 0;
+    }
+
+    setvbuf(infile, NULL, _IOFBF, IOBUF);
+    setvbuf(outfile, NULL, _IOFBF, IOBUF);
+    bit_buffer = 0;  bit_mask = 128;  codecount = 0;  textcount = 0;
+    lzss_lazy = 1;  lzss_chain = N;
+
+    /* Magic number and version, all 0 except compression and delta flags */
+    memset(header, 0, HEADER);
+    put32(header + 8, job->board->magic);
+    header[19] = 0x40 | (delta ? 0x20 : 0);
+    fwrite(header, 1, HEADER, outfile);
+
+    encode();
+    fflush(outfile);
+    job->text = textcount;
+    job->code = codecount;
+
+    /* CRC32 covers magic number, version and payload */
+    length = crc_file(outfile, 8, &crc);
+    put32(header, length);
+    put32(header + 4, crc);
+    fseek(outfile, 0, SEEK_SET);
+    fwrite(header, 1, HEADER, outfile);
+
+    fclose(infile);
+    if (fclose(outfile) != 0) return 0;
+
+    return 1;
+}
+
+/* Check ota header and CRC, decode payload and compare it with bin */
+int check(struct job * job)
+{
+    unsigned char header[HEADER], a[CHUNK], b[CHUNK];
+    unsigned long crc;
+    size_t na, nb;
+    FILE *bin;
+    int ret = 1;
+
+    infile = fopen(job->ota, "rb");
+    if (infile == NULL) return 0;
+
+    if (fread(header, 1, HEADER, infile) != HEADER
+     || get32(header + 8) != job->board->magic
+     || crc_file(infile, 8, &crc) != get32(header)
+     || crc != get32(header + 4)) {
+        fclose(infile);
+        return 0;
+    }
+
+    outfile = tmpfile();
+    if (outfile == NULL) {
+        fclose(infile);
+        return 0;
+    }
+    fseek(infile, HEADER, SEEK_SET);
+    decode();
+    fclose(infile);
+
+    bin = fopen(job->bin, "rb");
+    if (bin == NULL) ret = 0;
+    else {
+        rewind(outfile);
+        do {
+            na = fread(a, 1, CHUNK, outfile);
+            nb = fread(b, 1, CHUNK, bin);
+            if (na != nb || memcmp(a, b, na) != 0) {  ret = 0;  break;  }
+        } while (na > 0);
+        fclose(bin);
+    }
+    fclose(outfile);
+
+    return ret;
+}
+
+void * worker(void * arg)
+{
+    struct job *job;
+    int i;
+
+    (void)arg;
+    for (;;) {
+        pthread_mutex_lock(&job_mutex);
+        i = job_next++;
+        pthread_mutex_unlock(&job_mutex);
+        if (i >= job_count) break;
+
+        job = &jobs[i];
+        job->ok = pack(job) && (!verify || check(job));
+    }
+    return NULL;
+}
+
+int cpu_count(void)
+{
+#ifdef _WIN32
+    SYSTEM_INFO info;
+
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+
+    return n > 0 ? n : 1;
+#endif
+}
+
+struct board const * find_board(char const * name)
+{
+    size_t i;
+
+    for (i = 0; i < sizeof(boards) / sizeof(boards[0]); i++)
+        if (strcmp(boards[i].name, name) == 0) return &boards[i];
+    return NULL;
+}
+
+/* Output path: dir/name.ota, or dir/name.BOARD.ota when several boards are given, dir defaults to bin directory */
+void ota_path(struct job * job, char const * dir, int multi)
+{
+    char const *base = job->bin, *p;
+    int len;
+
+    for (p = job->bin; *p; p++)
+        if (*p == '/' || *p == '\\') base = p + 1;
+    len = strlen(base);
+    if (len > 4 && strcmp(base + len - 4, ".bin") == 0) len -= 4;
+
+    if (dir) snprintf(job->ota, sizeof(job->ota), "%s/%.*s", dir, len, base);
+    else snprintf(job->ota, sizeof(job->ota), "%.*s", (int)(base - job->bin) + len, job->bin);
+    if (multi) {
+        strncat(job->ota, ".", sizeof(job->ota) - strlen(job->ota) - 1);
+        strncat(job->ota, job->board->name, sizeof(job->ota) - strlen(job->ota) - 1);
+    }
+    strncat(job->ota, ".ota", sizeof(job->ota) - strlen(job->ota) - 1);
+}
+
+void usage(void)
+{
+    printf("Usage: bin2ota [-j jobs] [-o dir] [--delta] [--no-verify] BOARD[,BOARD...] sketch.bin [...]\n");
+    printf("  -j = number of parallel jobs, default number of cores\n");
+    printf("  -o = output directory, default next to each .bin\n");
+    printf("  --delta = .bin files are deltas made by bin2delta.py\n");
+    printf("  BOARD = [ MKR_WIFI_1010 | NANO_33_IOT | PORTENTA_H7_M7 | NANO_RP2040_CONNECT | NICLA_VISION | OPTA | GIGA | NANO_ESP32 | ESP32 | UNOR4WIFI | PORTENTA_C33 ]\n");
+    exit(1);
+}
+
+int main(int argc, char * argv[])
+{
+    struct board const *board_list[MAX_BOARDS];
+    char const *dir = NULL;
+    char names[256], *name;
+    int board_count = 0, threads = 0, failed = 0, i, j, a = 1;
+    pthread_t *pool;
+    struct timespec start, end;
+
+    for (; a < argc && argv[a][0] == '-'; a++) {
+        if (strcmp(argv[a], "-j") == 0 && a + 1 < argc) threads = atoi(argv[++a]);
+        else if (strcmp(argv[a], "-o") == 0 && a + 1 < argc) dir = argv[++a];
+        else if (strcmp(argv[a], "--delta") == 0) delta = 1;
+        else if (strcmp(argv[a], "--no-verify") == 0) verify = 0;
+        else usage();
+    }
+    if (argc - a < 2) usage();
+
+    snprintf(names, sizeof(names), "%s", argv[a++]);
+    for (name = strtok(names, ","); name != NULL; name = strtok(NULL, ",")) {
+        if (board_count == MAX_BOARDS) usage();
+        if ((board_list[board_count++] = find_board(name)) == NULL) {
+            printf("Error, %s is not a supported board type\n", name);
+            return 1;
+        }
+    }
+
+    jobs = calloc((argc - a) * board_count, sizeof(struct job));
+    if (jobs == NULL) return 1;
+    for (i = a; i < argc; i++) {
+        for (j = 0; j < board_count; j++) {
+            jobs[job_count].bin = argv[i];
+            jobs[job_count].board = board_list[j];
+            ota_path(&jobs[job_count], dir, board_count > 1);
+            job_count++;
+        }
+    }
+
+    if (threads <= 0) threads = cpu_count();
+    if (threads > job_count) threads = job_count;
+    pool = calloc(threads, sizeof(pthread_t));
+    if (pool == NULL) return 1;
+
+    crc_init();
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < threads; i++) pthread_create(&pool[i], NULL, worker, NULL);
+    for (i = 0; i < threads; i++) pthread_join(pool[i], NULL);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    for (i = 0; i < job_count; i++) {
+        if (jobs[i].ok) {
+            printf("%s: %ld -> %ld bytes (%ld%%)%s\n", jobs[i].ota, jobs[i].text, jobs[i].code + HEADER,
+                jobs[i].text ? (jobs[i].code * 100) / jobs[i].text : 0, verify ? ", verified" : "");
+        } else {
+            printf("%s: FAILED\n", jobs[i].ota);
+            failed++;
+        }
+    }
+    printf("%d files, %d failed, %d jobs, %.2f s\n", job_count, failed, threads,
+        (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9);
+
+    free(pool);
+    free(jobs);
+
+    return failed ? 1 : 0;
+}
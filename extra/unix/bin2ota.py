@@ -3,8 +3,9 @@
 import sys
 import crccheck
 
-if len(sys.argv) != 4:
-    print ("Usage: bin2ota.py BOARD sketch.bin sketch.ota")
+if len(sys.argv) != 4 and (len(sys.argv) != 5 or sys.argv[4] != "--delta"):
+    print ("Usage: bin2ota.py BOARD sketch.bin sketch.ota [--delta]")
+    print ("  --delta = sketch.bin is a compressed delta made by bin2delta.py")
     print ("  BOARD = [ MKR_WIFI_1010 | NANO_33_IOT | PORTENTA_H7_M7 | NANO_RP2040_CONNECT | NICLA_VISION | OPTA | GIGA | NANO_ESP32 | ESP32 | UNOR4WIFI]")
     sys.exit()
 
@@ -48,6 +49,10 @@ else:
 # Version field (byte array of size 8) - all 0 except the compression flag set.
 version = bytearray([0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x40])
 
+# Delta flag
+if len(sys.argv) == 5:
+    version[7] |= 0x20
+
 # Prepend magic number and version field to payload
 bin_data_complete = magic_number + version + bin_data
 
@@ -1,7 +1,9 @@
 /* LZSS encoder-decoder (Haruhiko Okumura; public domain) */
+/* Hash chain encoder with lazy matching, same output format */
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #define EI 11  /* typically 10..13 */
 #define EJ  4  /* typically 4..5 */
@@ -9,10 +11,28 @@
 #define N (1 << EI)  /* buffer size */
 #define F ((1 << EJ) + 1)  /* lookahead buffer size */
 
-int bit_buffer = 0, bit_mask = 128;
-unsigned long codecount = 0, textcount = 0;
-unsigned char buffer[N * 2];
-FILE *infile, *outfile;
+#define RING (1 << 16)  /* encoder input ring size, greater than N + F */
+#define MASK (RING - 1)
+#define NIL  0xFFFFFFFF
+#define IOBUF (1 << 16)  /* stdio buffers size */
+
+/* Codec state is global, a threaded includer defines this as _Thread_local */
+#ifndef LZSS_LOCAL
+#define LZSS_LOCAL
+#endif
+
+LZSS_LOCAL int bit_buffer = 0, bit_mask = 128;
+LZSS_LOCAL unsigned long codecount = 0, textcount = 0;
+LZSS_LOCAL unsigned char buffer[N * 2];
+LZSS_LOCAL FILE *infile, *outfile;
+
+/* Hash chain encoder state, positions are absolute from window start */
+LZSS_LOCAL unsigned char ring[RING];
+LZSS_LOCAL unsigned int head[1 << 16];
+LZSS_LOCAL unsigned int prev[RING];
+LZSS_LOCAL unsigned int ring_end = 0;
+LZSS_LOCAL int lzss_lazy = 1;
+LZSS_LOCAL int lzss_chain = N;
 
 void error(void)
 {
@@ -47,7 +67,7 @@ void flush_bit_buffer(void)
 void output1(int c)
 {
     int mask;
-    
+
     putbit1();
     mask = 256;
     while (mask >>= 1) {
@@ -59,7 +79,7 @@ void output1(int c)
 void output2(int x, int y)
 {
     int mask;
-    
+
     putbit0();
     mask = N;
     while (mask >>= 1) {
@@ -73,10 +93,11 @@ void output2(int x, int y)
     }
 }
 
-void encode(void)
+/* Brute force encoder, kept as reference for lzss_bench.c */
+void encode_reference(void)
 {
     int i, j, f1, x, y, r, s, bufferend, c;
-    
+
     for (i = 0; i < N - F; i++) buffer[i] = ' ';
     for (i = N - F; i < N * 2; i++) {
         if ((c = fgetc(infile)) == EOF) break;
@@ -107,16 +128,96 @@ void encode(void)
         }
     }
     flush_bit_buffer();
-    printf("text:  %ld bytes\n", textcount);
-    printf("code:  %ld bytes (%ld%%)\n",
-        codecount, (codecount * 100) / textcount);
+}
+
+/* Read input into ring, keeping the window before r */
+void fill_ring(unsigned int r)
+{
+    int c;
+
+    while (ring_end - (r - (N - F)) < RING - F) {
+        if ((c = getc(infile)) == EOF) break;
+        ring[ring_end++ & MASK] = c;  textcount++;
+    }
+}
+
+/* Add position p to hash chains, it needs 2 bytes */
+void insert(unsigned int p)
+{
+    unsigned int h;
+
+    if (p + 1 >= ring_end) return;
+    h = ring[p & MASK] | (ring[(p + 1) & MASK] << 8);
+    prev[p & MASK] = head[h];
+    head[h] = p;
+}
+
+/* Find longest match for position r in window, return its length */
+int find_match(unsigned int r, unsigned int *x)
+{
+    unsigned int cand, limit, h;
+    int j, f1, y, chain;
+
+    f1 = (F <= ring_end - r) ? F : ring_end - r;
+    if (f1 <= P) return 1;
+
+    limit = r - (N - F);
+    h = ring[r & MASK] | (ring[(r + 1) & MASK] << 8);
+    cand = head[h];
+    y = 1;  chain = lzss_chain;
+    while (cand != NIL && cand < r && cand >= limit && chain-- > 0) {
+        for (j = 2; j < f1; j++)
+            if (ring[(cand + j) & MASK] != ring[(r + j) & MASK]) break;
+        if (j > y) {
+            *x = cand;  y = j;
+            if (y == f1) break;
+        }
+        cand = prev[cand & MASK];
+    }
+    return y;
+}
+
+void encode(void)
+{
+    unsigned int i, r, x, x2;
+    int y, y2;
+
+    memset(head, 0xFF, sizeof(head));
+    for (i = 0; i < N - F; i++) ring[i] = ' ';
+    ring_end = N - F;
+    r = N - F;
+    fill_ring(r);
+    for (i = 0; i < r; i++) insert(i);
+
+    while (r < ring_end) {
+        y = find_match(r, &x);
+        insert(r);
+
+        /* Lazy matching, prefer a literal if next position has a longer match */
+        if (lzss_lazy && y > P && y < F) {
+            y2 = find_match(r + 1, &x2);
+            if (y2 > y) {
+                output1(ring[r & MASK]);
+                r++;
+                fill_ring(r);
+                continue;
+            }
+        }
+
+        if (y <= P) {  y = 1;  output1(ring[r & MASK]);  }
+        else output2(x & (N - 1), y - 2);
+        for (i = 1; i < (unsigned int)y; i++) insert(r + i);
+        r += y;
+        fill_ring(r);
+    }
+    flush_bit_buffer();
 }
 
 int getbit(int n) /* get n bits */
 {
     int i, x;
-    static int buf, mask = 0;
-    
+    static LZSS_LOCAL int buf, mask = 0;
+
     x = 0;
     for (i = 0; i < n; i++) {
         if (mask == 0) {
@@ -133,7 +234,7 @@ int getbit(int n) /* get n bits */
 void decode(void)
 {
     int i, j, k, r, c;
-    
+
     for (i = 0; i < N - F; i++) buffer[i] = ' ';
     r = N - F;
     while ((c = getbit(1)) != EOF) {
@@ -153,18 +254,62 @@ void decode(void)
     }
 }
 
-int encode_file(char const * in, char const * out)
+int open_files(char const * in, char const * out)
 {
     infile = fopen(in, "rb");
     if (infile == NULL) return 0;
 
     outfile = fopen(out, "wb");
-    if (outfile == NULL) return 0;
+    if (outfile == NULL) {
+        fclose(infile);
+        return 0;
+    }
 
-    encode();
+    setvbuf(infile, NULL, _IOFBF, IOBUF);
+    setvbuf(outfile, NULL, _IOFBF, IOBUF);
+    bit_buffer = 0;  bit_mask = 128;  codecount = 0;  textcount = 0;
+
+    return 1;
+}
 
+void close_files(void)
+{
     fclose(infile);
     fclose(outfile);
+}
+
+/* lazy: 0 or 1, chain: max candidates checked per position (N for all) */
+int encode_file_ex(char const * in, char const * out, int lazy, int chain)
+{
+    if (!open_files(in, out)) return 0;
+
+    lzss_lazy = lazy;
+    lzss_chain = chain;
+    encode();
+
+    close_files();
+
+    return 0;
+}
+
+int encode_file(char const * in, char const * out)
+{
+    encode_file_ex(in, out, 1, N);
+
+    printf("text:  %ld bytes\n", textcount);
+    printf("code:  %ld bytes (%ld%%)\n",
+        codecount, textcount ? (codecount * 100) / textcount : 0);
+
+    return 0;
+}
+
+int encode_file_reference(char const * in, char const * out)
+{
+    if (!open_files(in, out)) return 0;
+
+    encode_reference();
+
+    close_files();
 
     return 0;
 }
@@ -0,0 +1,427 @@
+/* Modbus TCP benchmark: cc -O2 -pthread -o modbus_bench modbus_bench.c (add -lws2_32 on Windows) */
+/* Drive a request mix from concurrent masters against a Modbus TCP server, report throughput and latency percentiles */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef SOCKET sock_t;
+#define BAD_SOCKET INVALID_SOCKET
+#define close_socket closesocket
+#else
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <signal.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+typedef int sock_t;
+#define BAD_SOCKET -1
+#define close_socket close
+#endif
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+#define MAX_MIX 16
+#define MAX_PDU 253
+#define MBAP 7  /* transaction, protocol, length, unit */
+
+struct request {
+    int fc, quantity, address;
+};
+
+/* Latency sample of one successful request */
+struct sample {
+    unsigned long us;
+    unsigned char fc;
+};
+
+struct master {
+    pthread_t thread;
+    int id;
+    struct sample *samples;
+    unsigned long count, size;
+    unsigned long exceptions, timeouts, reconnects, failures;
+};
+
+struct request mix[MAX_MIX];
+int mix_count = 0;
+char const *host = NULL;
+char const *port = "502";
+int unit = 1, timeout_ms = 1000, connections = 1;
+unsigned long per_master = 0;
+double duration = 10;
+struct timespec start;
+
+double now(void)
+{
+    struct timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (t.tv_sec - start.tv_sec) + (t.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+void pause_ms(int ms)
+{
+#ifdef _WIN32
+    Sleep(ms);
+#else
+    struct timespec t = { ms / 1000, (ms % 1000) * 1000000L };
+
+    nanosleep(&t, NULL);
+#endif
+}
+
+/* Default address of each function code: coils and discrete inputs from 0, registers from 10000, writes on empty register 10019 */
+int default_address(int fc)
+{
+    switch (fc) {
+        case 3: case 4: return 10000;
+        case 6: case 16: return 10019;
+        default: return 0;
+    }
+}
+
+int max_quantity(int fc)
+{
+    switch (fc) {
+        case 1: case 2: return 2000;
+        case 3: case 4: return 125;
+        case 15: return 1968;
+        case 16: return 123;
+        case 5: case 6: return 1;
+        default: return 0;
+    }
+}
+
+/* Parse mix as FC[xQUANTITY][@ADDRESS] comma separated list, like 3x10@10000,5@0 */
+int parse_mix(char const * list)
+{
+    char copy[512], *item, *p;
+    struct request *r;
+
+    snprintf(copy, sizeof(copy), "%s", list);
+    mix_count = 0;
+    for (item = strtok(copy, ","); item != NULL; item = strtok(NULL, ",")) {
+        if (mix_count == MAX_MIX) return 0;
+        r = &mix[mix_count++];
+        r->fc = strtol(item, &p, 10);
+        r->quantity = 1;
+        r->address = default_address(r->fc);
+        if (*p == 'x') r->quantity = strtol(p + 1, &p, 10);
+        if (*p == '@') r->address = strtol(p + 1, &p, 10);
+        if (*p != 0 || r->quantity < 1 || r->quantity > max_quantity(r->fc) || r->address < 0 || r->address + r->quantity > 65536) return 0;
+    }
+    return mix_count > 0;
+}
+
+void put16(unsigned char * p, int v)
+{
+    p[0] = (v >> 8) & 0xFF;  p[1] = v & 0xFF;
+}
+
+int get16(unsigned char const * p)
+{
+    return (p[0] << 8) | p[1];
+}
+
+/* Build ADU of request, return its length */
+int build(unsigned char * adu, struct request const * r, int transaction)
+{
+    unsigned char *pdu = adu + MBAP;
+    int len = 5, bytes;
+
+    pdu[0] = r->fc;
+    put16(pdu + 1, r->address);
+    switch (r->fc) {
+        case 5: case 6:
+            put16(pdu + 3, 0);  /* coil OFF, register 0 */
+            break;
+        case 15: case 16:
+            bytes = r->fc == 15 ? (r->quantity + 7) / 8 : r->quantity * 2;
+            put16(pdu + 3, r->quantity);
+            pdu[5] = bytes;
+            memset(pdu + 6, 0, bytes);
+            len = 6 + bytes;
+            break;
+        default:
+            put16(pdu + 3, r->quantity);
+    }
+    put16(adu, transaction);
+    put16(adu + 2, 0);
+    put16(adu + 4, len + 1);
+    adu[6] = unit;
+
+    return MBAP + len;
+}
+
+/* Expected response PDU length */
+int expected(struct request const * r)
+{
+    switch (r->fc) {
+        case 1: case 2: return 2 + (r->quantity + 7) / 8;
+        case 3: case 4: return 2 + r->quantity * 2;
+        default: return 5;
+    }
+}
+
+sock_t open_socket(void)
+{
+    struct addrinfo hints, *result, *a;
+    sock_t s = BAD_SOCKET;
+    int flag = 1;
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(host, port, &hints, &result) != 0) return BAD_SOCKET;
+    for (a = result; a != NULL; a = a->ai_next) {
+        s = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+        if (s == BAD_SOCKET) continue;
+        if (connect(s, a->ai_addr, a->ai_addrlen) == 0) break;
+        close_socket(s);
+        s = BAD_SOCKET;
+    }
+    freeaddrinfo(result);
+    if (s != BAD_SOCKET) setsockopt(s, IPPROTO_TCP, TCP_NODELAY, (char *)&flag, sizeof(flag));
+
+    return s;
+}
+
+/* Receive exactly len bytes before deadline, return 1 on success, 0 on timeout, -1 on disconnection */
+int receive(sock_t s, unsigned char * buf, int len, double deadline)
+{
+    struct timeval tv;
+    fd_set set;
+    double left;
+    int n;
+
+    while (len > 0) {
+        left = deadline - now();
+        if (left <= 0) return 0;
+        tv.tv_sec = (long)left;
+        tv.tv_usec = (long)((left - tv.tv_sec) * 1e6);
+        FD_ZERO(&set);
+        FD_SET(s, &set);
+        n = select(s + 1, &set, NULL, NULL, &tv);
+        if (n == 0) return 0;
+        if (n < 0) return -1;
+        n = recv(s, (char *)buf, len, 0);
+        if (n <= 0) return -1;
+        buf += n;
+        len -= n;
+    }
+    return 1;
+}
+
+void record(struct master * m, int fc, double latency)
+{
+    struct sample *grown;
+
+    if (m->count == m->size) {
+        m->size = m->size ? m->size * 2 : 4096;
+        grown = realloc(m->samples, m->size * sizeof(struct sample));
+        if (grown == NULL) {  m->size = m->count;  return;  }
+        m->samples = grown;
+    }
+    m->samples[m->count].us = (unsigned long)(latency * 1e6);
+    m->samples[m->count].fc = fc;
+    m->count++;
+}
+
+/* One master: send mix requests one after another on its own connection, reconnect when server drops it */
+void * master(void * arg)
+{
+    struct master *m = arg;
+    unsigned char request[MBAP + MAX_PDU], response[MBAP + MAX_PDU];
+    unsigned long sent = 0;
+    int transaction = 0, next = m->id % mix_count, refused = 0, len, ret;
+    struct request const *r;
+    sock_t s = BAD_SOCKET;
+    double begin;
+
+    while (per_master ? sent < per_master : now() < duration) {
+        if (s == BAD_SOCKET) {
+            s = open_socket();
+            if (s == BAD_SOCKET) {
+                m->failures++;
+                if (per_master && ++refused == 10) break;
+                pause_ms(100);
+                continue;
+            }
+            refused = 0;
+        }
+
+        r = &mix[next];
+        next = (next + 1) % mix_count;
+        transaction = (transaction + 1) & 0xFFFF;
+        len = build(request, r, transaction);
+        sent++;
+
+        begin = now();
+        if (send(s, (char *)request, len, MSG_NOSIGNAL) != len) ret = -1;
+        else ret = receive(s, response, MBAP, begin + timeout_ms / 1e3);
+        if (ret == 1) {
+            len = get16(response + 4) - 1;
+            if (get16(response) != transaction || len < 2 || len > MAX_PDU) ret = -1;
+            else ret = receive(s, response + MBAP, len, begin + timeout_ms / 1e3);
+        }
+
+        if (ret == 1 && response[MBAP] == (r->fc | 0x80)) m->exceptions++;
+        else if (ret == 1 && (response[MBAP] != r->fc || len != expected(r))) ret = -1;
+        else if (ret == 1) record(m, r->fc, now() - begin);
+        if (ret == 0) m->timeouts++;
+
+        /* Stream is out of sync after a timeout or a bad response */
+        if (ret != 1) {
+            close_socket(s);
+            s = BAD_SOCKET;
+            m->reconnects++;
+        }
+    }
+    if (s != BAD_SOCKET) close_socket(s);
+
+    return NULL;
+}
+
+int compare(void const * a, void const * b)
+{
+    unsigned long x = ((struct sample const *)a)->us, y = ((struct sample const *)b)->us;
+
+    return x < y ? -1 : x > y;
+}
+
+double percentile(struct sample const * sorted, unsigned long count, int p)
+{
+    unsigned long i = (count * p + 99) / 100;
+
+    return sorted[i ? i - 1 : 0].us / 1e3;
+}
+
+/* Print latency line of samples of one function code, or of all when fc is 0 */
+void report(struct sample * all, unsigned long total, int fc, double elapsed)
+{
+    struct sample *list = all;
+    unsigned long count = total, i;
+    double sum = 0;
+    char label[8];
+
+    if (fc) {
+        list = malloc(total * sizeof(struct sample));
+        if (list == NULL) return;
+        for (count = 0, i = 0; i < total; i++)
+            if (all[i].fc == fc) list[count++] = all[i];
+    }
+    if (count > 0) {
+        for (i = 0; i < count; i++) sum += list[i].us;
+        qsort(list, count, sizeof(struct sample), compare);
+        if (fc) snprintf(label, sizeof(label), "%d", fc);
+        else snprintf(label, sizeof(label), "all");
+        printf("%-4s %9lu %9.1f %8.2f %8.2f %8.2f %8.2f %8.2f %8.2f\n", label, count, count / elapsed,
+            list[0].us / 1e3, sum / count / 1e3, percentile(list, count, 50), percentile(list, count, 95),
+            percentile(list, count, 99), list[count - 1].us / 1e3);
+    }
+    if (fc) free(list);
+}
+
+void usage(void)
+{
+    printf("Usage: modbus_bench [-c connections] [-d seconds | -n requests] [-m mix] [-p port] [-u unit] [-t timeout] HOST\n");
+    printf("  -c = number of concurrent masters, each one on its own connection, default 1\n");
+    printf("  -d = test duration in seconds, default 10\n");
+    printf("  -n = number of requests per master, instead of duration\n");
+    printf("  -m = requests mix as FC[xQUANTITY][@ADDRESS],... sent in turn, default 3x10,4x10,1x16,2x16\n");
+    printf("       FC = 1, 2, 3, 4 (reads), 5, 6, 15, 16 (writes of 0, use with care on a running device)\n");
+    printf("  -p = server port, default 502\n");
+    printf("  -u = unit identifier, default 1\n");
+    printf("  -t = response timeout in milliseconds, default 1000\n");
+    exit(1);
+}
+
+int main(int argc, char * argv[])
+{
+    struct master *masters;
+    struct sample *all;
+    unsigned long total = 0, exceptions = 0, timeouts = 0, reconnects = 0, failures = 0;
+    int i, a = 1, seen[256] = { 0 };
+    double elapsed;
+
+    parse_mix("3x10,4x10,1x16,2x16");
+    for (; a < argc && argv[a][0] == '-'; a++) {
+        if (strcmp(argv[a], "-c") == 0 && a + 1 < argc) connections = atoi(argv[++a]);
+        else if (strcmp(argv[a], "-d") == 0 && a + 1 < argc) duration = atof(argv[++a]);
+        else if (strcmp(argv[a], "-n") == 0 && a + 1 < argc) per_master = strtoul(argv[++a], NULL, 10);
+        else if (strcmp(argv[a], "-m") == 0 && a + 1 < argc) {
+            if (!parse_mix(argv[++a])) {
+                printf("Error, invalid requests mix %s\n", argv[a]);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[a], "-p") == 0 && a + 1 < argc) port = argv[++a];
+        else if (strcmp(argv[a], "-u") == 0 && a + 1 < argc) unit = atoi(argv[++a]);
+        else if (strcmp(argv[a], "-t") == 0 && a + 1 < argc) timeout_ms = atoi(argv[++a]);
+        else usage();
+    }
+    if (argc - a != 1 || connections < 1 || duration <= 0 || timeout_ms < 1) usage();
+    host = argv[a];
+
+#ifdef _WIN32
+    WSADATA wsa;
+    WSAStartup(MAKEWORD(2, 2), &wsa);
+#else
+    signal(SIGPIPE, SIG_IGN);
+#endif
+
+    masters = calloc(connections, sizeof(struct master));
+    if (masters == NULL) return 1;
+
+    printf("Server %s:%s unit %d, %d masters, ", host, port, unit, connections);
+    if (per_master) printf("%lu requests each, mix", per_master);
+    else printf("%.1f s, mix", duration);
+    for (i = 0; i < mix_count; i++) printf("%s %dx%d@%d", i ? "," : "", mix[i].fc, mix[i].quantity, mix[i].address);
+    printf("\n");
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < connections; i++) {
+        masters[i].id = i;
+        pthread_create(&masters[i].thread, NULL, master, &masters[i]);
+    }
+    for (i = 0; i < connections; i++) pthread_join(masters[i].thread, NULL);
+    elapsed = now();
+
+    for (i = 0; i < connections; i++) total += masters[i].count;
+    all = malloc((total ? total : 1) * sizeof(struct sample));
+    if (all == NULL) return 1;
+    for (total = 0, i = 0; i < connections; i++) {
+        memcpy(all + total, masters[i].samples, masters[i].count * sizeof(struct sample));
+        total += masters[i].count;
+        exceptions += masters[i].exceptions;
+        timeouts += masters[i].timeouts;
+        reconnects += masters[i].reconnects;
+        failures += masters[i].failures;
+        free(masters[i].samples);
+    }
+
+    printf("%-4s %9s %9s %8s %8s %8s %8s %8s %8s\n", "FC", "requests", "req/s", "min ms", "avg ms", "p50 ms", "p95 ms", "p99 ms", "max ms");
+    for (i = 0; i < mix_count; i++) {
+        if (seen[mix[i].fc]++) continue;
+        report(all, total, mix[i].fc, elapsed);
+    }
+    report(all, total, 0, elapsed);
+    printf("%lu responses in %.2f s, %lu exceptions, %lu timeouts, %lu reconnections, %lu failed connections\n",
+        total, elapsed, exceptions, timeouts, reconnects, failures);
+
+    free(all);
+    free(masters);
+#ifdef _WIN32
+    WSACleanup();
+#endif
+
+    return total ? 0 : 1;
+}
@@ -0,0 +1,88 @@
+#!/usr/bin/env python3
+
+import sys
+import struct
+import zlib
+
+if len(sys.argv) != 4:
+    print ("Usage: bin2delta.py running.bin sketch.bin sketch.delta")
+    print ("  running.bin = firmware running on device, sketch.bin = new firmware")
+    print ("  Then: lzss.py --encode sketch.delta sketch.lzss && bin2ota.py OPTA sketch.lzss sketch.ota --delta")
+    sys.exit()
+
+old_file = sys.argv[1]
+new_file = sys.argv[2]
+ofile = sys.argv[3]
+
+# Delta format, see UpdateDeltaMagic in src/common.h
+DELTA_MAGIC = 0x50444C4F
+DELTA_COPY = 0x01
+DELTA_DATA = 0x02
+
+# Minimum match length worth a copy operation (9 bytes)
+MIN_MATCH = 12
+# Running firmware positions are indexed every STEP bytes, new firmware is searched at every byte
+KEY = 8
+STEP = 4
+
+in_file = open(old_file, "rb")
+old = bytes(in_file.read())
+in_file.close()
+
+in_file = open(new_file, "rb")
+new = bytes(in_file.read())
+in_file.close()
+
+# Index running firmware
+index = {}
+for i in range(0, len(old) - KEY + 1, STEP):
+    index.setdefault(old[i:i + KEY], i)
+
+out = bytearray(struct.pack("<IIIII", DELTA_MAGIC, len(old), zlib.crc32(old), len(new), zlib.crc32(new)))
+copied = 0
+literal = bytearray()
+
+def flush_literal():
+    global literal
+    if literal:
+        out.extend(struct.pack("<BI", DELTA_DATA, len(literal)))
+        out.extend(literal)
+        literal = bytearray()
+
+n = 0
+while n < len(new):
+    src = index.get(new[n:n + KEY]) if n + KEY <= len(new) else None
+    length = 0
+    if src is not None:
+        # Extend match forward
+        length = KEY
+        while n + length < len(new) and src + length < len(old) and new[n + length] == old[src + length]:
+            length += 1
+
+    if length >= MIN_MATCH:
+        # Extend match backward into pending literal
+        back = 0
+        while back < len(literal) and src - back > 0 and literal[-1 - back] == old[src - back - 1]:
+            back += 1
+        if back:
+            del literal[len(literal) - back:]
+            src -= back
+            length += back
+            n -= back
+
+        flush_literal()
+        out.extend(struct.pack("<BII", DELTA_COPY, src, length))
+        copied += length
+        n += length
+    else:
+        literal.append(new[n])
+        n += 1
+
+flush_literal()
+
+out_file = open(ofile, "wb")
+out_file.write(out)
+out_file.close()
+
+print ("new:   %d bytes" % len(new))
+print ("delta: %d bytes (%d%%), %d bytes copied from running firmware" % (len(out), (len(out) * 100) // max(len(new), 1), copied))
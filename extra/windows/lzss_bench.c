@@ -0,0 +1,74 @@
+/* LZSS encoders benchmark: cc -O2 -o lzss_bench lzss_bench.c && ./lzss_bench file.bin [...] */
+
+#include <time.h>
+
+#include "lzss.c"
+
+#define TMP_CODE "lzss_bench.lzss"
+#define TMP_TEXT "lzss_bench.out"
+
+double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Compare decoded file with original */
+int same_files(char const * a, char const * b)
+{
+    FILE *fa = fopen(a, "rb"), *fb = fopen(b, "rb");
+    int ca, cb, ret = 1;
+
+    if (fa == NULL || fb == NULL) ret = 0;
+    else {
+        do {
+            ca = fgetc(fa);  cb = fgetc(fb);
+            if (ca != cb) {  ret = 0;  break;  }
+        } while (ca != EOF);
+    }
+    if (fa) fclose(fa);
+    if (fb) fclose(fb);
+    return ret;
+}
+
+void run(char const * name, char const * file, int mode, int lazy, int chain)
+{
+    double start, duration;
+    int ok;
+
+    start = now();
+    if (mode) encode_file_ex(file, TMP_CODE, lazy, chain);
+    else encode_file_reference(file, TMP_CODE);
+    duration = now() - start;
+
+    decode_file(TMP_CODE, TMP_TEXT);
+    ok = same_files(file, TMP_TEXT);
+
+    printf("  %-22s %8ld -> %8ld bytes (%5.1f%%) %8.3f s %8.2f MB/s %s\n",
+        name, textcount, codecount, textcount ? codecount * 100.0 / textcount : 0,
+        duration, duration > 0 ? textcount / duration / 1e6 : 0, ok ? "OK" : "DECODE MISMATCH");
+}
+
+int main(int argc, char *argv[])
+{
+    int i;
+
+    if (argc < 2) {
+        printf("Usage: lzss_bench file.bin [...]\n");
+        return 1;
+    }
+
+    for (i = 1; i < argc; i++) {
+        printf("%s\n", argv[i]);
+        run("reference", argv[i], 0, 0, 0);
+        run("hash chain", argv[i], 1, 0, N);
+        run("hash chain lazy", argv[i], 1, 1, N);
+        run("hash chain lazy, 32", argv[i], 1, 1, 32);
+    }
+    remove(TMP_CODE);
+    remove(TMP_TEXT);
+
+    return 0;
+}
@@ -23,8 +23,10 @@
 #include "store.h"
 #include "config.h"
 #include "io.h"
+#include "rules.h"
 #include "network.h"
 #include "clock.h"
+#include "update.h"
 #include "rs485.h"
 #include "modbus.h"
 #include "mqtt.h"
@@ -55,7 +57,9 @@ public:
   OptaLinkerConfig *config;
   OptaLinkerNetwork *network;
   OptaLinkerClock *clock;
+  OptaLinkerUpdate *update;
   OptaLinkerIo *io;
+  OptaLinkerRules *rules;
   OptaLinkerRs485 *rs485;
   OptaLinkerModbus *modbus;
   OptaLinkerMqtt *mqtt;
@@ -87,6 +91,7 @@ public:
       || !store->setup()
       || !config->setup() // Even if disabled, we need to read #define
       || !io->setup()
+      || (rules->isEnabled() && !rules->setup())
       || !network->setup()
       || (clock->isEnabled() && !clock->setup())
       || (rs485->isEnabled() && !rs485->setup())
@@ -126,6 +131,7 @@ public:
       || !network->loop()
       || (clock->isEnabled() && !clock->loop())
       || !io->loop()
+      || (rules->isEnabled() && !rules->loop())
       || (rs485->isEnabled() && !rs485->loop())
       || (modbus->isEnabled() && !modbus->loop())
       || (mqtt->isEnabled() && !mqtt->loop())
@@ -136,6 +142,11 @@ public:
       return board->stop();
     }
 
+    // Apply configuration changes
+    if (config->isApply()) {
+      apply();
+    }
+
     // Move to main loop OTA state
     if (version->getOtaState() && (_otaLast == 0 || (state->getTime() - _otaLast > 10000))) { // 10s
       _otaLast = state->getTime();
@@ -160,6 +171,10 @@ public:
         monitor->setMessage(io->writeToJson());
       }
 
+      if (message.equals("print rules")) {
+        monitor->setMessage(rules->getRules());
+      }
+
       if (message.equals("print store")) {
         store->printKeys();
       }
@@ -179,13 +194,13 @@ public:
       if (message.equals("switch dhcp")) {
         config->setNetworkDhcp(config->getNetworkDhcp() ? false : true);
         config->writeToFile();
-        monitor->setMessage(LabelOptaLinkerApply, MonitorWarning);
+        config->setApply();
       }
 
       if (message.equals("switch wifi")) {
         config->setNetworkWifi(config->getNetworkWifi() ? false : true);
         config->writeToFile();
-        monitor->setMessage(LabelOptaLinkerApply, MonitorWarning);
+        config->setApply();
       }
 
       if (message.equals("print time")) {
@@ -253,6 +268,30 @@ public:
     return state->getType();
   }
 
+  /**
+   * Apply configuration changes.
+   *
+   * Modules apply their changes live, device reboots only if one of them can not.
+   */
+  void apply() {
+    uint16_t changes = config->getChanges();
+    config->resetChanges();
+
+    monitor->setMessage(LabelOptaLinkerApplyLive, MonitorAction);
+
+    if (!network->reconfigure(changes)
+      || !clock->reconfigure(changes)
+      || !rs485->reconfigure(changes)
+      || !modbus->reconfigure(changes)
+      || !mqtt->reconfigure(changes)
+      || !web->reconfigure(changes)
+    ) {
+      monitor->setMessage(LabelOptaLinkerApplyReboot, MonitorWarning);
+      io->writeToFile();
+      board->reboot();
+    }
+  }
+
   /**
    * Execute the OptaLinker library loop process in a dedicated thread.
    */
@@ -288,11 +327,13 @@ private:
     config   = new OptaLinkerConfig(*version, *monitor, *board, *store);
     network  = new OptaLinkerNetwork(*state, *monitor, *board, *config);
     clock    = new OptaLinkerClock(*state, *monitor, *board, *config, *network);
+    update   = new OptaLinkerUpdate(*monitor, *board, *network);
     io       = new OptaLinkerIo(*state, *monitor, *board, *store, *config);
+    rules    = new OptaLinkerRules(*state, *monitor, *store, *io);
     rs485    = new OptaLinkerRs485(*monitor, *board, *config);
     modbus   = new OptaLinkerModbus(*version, *state, *monitor, *board, *config, *network, *io, *rs485);
     mqtt     = new OptaLinkerMqtt(*version, *state, *monitor, *board, *config, *io, *network, *rs485);
-    web      = new OptaLinkerWeb(*version, *state, *monitor, *board, *config, *io, *network, *clock, *mqtt);
+    web      = new OptaLinkerWeb(*version, *state, *monitor, *board, *config, *io, *rules, *network, *clock, *mqtt);
   }
   //~OptaLinker();
 
@@ -316,10 +357,8 @@ private:
    * Execute OTA updater process in a dedicated thread.
    * 
    * Download and uncompress large OTA file take lots of time.
-   * Using OTA Watchdog callback has no effect on socket download.
    * So we use dedicated thread not to freeze main thread and loop.
-   *
-   * TODO: Best way to resolve this is to provide custom socket->download function with internal watchdog kicker...
+   * OTA file is uncompressed while downloading by update module, which kicks watchdog.
    * 
    * TODO: Manage fatal error on ota class because we can not do ota.begin() twice
    * see https://github.com/arduino-libraries/Arduino_Portenta_OTA/issues/55
@@ -368,36 +407,24 @@ private:
                 ol.monitor->setMessage(LabelUpdateBeginFail + String((int)otaError), MonitorWarning);
 
               } else {
-                // Bad way to check if we use ssl
-                bool ssl = strstr(otaUrl.c_str(), "https") != NULL;
-
-                // Download
+                // Download and uncompress
                 ol.monitor->setMessage(LabelUpdateDownload + otaUrl, MonitorInfo);
-                int const ota_download = aota.download(otaUrl.c_str(), ssl /* is_https */);
+                int const ota_download = ol.update->download(otaUrl);
                 if (ota_download <= 0) {
                   ol.monitor->setMessage(LabelUpdateDownloadFail + String(ota_download), MonitorWarning);
 
                 } else {
-                  ol.monitor->setMessage(String(ota_download) + " bytes stored.", MonitorInfo);
+                  ol.monitor->setMessage(LabelUpdateStored + String(ota_download), MonitorInfo);
 
-                  // Uncompress
-                  ol.monitor->setMessage(LabelUpdateUncompress, MonitorInfo);
-                  int const ota_decompress = aota.decompress();
-                  if (ota_decompress < 0) {
-                    ol.monitor->setMessage(LabelUpdateUncompressFail + String(ota_decompress), MonitorWarning);
+                  // Prepare bootloader
+                  ol.monitor->setMessage(LabelUpdateBootloader, MonitorInfo);
+                  if ((otaError = aota.update()) != Arduino_Portenta_OTA::Error::None) {
+                    ol.monitor->setMessage(LabelUpdateBootloaderFail + String((int)otaError), MonitorWarning);
                   } else {
-                    ol.monitor->setMessage(String(ota_decompress) + " bytes decompressed.", MonitorInfo);
-
-                    // Prepare bootloader
-                    ol.monitor->setMessage(LabelUpdateBootloader, MonitorInfo);
-                    if ((otaError = aota.update()) != Arduino_Portenta_OTA::Error::None) {
-                      ol.monitor->setMessage(LabelUpdateBootloaderFail + String((int)otaError), MonitorWarning);
-                    } else {
-                      ol.monitor->setMessage(LabelUpdateSuccess, MonitorStop);
-
-                      // Reboot
-                      aota.reset();
-                    }
+                    ol.monitor->setMessage(LabelUpdateSuccess, MonitorStop);
+
+                    // Reboot
+                    aota.reset();
                   }
                 }
               }
@@ -79,6 +79,20 @@ public:
     return 1;
   }
 
+  /**
+   * OptaLinker library module live reconfiguration.
+   *
+   * This is called in the main OptaLinker class after configuration changes.
+   *
+   * @param   changes   The changed configuration groups (ConfigChange flags)
+   *
+   * @return  1 if changes are applied (or not used), 0 if device must reboot
+   */
+  uint8_t reconfigure(uint16_t /* changes */) {
+
+    return 1;
+  }
+
   /**
    * Disable class features.
    *
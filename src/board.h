@@ -102,6 +102,13 @@ private:
    */
   uint16_t _freezeLevel = 0;
 
+  /**
+   * Reboot hold level.
+   *
+   * Number of pending operations that must end before reboot. (flash writes...)
+   */
+  volatile uint16_t _holdLevel = 0;
+
 public:
 	OptaLinkerBoard(OptaLinkerState &_state, OptaLinkerMonitor &_monitor) : state(_state), monitor(_monitor) {}
 
@@ -444,6 +451,22 @@ public:
     pingTimeout();
   }
 
+  /**
+   * Hold reboot until a pending operation ends.
+   */
+  void setHold() {
+    _holdLevel++;
+  }
+
+  /**
+   * Release reboot hold.
+   */
+  void unsetHold() {
+    if (_holdLevel > 0) {
+      _holdLevel--;
+    }
+  }
+
   /**
    * Stop execution.
    *
@@ -469,6 +492,13 @@ public:
     // Display reboot message
     monitor.setMessage(LabelBoardReboot, MonitorStop);
 
+    // Wait for pending operations, at most 10s
+    uint32_t holdStart = millis();
+    while (_holdLevel > 0 && millis() - holdStart < 10000) {
+      delay(10);
+      pingTimeout();
+    }
+
     // Blink LEDs
     uint8_t on = 1;
     for (int i = 0; i < 10; i++) {
@@ -90,6 +90,15 @@ public:
     return 1;
   }
 
+  uint8_t reconfigure(uint16_t changes) {
+    // NTP client reads time server and offset on each synchronization
+    if (changes & ConfigChangeTime) {
+      synchronizeRtc();
+    }
+
+    return 1;
+  }
+
   /**
    * Synchronize RTC using NTP.
    */
@@ -58,6 +58,62 @@ enum Rs485Type {
   Rs485Sender
 };
 
+/**
+ * RS485 received frames delimitation type.
+ */
+enum Rs485Framing {
+  Rs485FramingDelimiter = 0, // frame ends with a delimiter char
+  Rs485FramingIdle,          // frame ends after an idle gap
+  Rs485FramingLength,        // frame starts with its length as uint8
+  Rs485FramingBinary         // frame is a binary packet, see Rs485Packet
+};
+
+/**
+ * RS485 receiver frame.
+ */
+constexpr uint16_t Rs485FrameSize  = 256;
+constexpr uint8_t  Rs485FrameQueue = 8;
+
+struct Rs485Frame {
+  uint16_t length;
+  uint8_t source; // binary packet only
+  uint8_t type;   // binary packet only
+  uint8_t data[Rs485FrameSize];
+};
+
+/**
+ * RS485 binary packet.
+ *
+ * sync (2), destination (1), source (1), type (1), sequence (1), length (1), payload, CRC16 CCITT (2)
+ * CRC is computed from destination to end of payload.
+ */
+enum Rs485Packet {
+  Rs485PacketData = 0, // raw payload
+  Rs485PacketAck,      // acknowledge, sequence is the acknowledged one
+  Rs485PacketIo        // IO states, see OptaLinkerIo::writeToState()
+};
+
+constexpr uint8_t  Rs485PacketSync0       = 0xA5;
+constexpr uint8_t  Rs485PacketSync1       = 0x5A;
+constexpr uint8_t  Rs485PacketHeader      = 5;    // destination to length
+constexpr uint8_t  Rs485PacketPayload     = 240;
+constexpr uint8_t  Rs485PacketAckRequest  = 0x80; // type flag
+constexpr uint8_t  Rs485PacketBroadcast   = 0;
+constexpr uint8_t  Rs485PacketRetry       = 3;
+constexpr uint16_t Rs485PacketAckTimeout  = 50;   // ms, added to packet transmission time
+
+/**
+ * RS485 send queue size.
+ */
+constexpr uint8_t Rs485SendQueue = 8;
+
+/**
+ * RS485 to MQTT bridge batch payload size.
+ *
+ * Batch payload is a list of frames as: uint16 length, bytes.
+ */
+constexpr uint16_t MqttRs485Batch = 1024;
+
 /**
  * Modbus usage type.
  */
@@ -89,6 +145,21 @@ enum StateType {
   StateRun
 };
 
+/**
+ * Configuration changes groups, as bit flags.
+ */
+enum ConfigChange {
+  ConfigChangeNone     = 0,
+  ConfigChangeDeviceId = 1,
+  ConfigChangeDevice   = 2,  // user and password
+  ConfigChangeTime     = 4,
+  ConfigChangeRs485    = 8,
+  ConfigChangeModbus   = 16,
+  ConfigChangeNetwork  = 32,
+  ConfigChangeMqtt     = 64,
+  ConfigChangeUpdate   = 128
+};
+
 /**
  * Input/Output type.
  */
@@ -100,6 +171,35 @@ enum IoType {
   IoPwm
 };
 
+/**
+ * Input rate measurement mode.
+ */
+enum IoCapture {
+  IoCaptureNone = 0,
+  IoCapturePoll,  // edges seen on io poll
+  IoCaptureEdge,  // edges timestamped by pin interrupt
+  IoCaptureScan   // edges seen by board inputs scan
+};
+
+/**
+ * Analog expansion channel mode, and unit of its measure.
+ */
+enum IoAnalogMode {
+  IoAnalogVoltage = 0, // mV
+  IoAnalogCurrent,     // uA
+  IoAnalogRtd,         // 0.1 ohm, 3 wires
+  IoAnalogRtd2         // 0.1 ohm, 2 wires
+};
+
+/**
+ * Analog input filter.
+ */
+enum IoFilter {
+  IoFilterNone = 0,
+  IoFilterAverage, // moving average of depth samples
+  IoFilterIir      // first order low pass, new sample weights 1/depth
+};
+
 /**
  * Input/Ouput description field.
  */
@@ -113,7 +213,14 @@ enum IoField {
   IoFieldPulse,
   IoFieldPartialPulse,
   IoFieldHigh,
-  IoFieldPartialHigh
+  IoFieldPartialHigh,
+  IoFieldFrequency,
+  IoFieldPeriod,
+  IoFieldDuty,
+  IoFieldValue,
+  IoFieldThreshold,
+  IoFieldHysteresis,
+  IoFieldDebounce
 };
 
 /**
@@ -132,6 +239,71 @@ struct IoStruct {
   uint32_t partialPulse;
   uint32_t high;
   uint32_t partialHigh;
+  IoCapture capture;
+  uint32_t frequency; // mHz
+  uint32_t period;    // us
+  uint16_t duty;      // per mille
+  int32_t value;      // analog measure in engineering unit
+  uint16_t threshold;  // mV, low to high
+  uint16_t hysteresis; // mV, high to low at threshold - hysteresis
+  uint16_t debounce;   // ms, level stable time to change state
+};
+
+/**
+ * Input edges capture structure, written from pin interrupt.
+ */
+struct CaptureStruct {
+  uint32_t pin;
+  volatile uint8_t level;
+  volatile uint32_t edges;   // rising edges count
+  volatile uint32_t rise;    // last rising edge time, us
+  volatile uint32_t period;  // last rising to rising edge, us
+  volatile uint32_t width;   // last rising to falling edge, us
+  volatile uint32_t highUs;  // high time not yet added to counters, us
+  volatile uint32_t mark;    // high time added until this time, us
+  uint32_t counted;          // rising edges already added to counters
+  uint8_t bouncing;          // level differs from state, not yet stable
+  uint32_t bounce;           // level change time, us
+};
+
+constexpr uint32_t IoCaptureTimeout = 2000; // ms, rate falls to 0 without rising edge
+constexpr uint32_t IoCaptureRefresh = 1000; // ms, update time refresh of a running pulse train
+
+/**
+ * Board inputs scan, 12 bits ADC of 0~10V inputs.
+ */
+constexpr uint32_t IoScanMillivolt = 10000; // mV at full scale
+constexpr uint16_t IoScanFull      = 4095;
+
+/**
+ * Digital inputs state default thresholds, board is 0~10V, expansions are 0~24V.
+ */
+constexpr uint16_t IoThresholdBoard      = 6500;
+constexpr uint16_t IoHysteresisBoard     = 3000;
+constexpr uint16_t IoThresholdExpansion  = 16000;
+constexpr uint16_t IoHysteresisExpansion = 8000;
+
+/**
+ * Analog input filter and scale structure.
+ *
+ * Filter works on fixed point measures of IoFilterShift fractional bits.
+ * Scale maps measure rawMin~rawMax to value scaleMin~scaleMax, disabled if rawMin equals rawMax.
+ */
+constexpr uint8_t IoFilterDepth = 16; // max samples of filter
+constexpr uint8_t IoFilterShift = 8;
+
+struct AnalogStruct {
+  IoAnalogMode mode;
+  IoFilter filter;
+  uint8_t depth;                 // 1~IoFilterDepth samples
+  int32_t window[IoFilterDepth]; // moving average samples
+  int32_t sum;                   // moving average sum, or low pass output
+  uint8_t head;
+  uint8_t count;
+  int32_t rawMin;
+  int32_t rawMax;
+  int32_t scaleMin;
+  int32_t scaleMax;
 };
 
 /**
@@ -156,6 +328,280 @@ struct ExpansionStruct {
   IoStruct output[8];
 };
 
+/**
+ * Flash memory partitions layout: Wifi, OTA, KVStore, User.
+ *
+ * Partition 1 starts after the MBR sector.
+ */
+constexpr uint8_t  StorePartitionType     = 0x0B;
+constexpr uint32_t StorePartitionStart[4] = { 0, 1 * 1024 * 1024, 6 * 1024 * 1024, 7 * 1024 * 1024 };
+constexpr uint32_t StorePartitionStop[4]  = { 1 * 1024 * 1024, 6 * 1024 * 1024, 7 * 1024 * 1024, 14 * 1024 * 1024 };
+
+/**
+ * Binary records stored in flash memory.
+ *
+ * A record is a header followed by a payload:
+ * * uint32 : magic
+ * * uint16 : payload schema version
+ * * uint16 : payload length
+ * * uint32 : payload CRC32
+ */
+constexpr uint32_t StoreRecordMagic        = 0x43524C4F; // "OLRC"
+constexpr uint16_t StoreRecordHeaderLength = 12;
+
+/**
+ * Configuration binary record.
+ *
+ * Payload is a list of fields as: uint8 tag, uint8 length, value.
+ * Numbers are little endian. Unknown tags are skipped on read.
+ */
+constexpr uint16_t ConfigRecordSchema = 1;
+constexpr uint16_t ConfigRecordSize   = 512;
+
+/**
+ * Configuration binary record field tag.
+ *
+ * Tags MUST never change through firmware versions, only add new ones.
+ */
+enum ConfigTag {
+  ConfigTagNone = 0,
+  ConfigTagDeviceId,
+  ConfigTagDeviceUser,
+  ConfigTagDevicePassword,
+  ConfigTagTimeOffset,
+  ConfigTagTimeServer,
+  ConfigTagRs485Type,
+  ConfigTagRs485Baudrate,
+  ConfigTagRs485ToMqtt,
+  ConfigTagModbusType,
+  ConfigTagModbusIp,
+  ConfigTagModbusPort,
+  ConfigTagNetworkIp,
+  ConfigTagNetworkGateway,
+  ConfigTagNetworkSubnet,
+  ConfigTagNetworkDns,
+  ConfigTagNetworkDhcp,
+  ConfigTagNetworkWifi,
+  ConfigTagNetworkSsid,
+  ConfigTagNetworkPassword,
+  ConfigTagMqttIp,
+  ConfigTagMqttPort,
+  ConfigTagMqttUser,
+  ConfigTagMqttPassword,
+  ConfigTagMqttBase,
+  ConfigTagMqttInterval,
+  ConfigTagUpdateUrl
+};
+
+/**
+ * IO counters binary record.
+ *
+ * Payload is the number of expansions, the type of each expansion,
+ * then a list of entries as: uint16 io uid, uint8 field, uint32 value.
+ * Output entries have IoRecordOutput flag set on field.
+ */
+constexpr uint16_t IoRecordSchema      = 1;
+constexpr uint8_t  IoRecordOutput      = 0x80;
+constexpr uint16_t IoRecordEntryLength = 7;
+constexpr uint16_t IoRecordSize        = StoreRecordHeaderLength + 1 + 6 + (((6 * 24 * 5) + (6 * 16 * 3)) * IoRecordEntryLength);
+constexpr uint16_t IoRecordJournal     = 0xFFFF; // pseudo uid of the entry holding the first journal sequence to replay
+
+/**
+ * IO states compact message.
+ *
+ * One entry per existing expansion as: uint8 expansion index, uint16 inputs states bits, uint8 outputs states bits.
+ */
+constexpr uint8_t IoStateEntryLength = 4;
+constexpr uint8_t IoStateLength      = 6 * IoStateEntryLength;
+
+/**
+ * IO counters journal.
+ *
+ * Journal uses raw sectors of the unpartitioned flash memory space (14MB to 15.5MB).
+ * Sectors are used one after the other, a sector starts with a header
+ * as: uint32 magic, uint32 sequence; then a list of entries as:
+ * uint16 io uid, uint8 field, uint8 check, uint32 value.
+ * Sector of a sequence is always: sequence % number of sectors.
+ */
+constexpr uint32_t StoreJournalMagic        = 0x524A4C4F; // "OLJR"
+constexpr uint32_t StoreJournalAddress      = 14 * 1024 * 1024;
+constexpr uint32_t StoreJournalLength       = 1536 * 1024;
+constexpr uint16_t StoreJournalSectors      = 64;
+constexpr uint16_t StoreJournalHeaderLength = 8;
+constexpr uint16_t StoreJournalEntryLength  = 8;
+
+/**
+ * Flash read buffers pool.
+ *
+ * Larger contents use heap, they are released with their read handle.
+ */
+constexpr uint8_t  StorePoolSize       = 2;
+constexpr uint16_t StorePoolBufferSize = 1024;
+
+/**
+ * Flash write queue.
+ *
+ * Writes are done by a dedicated thread, a request replaces a pending one of the same key.
+ */
+constexpr uint8_t StoreQueueSize = 4;
+
+/**
+ * Flash write request state.
+ */
+enum StoreRequestState {
+  StoreRequestFree = 0,
+  StoreRequestPending,
+  StoreRequestWriting
+};
+
+/**
+ * Rules binary record.
+ *
+ * Payload is the rules source text, rules are compiled on read.
+ */
+constexpr uint16_t RulesRecordSchema = 1;
+constexpr uint16_t RulesSourceSize   = 512;
+constexpr uint16_t RulesRecordSize   = StoreRecordHeaderLength + RulesSourceSize;
+
+/**
+ * Rules bytecode.
+ *
+ * Rules are compiled to a stack machine of bits, evaluated on each inputs poll.
+ * Operands follow their operation, numbers are little endian:
+ * * io as uint8: expansion << 4 | io number
+ * * state as uint8: timer, latch or counter index
+ * * voltage as uint16 (mV), delay as uint32 (ms), preset as uint16
+ */
+constexpr uint16_t RulesCodeSize  = 512;
+constexpr uint8_t  RulesStackSize = 32;
+constexpr uint8_t  RulesStateNum  = 32;
+constexpr uint8_t  RulesMarkerNum = 16;
+
+enum RulesOp {
+  RulesOpEnd = 0,
+  RulesOpFalse,     // push 0
+  RulesOpTrue,      // push 1
+  RulesOpInput,     // io, push input state
+  RulesOpOutput,    // io, push output state
+  RulesOpMarker,    // marker, push marker
+  RulesOpAbove,     // io voltage, push input voltage > voltage
+  RulesOpBelow,     // io voltage, push input voltage < voltage
+  RulesOpNot,       // pop a, push !a
+  RulesOpAnd,       // pop a b, push a & b
+  RulesOpOr,        // pop a b, push a | b
+  RulesOpTimerOn,   // state delay, pop a, push a high for delay
+  RulesOpTimerOff,  // state delay, pop a, push a high or low for less than delay
+  RulesOpLatch,     // state, pop set reset, push latch, reset wins
+  RulesOpCounter,   // state preset, pop pulse reset, push rising edges count >= preset
+  RulesOpSetOutput, // io, pop a, set output
+  RulesOpSetMarker  // marker, pop a, set marker
+};
+
+/**
+ * Rules timer, latch or counter state.
+ */
+struct RulesStateStruct {
+  uint8_t value;  // last result
+  uint8_t last;   // last input, for edges
+  uint32_t since; // last input change time, ms
+  uint16_t count; // counter rising edges
+};
+
+/**
+ * OTA update file.
+ *
+ * Header is: uint32 length, uint32 CRC32, uint32 magic number, 8 bytes version.
+ * Length and CRC32 are computed from magic number to end of file.
+ * Payload is LZSS compressed if last version byte has UpdateCompressed flag, see extra/unix/lzss.c
+ * Payload is a delta of running firmware if last version byte has UpdateDelta flag, see extra/unix/bin2delta.py
+ */
+constexpr uint32_t UpdateMagic        = 0x23410064; // OPTA VID/PID
+constexpr uint8_t  UpdateHeaderLength = 20;
+constexpr uint8_t  UpdateCompressed   = 0x40;
+constexpr uint8_t  UpdateDelta        = 0x20;
+constexpr uint16_t UpdateWriteSize    = 512;
+constexpr char     UpdateFile[]       = "/fs/UPDATE.BIN";
+
+/**
+ * OTA file running CRC32 (zlib), 4 bits lookup table of reflected polynomial 0xEDB88320.
+ */
+constexpr uint32_t UpdateCrcTable[16] = {
+  0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+  0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+};
+
+constexpr uint8_t  UpdateLzssEI = 11;
+constexpr uint8_t  UpdateLzssEJ = 4;
+constexpr uint16_t UpdateLzssN  = 1 << UpdateLzssEI;
+constexpr uint8_t  UpdateLzssF  = (1 << UpdateLzssEJ) + 1;
+
+/**
+ * OTA delta payload.
+ *
+ * Header is: uint32 magic, uint32 running firmware length, uint32 running firmware CRC32,
+ * uint32 new firmware length, uint32 new firmware CRC32.
+ * Then a list of operations as:
+ * * UpdateDeltaCopy, uint32 running firmware offset, uint32 length : copy bytes from running firmware
+ * * UpdateDeltaData, uint32 length, bytes : copy bytes from payload
+ */
+constexpr uint32_t UpdateDeltaMagic        = 0x50444C4F; // "OLDP"
+constexpr uint8_t  UpdateDeltaHeaderLength = 20;
+constexpr uint8_t  UpdateDeltaCopy         = 0x01;
+constexpr uint8_t  UpdateDeltaData         = 0x02;
+constexpr uint32_t UpdateImageAddress      = 0x08040000; // M7 firmware start in internal flash
+constexpr uint32_t UpdateImageMax          = 0x001C0000;
+
+/**
+ * OTA delta patcher next expected field.
+ */
+enum UpdateDeltaState {
+  UpdateDeltaStateHeader = 0,
+  UpdateDeltaStateOperation,
+  UpdateDeltaStateCopy,
+  UpdateDeltaStateLength,
+  UpdateDeltaStateData
+};
+
+/**
+ * OTA LZSS decoder next expected code.
+ */
+enum UpdateLzssState {
+  UpdateLzssFlag = 0,
+  UpdateLzssLiteral,
+  UpdateLzssPosition,
+  UpdateLzssLength
+};
+
+/**
+ * OTA update errors.
+ */
+enum UpdateError {
+  UpdateErrorNone    = 0,
+  UpdateErrorUrl     = -1,
+  UpdateErrorConnect = -2,
+  UpdateErrorHttp    = -3,
+  UpdateErrorTimeout = -4,
+  UpdateErrorFile    = -5,
+  UpdateErrorMagic   = -6,
+  UpdateErrorLength  = -7,
+  UpdateErrorCrc     = -8,
+  UpdateErrorBroken  = -9,  // connection lost before end of file
+  UpdateErrorBase    = -10, // delta does not apply to running firmware
+  UpdateErrorDelta   = -11
+};
+
+/**
+ * OTA download resume state file.
+ *
+ * It is written every UpdateStateChunks chunks and on connection lost,
+ * download is resumed from it with an HTTP Range request.
+ */
+constexpr uint32_t UpdateStateMagic     = 0x4F4C5553; // "OLUS"
+constexpr uint8_t  UpdateStateChunks    = 64;
+constexpr uint16_t UpdateChunkMax       = 4096;
+constexpr uint32_t UpdateBackoffMax     = 300000; // ms
+constexpr char     UpdateStateFile[]    = "/fs/UPDATE.STATE";
+
 
 /**
  * Modbus InputRegisters and HoldingRegisters addresses and offset.
@@ -169,7 +615,7 @@ struct ExpansionStruct {
  */
 
 // Groups starting offset and length definition
-constexpr uint16_t ModbusRegisterAddress         = 10000; // 10011 to 10019 empty. This address MUST never change through firmware versions
+constexpr uint16_t ModbusRegisterAddress         = 10000; // 10014 to 10019 empty. This address MUST never change through firmware versions
 constexpr uint16_t ModbusRegisterFirmware        = 10020; // 10074 to 10079 empty
 constexpr uint16_t ModbusRegisterDevice          = 10080; // 10183 to 10189 empty
 constexpr uint16_t ModbusRegisterNetwork         = 10190; // 10308 to 10309 empty
@@ -178,10 +624,16 @@ constexpr uint16_t ModbusRegisterModbus          = 10320; // 10326 to 10329 empt
 constexpr uint16_t ModbusRegisterMqtt            = 10330; // 10487 to 10489 empty
 constexpr uint16_t ModbusRegisterExpansion       = 10490; // 10543, 10544, 10598, 10599, 10653, 10654, 10708, 10709, 10763, 10764, 10818, 10819 empty
 constexpr uint16_t ModbusRegisterInput           = 10820; // 10839, 10859, 10879, 10899, 10919, 10939, 10959, 10979, 10999, 11019, 11039, 11059, 11079, 11099, 11119, 11139 empty
-constexpr uint16_t ModbusRegisterOutput          = 11140; // 11159, 11179, 11199, 11219, 11239, 11259, 11279, 11299 empty. END 11300
+constexpr uint16_t ModbusRegisterOutput          = 11140; // 11159, 11179, 11199, 11219, 11239, 11259, 11279, 11299 empty
+constexpr uint16_t ModbusRegisterInputRate       = 11300; // 6 expansions of 16 inputs
+constexpr uint16_t ModbusRegisterInputValue      = 11780; // 6 expansions of 16 inputs
+constexpr uint16_t ModbusRegisterInputSettings   = 12068; // 6 expansions of 16 inputs. END 12356
 constexpr uint16_t ModbusRegisterExpansionLength = 55;
 constexpr uint16_t ModbusRegisterIoLength        = 20;
-constexpr uint16_t ModbusRegisterTotalLength     = 1300;
+constexpr uint16_t ModbusRegisterRateLength      = 5;
+constexpr uint16_t ModbusRegisterValueLength     = 3;
+constexpr uint16_t ModbusRegisterSettingsLength  = 3;
+constexpr uint16_t ModbusRegisterTotalLength     = 2356;
 
 // Offset starting at address ModbusRegisterAddress
 constexpr uint16_t ModbusRegisterAddressExpansionLength = 0;
@@ -195,7 +647,10 @@ constexpr uint16_t ModbusRegisterAddressNetwork         = 7;
 constexpr uint16_t ModbusRegisterAddressRs485           = 8;
 constexpr uint16_t ModbusRegisterAddressModbus          = 9;
 constexpr uint16_t ModbusRegisterAddressMqtt            = 10;
-// next 11
+constexpr uint16_t ModbusRegisterAddressInputRate       = 11;
+constexpr uint16_t ModbusRegisterAddressInputValue      = 12;
+constexpr uint16_t ModbusRegisterAddressInputSettings   = 13;
+// next 14
 
 // Offset starting at address ModbusRegisterFirmware
 constexpr uint16_t ModbusRegisterVersionMajor    = 0;  // T1
@@ -269,6 +724,21 @@ constexpr uint16_t ModbusRegisterIoPartialHigh  = 16; // T2
 constexpr uint16_t ModbusRegisterIoPartialReset = 18; // T1, value 0~1, for holding register only, Expension e input i reset partial counters
 // next 19
 
+// Offset starting at address ModbusRegisterInputRate + (((expansion number * 16) + input number) * ModbusRegisterRateLength)
+constexpr uint16_t ModbusRegisterRateFrequency = 0; // T2, mHz
+constexpr uint16_t ModbusRegisterRatePeriod    = 2; // T2, us
+constexpr uint16_t ModbusRegisterRateDuty      = 4; // T1, value 0~1000 per mille
+
+// Offset starting at address ModbusRegisterInputValue + (((expansion number * 16) + input number) * ModbusRegisterValueLength)
+constexpr uint16_t ModbusRegisterValueValue = 0; // T3, analog measure in engineering unit
+constexpr uint16_t ModbusRegisterValueMode  = 2; // T1, see IoAnalogMode
+
+// Offset starting at address ModbusRegisterInputSettings + (((expansion number * 16) + input number) * ModbusRegisterSettingsLength)
+constexpr uint16_t ModbusRegisterSettingsThreshold  = 0; // T1, mV
+constexpr uint16_t ModbusRegisterSettingsHysteresis = 1; // T1, mV
+constexpr uint16_t ModbusRegisterSettingsDebounce   = 2; // T1, ms
+// next 5
+
 
 /**
  * Serial monitor messages.
@@ -277,7 +747,8 @@ constexpr uint16_t ModbusRegisterIoPartialReset = 18; // T1, value 0~1, for hold
 // Main class
 constexpr char LabelOptaLinkerLoop[]             = "Setup completed";
 constexpr char LabelOptaLinkerThread[]           = "Starting threaded loop";
-constexpr char LabelOptaLinkerApply[]            = "You must reboot device";
+constexpr char LabelOptaLinkerApplyLive[]        = "Applying configuration changes";
+constexpr char LabelOptaLinkerApplyReboot[]      = "Configuration changes require to reboot device";
 constexpr char LabelOptaLinkerUpdate[]           = "Processing OTA update, this may take a while...";
 constexpr char LabelOptaLinkerBenchmarkStart[]   = "Getting loop time";
 constexpr char LabelOptaLinkerBenchmarkLine[]    = "Loops per second: ";
@@ -308,6 +779,7 @@ constexpr char LabelStoreReadFail[]        = "Failed to read stored file";
 constexpr char LabelStoreInitFail[]        = "QSPI initialization failed";
 constexpr char LabelStoreErase[]           = "Erasing partitions, please wait...";
 constexpr char LabelStoreExisting[]        = "Existing partition: ";
+constexpr char LabelStoreLayout[]          = "Existing partitions layout";
 constexpr char LabelStoreFormat[]          = "Formatting partition: ";
 constexpr char LabelStoreFormatFail[]      = "Error formatting partition: ";
 constexpr char LabelStoreFirmware[]        = "Flashing firmware";
@@ -316,6 +788,9 @@ constexpr char LabelStoreCertificate[]     = "Flashing certificate";
 constexpr char LabelStoreCertificateFail[] = "Error writing certificates";
 constexpr char LabelStorehMapped[]         = "Flashing memory mapped WiFi firmware";
 constexpr char LabelStoreMappedFail[]      = "Error writing memory mapped firmware";
+constexpr char LabelStoreJournal[]         = "Journal sequence: ";
+constexpr char LabelStoreJournalFail[]     = "Failed to open journal sector";
+constexpr char LabelStoreQueueFull[]       = "Flash write queue is full, rejected key: ";
 
 // Config
 constexpr char LabelConfigSetup[]              = "Configuring parameters";
@@ -326,6 +801,7 @@ constexpr char LabelConfigJsonReadFail[]       = "Failed to parse JSON";
 constexpr char LabelConfigJsonReadUncomplete[] = "Missing required keys in JSON";
 constexpr char LabelConfigDefaultRead[]        = "Loading default configuration";
 constexpr char LabelConfigFileWrite[]          = "Writing configuration to flash memory";
+constexpr char LabelConfigFileFull[]           = "Configuration does not fit in flash record";
 constexpr char LabelConfigFileRead[]           = "Reading configuration from flash memory";
 constexpr char LabelConfigFileFail[]           = "Configuration file not found";
 constexpr char LabelConfigSetDeviceId[]        = "Set device id to: ";
@@ -365,6 +841,18 @@ constexpr char LabelIoExpansionDmec[]   = "Arduino Pro Opta Ext D16O8E - AFX0000
 constexpr char LabelIoExpansionDsts[]   = "Arduino Pro Opta Ext D16O8S - AFX00006";
 constexpr char LabelIoExpansionAnalog[] = "Arduino Pro Opta Ext A06O2 - AFX00007 ";
 constexpr char LabelIoStore[]           = "Storing inputs and outputs values to flash memory";
+constexpr char LabelIoJournal[]         = "Replayed journal entries: ";
+constexpr char LabelIoCapture[]         = "Edge capture on input I0.";
+constexpr char LabelIoAnalog[]          = "Set analog mode of input I";
+constexpr char LabelIoScan[]            = "Starting board inputs scan every ms: ";
+constexpr char LabelIoThreshold[]       = "Set state detection of input I";
+constexpr char LabelIoUnplug[]          = "Expansion unplugged ";
+
+// Rules
+constexpr char LabelRulesSetup[]       = "Configuring rules";
+constexpr char LabelRulesCompile[]     = "Rules compiled, bytecode length: ";
+constexpr char LabelRulesCompileFail[] = "Failed to compile rules at character: ";
+constexpr char LabelRulesFileWrite[]   = "Writing rules to flash memory";
 
 // Network
 constexpr char LabelNetworkSetup[]              = "Configuring network";
@@ -420,6 +908,7 @@ constexpr char LabelMqttBroker[]        = "Connecting to MQTT broker";
 constexpr char LabelMqttBrokerFail[]    = "Failed to connect to MQTT broker";
 constexpr char LabelMqttBrokerSuccess[] = "MQTT broker found";
 constexpr char LabelMqttSubscribe[]     = "Subcribed to MQTT topic: ";
+constexpr char LabelMqttUnsubscribe[]   = "Unsubscribed from MQTT topic: ";
 constexpr char LabelMqttReceive[]       = "Receiving MQTT command: ";
 constexpr char LabelMqttPublishDevice[] = "Publishing device informations to MQTT";
 constexpr char LabelMqttPublishInput[]  = "Publishing inputs informations to MQTT";
@@ -442,8 +931,10 @@ constexpr char LabelUpdateNone[]           = "No new OTA firmware version";
 constexpr char LabelUpdateBeginFail[]      = "Failed to begin OTA firmware ";
 constexpr char LabelUpdateDownload[]       = "Starting OTA download ";
 constexpr char LabelUpdateDownloadFail[]   = "Failed to download OTA firmware ";
-constexpr char LabelUpdateUncompress[]     = "Decompressing LZSS compressed file";
-constexpr char LabelUpdateUncompressFail[] = "Failed to uncompress OTA firmware ";
+constexpr char LabelUpdateProgress[]       = "OTA download progress (%): ";
+constexpr char LabelUpdateStored[]         = "OTA firmware bytes stored: ";
+constexpr char LabelUpdateResume[]         = "Resuming OTA download at byte: ";
+constexpr char LabelUpdateRetry[]          = "Retrying OTA download in (ms): ";
 constexpr char LabelUpdateBootloader[]     = "Storing parameters for firmware update in bootloader";
 constexpr char LabelUpdateBootloaderFail[] = "Failed to set up bootlader ";
 constexpr char LabelUpdateSuccess[]        = "Performing a reset after which the bootloader will update the firmware";
@@ -66,6 +66,16 @@ private:
 
   String _updateUrl = "";
 
+  /**
+   * Changed configuration groups since last apply.
+   */
+  uint16_t _changes = ConfigChangeNone;
+
+  /**
+   * Memorized if configuration changes must be applied.
+   */
+  uint8_t _isApply = 0;
+
   /**
    * Convert IP addresse from string 0.0.0.0 to IPAddress object.
    *
@@ -81,10 +91,48 @@ private:
 	  return ret;
 	}
 
+	/**
+	 * Append a field to a configuration binary record payload.
+	 *
+	 * @param 	buffer 	The payload buffer
+	 * @param 	offset 	The current payload length
+	 * @param 	tag 		The field tag
+	 * @param 	value 	The field value
+	 * @param 	length 	The field value length
+	 *
+	 * @return 	The new payload length, or ConfigRecordSize if field does not fit
+	 */
+	size_t appendTag(uint8_t *buffer, size_t offset, uint8_t tag, const void *value, size_t length) {
+	  if (length > 255 || offset + 2 + length > ConfigRecordSize - StoreRecordHeaderLength) {
+
+	    return ConfigRecordSize;
+	  }
+	  buffer[offset++] = tag;
+	  buffer[offset++] = length;
+	  memcpy(buffer + offset, value, length);
+	  offset += length;
+
+	  return offset;
+	}
+	size_t appendTag(uint8_t *buffer, size_t offset, uint8_t tag, uint32_t value, uint8_t length) {
+
+	  return appendTag(buffer, offset, tag, (const void *)&value, length);
+	}
+	size_t appendTag(uint8_t *buffer, size_t offset, uint8_t tag, const String &value) {
+
+	  return appendTag(buffer, offset, tag, value.c_str(), value.length());
+	}
+	size_t appendTag(uint8_t *buffer, size_t offset, uint8_t tag, IPAddress value) {
+	  uint8_t ip[4] = { value[0], value[1], value[2], value[3] };
+
+	  return appendTag(buffer, offset, tag, ip, 4);
+	}
+
 public:
   OptaLinkerConfig(OptaLinkerVersion &_version, OptaLinkerMonitor &_monitor, OptaLinkerBoard &_board, OptaLinkerStore &_store) : version(_version), monitor(_monitor), board(_board), store(_store) {}
 
   static const uint8_t MaxStringLength = 48; // Limit string length, usefull for modbus, must be even.
+  static const uint8_t MaxUrlLength = 128; // Limit URL and host length, not in modbus registers.
 
   uint8_t setup() {
 
@@ -130,6 +178,8 @@ public:
 		  }
 		}
 
+	  // Values read on setup are not changes
+	  resetChanges();
 	  board.pingTimeout();
 
     return 1;
@@ -392,31 +442,197 @@ public:
 	  monitor.setMessage(LabelConfigDefaultRead, MonitorSuccess);
 	}
 
+	/**
+	 * Write current configuration to binary record payload.
+	 *
+	 * @param 	buffer 	The payload buffer, of ConfigRecordSize - StoreRecordHeaderLength bytes
+	 *
+	 * @return 	The payload length, or 0 if configuration does not fit
+	 */
+	size_t writeToBinary(uint8_t *buffer) {
+	  size_t offset = 0;
+
+	  offset = appendTag(buffer, offset, ConfigTagDeviceId, getDeviceId(), 1);
+	  offset = appendTag(buffer, offset, ConfigTagDeviceUser, getDeviceUser());
+	  offset = appendTag(buffer, offset, ConfigTagDevicePassword, getDevicePassword());
+	  offset = appendTag(buffer, offset, ConfigTagTimeOffset, (uint32_t)(int32_t)getTimeOffset(), 4);
+	  offset = appendTag(buffer, offset, ConfigTagTimeServer, getTimeServer());
+	  offset = appendTag(buffer, offset, ConfigTagRs485Type, getRs485Type(), 1);
+	  offset = appendTag(buffer, offset, ConfigTagRs485Baudrate, getRs485Baudrate(), 4);
+	  offset = appendTag(buffer, offset, ConfigTagRs485ToMqtt, getRs485ToMqtt(), 1);
+	  offset = appendTag(buffer, offset, ConfigTagModbusType, getModbusType(), 1);
+	  offset = appendTag(buffer, offset, ConfigTagModbusIp, getModbusIp());
+	  offset = appendTag(buffer, offset, ConfigTagModbusPort, getModbusPort(), 2);
+	  offset = appendTag(buffer, offset, ConfigTagNetworkIp, getNetworkIp());
+	  offset = appendTag(buffer, offset, ConfigTagNetworkGateway, getNetworkGateway());
+	  offset = appendTag(buffer, offset, ConfigTagNetworkSubnet, getNetworkSubnet());
+	  offset = appendTag(buffer, offset, ConfigTagNetworkDns, getNetworkDns());
+	  offset = appendTag(buffer, offset, ConfigTagNetworkDhcp, getNetworkDhcp(), 1);
+	  offset = appendTag(buffer, offset, ConfigTagNetworkWifi, getNetworkWifi(), 1);
+	  offset = appendTag(buffer, offset, ConfigTagNetworkSsid, getNetworkSsid());
+	  offset = appendTag(buffer, offset, ConfigTagNetworkPassword, getNetworkPassword());
+	  offset = appendTag(buffer, offset, ConfigTagMqttIp, getMqttIp());
+	  offset = appendTag(buffer, offset, ConfigTagMqttPort, getMqttPort(), 2);
+	  offset = appendTag(buffer, offset, ConfigTagMqttUser, getMqttUser());
+	  offset = appendTag(buffer, offset, ConfigTagMqttPassword, getMqttPassword());
+	  offset = appendTag(buffer, offset, ConfigTagMqttBase, getMqttBase());
+	  offset = appendTag(buffer, offset, ConfigTagMqttInterval, getMqttInterval(), 4);
+	  offset = appendTag(buffer, offset, ConfigTagUpdateUrl, getUpdateUrl());
+
+	  return offset > ConfigRecordSize - StoreRecordHeaderLength ? 0 : offset;
+	}
+
+	/**
+	 * Read configuration from binary record payload.
+	 *
+	 * Fields are applied directly through setters, unknown tags are skipped.
+	 *
+	 * @param 	buffer 	The payload buffer
+	 * @param 	length 	The payload length
+	 *
+	 * @return 	1 on success, else 0
+	 */
+	uint8_t readFromBinary(const uint8_t *buffer, size_t length) {
+	  size_t offset = 0;
+
+	  while (offset + 2 <= length) {
+	    uint8_t tag = buffer[offset++];
+	    uint8_t size = buffer[offset++];
+	    if (offset + size > length) {
+
+	      return 0;
+	    }
+
+	    const uint8_t *value = buffer + offset;
+	    uint32_t number = 0;
+	    memcpy(&number, value, size < 4 ? size : 4);
+	    String text = "";
+	    text.concat((const char *)value, size);
+	    IPAddress ip = size == 4 ? IPAddress(value[0], value[1], value[2], value[3]) : IPAddress(0, 0, 0, 0);
+
+	    switch (tag) {
+	      case ConfigTagDeviceId:        setDeviceId(number); break;
+	      case ConfigTagDeviceUser:      setDeviceUser(text); break;
+	      case ConfigTagDevicePassword:  setDevicePassword(text); break;
+	      case ConfigTagTimeOffset:      setTimeOffset((int32_t)number); break;
+	      case ConfigTagTimeServer:      setTimeServer(text); break;
+	      case ConfigTagRs485Type:       setRs485Type(number); break;
+	      case ConfigTagRs485Baudrate:   setRs485Baudrate(number); break;
+	      case ConfigTagRs485ToMqtt:     setRs485ToMqtt(number); break;
+	      case ConfigTagModbusType:      setModbusType(number); break;
+	      case ConfigTagModbusIp:        setModbusIp(ip); break;
+	      case ConfigTagModbusPort:      setModbusPort(number); break;
+	      case ConfigTagNetworkIp:       setNetworkIp(ip); break;
+	      case ConfigTagNetworkGateway:  setNetworkGateway(ip); break;
+	      case ConfigTagNetworkSubnet:   setNetworkSubnet(ip); break;
+	      case ConfigTagNetworkDns:      setNetworkDns(ip); break;
+	      case ConfigTagNetworkDhcp:     setNetworkDhcp(number); break;
+	      case ConfigTagNetworkWifi:     setNetworkWifi(number); break;
+	      case ConfigTagNetworkSsid:     setNetworkSsid(text); break;
+	      case ConfigTagNetworkPassword: setNetworkPassword(text); break;
+	      case ConfigTagMqttIp:          setMqttIp(ip); break;
+	      case ConfigTagMqttPort:        setMqttPort(number); break;
+	      case ConfigTagMqttUser:        setMqttUser(text); break;
+	      case ConfigTagMqttPassword:    setMqttPassword(text); break;
+	      case ConfigTagMqttBase:        setMqttBase(text); break;
+	      case ConfigTagMqttInterval:    setMqttInterval(number); break;
+	      case ConfigTagUpdateUrl:       setUpdateUrl(text); break;
+	      default: break; // field from a newer firmware
+	    }
+	    offset += size;
+	  }
+
+	  return 1;
+	}
+
+	/**
+	 * Get changed configuration groups.
+	 *
+	 * @return 	The ConfigChange flags
+	 */
+	uint16_t getChanges() const {
+
+	  return _changes;
+	}
+
+	/**
+	 * Forget configuration changes.
+	 */
+	void resetChanges() {
+	  _changes = ConfigChangeNone;
+	  _isApply = 0;
+	}
+
+	/**
+	 * Request to apply configuration changes.
+	 *
+	 * Changes are applied on next library loop.
+	 */
+	void setApply() {
+	  _isApply = 1;
+	}
+
+	/**
+	 * Check if configuration changes must be applied.
+	 *
+	 * @return 	1 if changes must be applied, else 0
+	 */
+	uint8_t isApply() const {
+
+	  return _isApply && _changes != ConfigChangeNone ? 1 : 0;
+	}
+
 	/**
 	 * Write configuration to falsh memory.
 	 *
+	 * Configuration is stored as binary record, JSON is only used for import/export.
+	 * Record is written by flash writer thread.
+	 *
 	 * @return 	1 on success, else 0
 	 */
 	uint8_t writeToFile() {
-	  String str = writeToJson(false);
-	  uint8_t ret = store.writeKey("config", str.c_str());
+	  uint8_t record[ConfigRecordSize];
+	  size_t length = writeToBinary(record + StoreRecordHeaderLength);
+	  if (length == 0) {
+	    monitor.setMessage(LabelConfigFileFull, MonitorFail);
 
-	  monitor.setMessage(LabelConfigFileWrite, ret ? MonitorSuccess : MonitorFail);
+	    return 0;
+	  }
 
-	  return ret;
+	  return store.queueRecord("config", record, ConfigRecordSchema, length, callback(this, &OptaLinkerConfig::onWrite)) ? 1 : 0;
+	}
+
+	/**
+	 * Configuration write callback.
+	 *
+	 * @param 	ret 	The write result
+	 */
+	void onWrite(uint8_t ret) {
+	  monitor.setMessage(LabelConfigFileWrite, ret ? MonitorSuccess : MonitorFail);
 	}
 
 	/**
 	 * Read configuration from flash memory.
 	 *
+	 * Configuration written as JSON by previous firmware is imported once,
+	 * it is converted to binary record on next write.
 	 * If configuration file can not be read, the configuration is resetted to default.
 	 *
 	 * @return 	1 on success, else 0
 	 */
 	uint8_t readFromFile() {
+	  uint8_t record[ConfigRecordSize];
+	  uint16_t schema = 0;
+	  int32_t length = store.readRecord("config", record, sizeof(record), schema);
+
+	  if (length >= 0 && readFromBinary(record + StoreRecordHeaderLength, length)) {
+	    monitor.setMessage(LabelConfigFileRead, MonitorSuccess);
+
+	    return 1;
+	  }
 
-	  String str = store.readKey("config");
-	  if (readFromJson(str.c_str(), str.length()) < 1) {
+	  OptaLinkerStoreValue value = store.readKey("config");
+	  if (value.c_str()[0] != '{' || readFromJson(value.c_str(), value.length()) < 1) {
 	    monitor.setMessage(LabelConfigFileFail, MonitorFail);
 	    reset();
 
@@ -436,6 +652,7 @@ public:
 	  if (value >= 0 && value < 255 && value != _deviceId) {
 	    monitor.setMessage(LabelConfigSetDeviceId + String(value), MonitorSuccess);
 	    _deviceId = value;
+	    _changes |= ConfigChangeDeviceId;
 	  }
 	}
 
@@ -448,6 +665,7 @@ public:
 		if (value.length() <= MaxStringLength && !value.equals(_deviceUser)) {
 		  monitor.setMessage(LabelConfigSetDeviceUser + String(value), MonitorSuccess);
 		  _deviceUser = value;
+		  _changes |= ConfigChangeDevice;
 		}
 	}
 
@@ -460,6 +678,7 @@ public:
 		if (value.length() <= MaxStringLength && !value.equals(_devicePassword)) {
 		  monitor.setMessage(LabelConfigSetDevicePassword + String(value), MonitorSuccess);
 		  _devicePassword = value;
+		  _changes |= ConfigChangeDevice;
 		}
 	}
 
@@ -472,6 +691,7 @@ public:
 	  if (value > -24 && value < 24 && value != _timeOffset) {
 	    monitor.setMessage(LabelConfigSetTimeOffset + String(value), MonitorSuccess);
 	    _timeOffset = value;
+	    _changes |= ConfigChangeTime;
 	  }
 	}
 
@@ -481,9 +701,10 @@ public:
 	}
 
 	void setTimeServer(String value) {
-		if (!value.equals(_timeServer)) {
+		if (value.length() <= MaxUrlLength && !value.equals(_timeServer)) {
 		  monitor.setMessage(LabelConfigSetTimeServer + String(value), MonitorSuccess);
 		  _timeServer = value;
+		  _changes |= ConfigChangeTime;
 		}
 	}
 
@@ -496,6 +717,7 @@ public:
 	  if (value < 3 && value != _rs485Type) {
 	    monitor.setMessage(LabelConfigSetRs485Type + String(value), MonitorSuccess);
 	    _rs485Type = value;
+	    _changes |= ConfigChangeRs485;
 	  }
 	}
 
@@ -508,6 +730,7 @@ public:
 	  if (value > 0 && value < 921600 && value != _rs485Baudrate) {
 	    monitor.setMessage(LabelConfigSetRs485Baudrate + String(value), MonitorSuccess);
 	    _rs485Baudrate = value;
+	    _changes |= ConfigChangeRs485;
 	  }
 	}
 
@@ -520,6 +743,7 @@ public:
 		if ((value == 0 || value == 1) && value != _rs485ToMqtt) {
 		  monitor.setMessage(LabelConfigSetRs485ToMqtt + String(value ? "Enable" : "Disable"), MonitorSuccess);
 		  _rs485ToMqtt = value;
+		  _changes |= ConfigChangeRs485;
 		}
 	}
 
@@ -532,6 +756,7 @@ public:
 		if (value != _networkIp) {
 		  monitor.setMessage(LabelConfigSetNetworkIp + value.toString(), MonitorSuccess);
 		  _networkIp = value;
+		  _changes |= ConfigChangeNetwork;
 		}
 	}
 
@@ -544,6 +769,7 @@ public:
 		if (value != _networkGateway) {
 		  monitor.setMessage(LabelConfigSetNetworkGateway + value.toString(), MonitorSuccess);
 		  _networkGateway = value;
+		  _changes |= ConfigChangeNetwork;
 		}
 	}
 
@@ -556,6 +782,7 @@ public:
 		if (value != _networkSubnet) {
 		  monitor.setMessage(LabelConfigSetNetworkSubnet + value.toString(), MonitorSuccess);
 	  	_networkSubnet = value;
+	  	_changes |= ConfigChangeNetwork;
 	  }
 	}
 
@@ -568,6 +795,7 @@ public:
 		if (value != _networkDns) {
 	  	monitor.setMessage(LabelConfigSetNetworkDns + value.toString(), MonitorSuccess);
 		  _networkDns = value;
+		  _changes |= ConfigChangeNetwork;
 		}
 	}
 
@@ -580,6 +808,7 @@ public:
 		if ((value == 0 || value == 1) && value != _networkDhcp) {
 		  monitor.setMessage(LabelConfigSetNetworkDhcp + String(value ? "Enable" : "Disable"), MonitorSuccess);
 		  _networkDhcp = value;
+		  _changes |= ConfigChangeNetwork;
 		}
 	}
 
@@ -592,6 +821,7 @@ public:
 		if ((value == 0 || value == 1) && value != _networkWifi) {
 		  monitor.setMessage(LabelConfigSetNetworkWifi + String(value ? "Enable" : "Disable"), MonitorSuccess);
 		  _networkWifi = value;
+		  _changes |= ConfigChangeNetwork;
 		}
 	}
 
@@ -604,6 +834,7 @@ public:
 		if (value.length() <= MaxStringLength && !value.equals(_networkSsid)) {
 	  	monitor.setMessage(LabelConfigSetNetworkSsid + String(value), MonitorSuccess);
 	  	_networkSsid = value;
+	  	_changes |= ConfigChangeNetwork;
 	  }
 	}
 
@@ -616,6 +847,7 @@ public:
 		if (value.length() <= MaxStringLength && !value.equals(_networkPassword)) {
 		  monitor.setMessage(LabelConfigSetNetworkPassword + String(value), MonitorSuccess);
 		  _networkPassword = value;
+		  _changes |= ConfigChangeNetwork;
 		}
 	}
 
@@ -628,6 +860,7 @@ public:
 		if (value != _mqttIp) {
 	  	monitor.setMessage(LabelConfigSetMqttIp + value.toString(), MonitorSuccess);
 	  	_mqttIp = value;
+	  	_changes |= ConfigChangeMqtt;
 	  }
 	}
 
@@ -640,6 +873,7 @@ public:
 		if ((value > 0 && value < 65536) && value != _mqttPort) {
 		  monitor.setMessage(LabelConfigSetMqttPort + String(value), MonitorSuccess);
 		  _mqttPort = value;
+		  _changes |= ConfigChangeMqtt;
 		}
 	}
 
@@ -652,6 +886,7 @@ public:
 		if (value.length() <= MaxStringLength && !value.equals(_mqttUser)) {
 	  	monitor.setMessage(LabelConfigSetMqttUser + value, MonitorSuccess);
 	  	_mqttUser = value;
+	  	_changes |= ConfigChangeMqtt;
 	  }
 	}
 
@@ -664,6 +899,7 @@ public:
 		if (value.length() <= MaxStringLength && !value.equals(_mqttPassword)) {
 	  	monitor.setMessage(LabelConfigSetMqttPassword + value, MonitorSuccess);
 	  	_mqttPassword = value;
+	  	_changes |= ConfigChangeMqtt;
 	  }
 	}
 
@@ -676,6 +912,7 @@ public:
 		if (value.length() <= MaxStringLength && !value.equals(_mqttBase)) {
 	  	monitor.setMessage(LabelConfigSetMqttBase + value, MonitorSuccess);
 	  	_mqttBase = value;
+	  	_changes |= ConfigChangeMqtt;
 	  }
 	}
 
@@ -688,6 +925,7 @@ public:
 	  if (value != _mqttInterval) {
 	    monitor.setMessage(LabelConfigSetMqttInterval + String(value), MonitorSuccess);
 	    _mqttInterval = value;
+	    _changes |= ConfigChangeMqtt;
 	  }
 	}
 
@@ -700,6 +938,7 @@ public:
 	  if (value < 5 && value != _modbusType) {
 	    monitor.setMessage(LabelConfigSetModbusType + String(value), MonitorSuccess);
 	    _modbusType = value;
+	    _changes |= ConfigChangeModbus;
 	  }
 	}
 
@@ -712,6 +951,7 @@ public:
 		if (value != _modbusIp) {
 	  	monitor.setMessage(LabelConfigSetModbusIp + value.toString(), MonitorSuccess);
 	  	_modbusIp = value;
+	  	_changes |= ConfigChangeModbus;
 	  }
 	}
 
@@ -724,6 +964,7 @@ public:
 		if (value > 0 && value < 65536 && value != _modbusPort) {
 		  monitor.setMessage(LabelConfigSetModbusPort + String(value), MonitorSuccess);
 		  _modbusPort = value;
+		  _changes |= ConfigChangeModbus;
 		}
 	}
 
@@ -734,9 +975,10 @@ public:
 	}
 
 	void setUpdateUrl(String value) {
-		if (!value.equals(_updateUrl)) {
+		if (value.length() <= MaxUrlLength && !value.equals(_updateUrl)) {
 		  monitor.setMessage(LabelConfigSetUpdateUrl + String(value), MonitorSuccess);
 		  _updateUrl = value;
+		  _changes |= ConfigChangeUpdate;
 		}
 	}
 
@@ -106,9 +106,51 @@
 #define OPTALINKER_MODBUS_POLL 50
 
 
+// IO
+
+// Unit: bitmask. Default: 0. Action: Board inputs counted by pin interrupt instead of poll, for fast pulses and rate, bit 0 is I0.0 (voltage is not read)
+#define OPTALINKER_IO_CAPTURE 0
+
+// Unit: Millisecond. Default: 0. Action: Digital inputs default debounce delay, input level must be stable this time to change state
+#define OPTALINKER_IO_DEBOUNCE 0
+
+// Unit: Millisecond. Default: 1. Action: Board inputs scan delay of background thread, edges between polls are counted. (0 to read inputs on poll)
+#define OPTALINKER_IO_SCAN 1
+
+// Unit: Millisecond. Default: 5000. Action: Expansions rescan delay, added, removed or replaced expansions are rebuilt without restart. (0 to disable)
+#define OPTALINKER_IO_RESCAN 5000
+
+// Unit: 1~16. Default: 1. Action: Analog expansions reads averaged on each inputs poll
+#define OPTALINKER_IO_ANALOG_OVERSAMPLE 1
+
+// Unit: 0~2. Default: 1. Action: Analog expansions channels filter. (0 = none, 1 = moving average, 2 = low pass IIR)
+#define OPTALINKER_IO_ANALOG_FILTER 1
+
+// Unit: 1~16. Default: 8. Action: Analog expansions channels filter depth, in samples
+#define OPTALINKER_IO_ANALOG_DEPTH 8
+
+// Unit: mV, uA or 0.1 ohm. Default: 10. Action: Analog measure change that refreshes input on Modbus and MQTT
+#define OPTALINKER_IO_ANALOG_DEADBAND 10
+
+
+// Rules
+
+// Unit: string. Default: "". Action: Rules used until rules are set from sketch or configuration, ex: "O0.0 = I0.0 & !I0.1; O0.1 = TON(I0.2, 2000)"
+#define OPTALINKER_RULES ""
+
+
 // OTA update
 
 #define OPTALINKER_UPDATE_URL ""
 
+// Unit: Byte. Default: 1024. Action: OTA download chunk size (max 4096)
+#define OPTALINKER_UPDATE_CHUNK 1024
+
+// Unit: 0~255. Default: 5. Action: OTA download retries on connection lost, download is resumed where it stopped
+#define OPTALINKER_UPDATE_RETRY 5
+
+// Unit: Millisecond. Default: 2000. Action: OTA download first retry delay, it doubles on each retry
+#define OPTALINKER_UPDATE_BACKOFF 2000
+
 
 #endif  // #ifndef OPTALINKER_DEFINE_H
\ No newline at end of file
@@ -302,7 +302,12 @@ const char web_home_html[] = R"rawliteral(
             iLi.appendChild(led);
             const iSt = data.expansion[exp].input[inp].state ? "ON" : "OFF";
             const iTm = data.expansion[exp].input[inp].partialHigh / 3600000; // ms to hour
-            iLi.appendChild(document.createTextNode(`[I${data.expansion[exp].id}.${data.expansion[exp].input[inp].id}] : ${iSt} : ${data.expansion[exp].input[inp].voltage.toFixed(0)}mV : ${data.expansion[exp].input[inp].partialPulse} pulse : ${iTm.toFixed(1)} Hours`));
+            if (data.expansion[exp].input[inp].type == 1) {
+              const iUnit = ["mV", "uA", "dOhm", "dOhm"][data.expansion[exp].input[inp].mode];
+              iLi.appendChild(document.createTextNode(`[I${data.expansion[exp].id}.${data.expansion[exp].input[inp].id}] : ${data.expansion[exp].input[inp].voltage.toFixed(0)}${iUnit} : ${data.expansion[exp].input[inp].value}`));
+            } else {
+              iLi.appendChild(document.createTextNode(`[I${data.expansion[exp].id}.${data.expansion[exp].input[inp].id}] : ${iSt} : ${data.expansion[exp].input[inp].voltage.toFixed(0)}mV : ${data.expansion[exp].input[inp].partialPulse} pulse : ${iTm.toFixed(1)} Hours`));
+            }
             iUl.appendChild(iLi);
           }
         });
@@ -602,7 +607,7 @@ const char web_device_html[] = R"rawliteral(
       </div>
 
       <div class="field">
-        <button type="submit" class="button">Save configuration and reboot</button>
+        <button type="submit" class="button">Save configuration</button>
       </div>
 
     </div>
@@ -806,7 +811,7 @@ const char web_device_html[] = R"rawliteral(
         if (!response.ok) {
           throw new Error('Failed to set configuration');
         } else {
-          document.getElementById('optaReboot').innerHTML = 'Success. Device is going to reboot.';
+          document.getElementById('optaReboot').innerHTML = 'Success. Configuration applied, device reboots only if required.';
           window.location.href = "/";
         }
       } catch (error) {
@@ -55,11 +55,51 @@ private:
    */
   uint32_t _pollLast = 0;
 
+  /**
+   * Called on each poll once inputs are read.
+   */
+  Callback<void()> _onPoll = nullptr;
+
+  /**
+   * Called on each poll once inputs are read, before poll callback, reserved for rules module.
+   */
+  Callback<void()> _onRules = nullptr;
+
+  /**
+   * Expansions changed on this loop rescan, as bits.
+   */
+  uint8_t _isRescan = 0;
+
+  /**
+   * Expansions rescan delay.
+   */
+  uint32_t _rescanDelay = OPTALINKER_IO_RESCAN;
+
+  /**
+   * Last rescan time.
+   */
+  uint32_t _rescanLast = 0;
+
   /**
    * Last store time.
    */
   uint32_t _storeLast = 0;
 
+  /**
+   * Journal write delay.
+   */
+  uint32_t _storeDelay = 5000;
+
+  /**
+   * Number of queued snapshots not yet written.
+   */
+  volatile uint8_t _storePending = 0;
+
+  /**
+   * Journal sequence of the last queued snapshot.
+   */
+  uint32_t _storeSequence = 0;
+
   /**
    * Number of expansion (including main board).
    */
@@ -70,8 +110,644 @@ private:
    */
   ExpansionStruct _expansion[OPTA_CONTROLLER_MAX_EXPANSION_NUM + 1];
 
+  /**
+   * Expansions typed handles, resolved once on expansions initialization.
+   */
+  DigitalMechExpansion _dmec[OPTA_CONTROLLER_MAX_EXPANSION_NUM + 1];
+  DigitalStSolidExpansion _dsts[OPTA_CONTROLLER_MAX_EXPANSION_NUM + 1];
+  AnalogExpansion _analogExpansion[OPTA_CONTROLLER_MAX_EXPANSION_NUM + 1];
+
+  /**
+   * Digital expansions handles, pointing to their typed handle or null.
+   */
+  DigitalExpansion *_digital[OPTA_CONTROLLER_MAX_EXPANSION_NUM + 1] = {};
+
+  /**
+   * Inputs edges capture, by expansion and input.
+   */
+  CaptureStruct _capture[OPTA_CONTROLLER_MAX_EXPANSION_NUM + 1][16];
+
+  /**
+   * Board inputs using edge capture, as bits.
+   */
+  uint8_t _captureMask = OPTALINKER_IO_CAPTURE;
+
+  /**
+   * Expansions with staged outputs, as bits.
+   */
+  uint8_t _outputStaged = 0;
+
+  /**
+   * Board inputs scan delay, 0 to read inputs on poll.
+   */
+  uint32_t _scanDelay = OPTALINKER_IO_SCAN;
+
+  /**
+   * Board inputs scan results, double buffered.
+   *
+   * Scan thread adds reads to bank _scanBank, loop swaps banks on poll then reads the other one.
+   */
+  uint32_t _scanSum[2][8] = {};
+  uint16_t _scanCount[2][8] = {};
+  volatile uint8_t _scanBank = 0;
+
+  /**
+   * Analog expansions channels filter and scale, by expansion and channel.
+   */
+  AnalogStruct _analog[OPTA_CONTROLLER_MAX_EXPANSION_NUM + 1][OA_AN_CHANNELS_NUM];
+
+  /**
+   * Analog expansions reads averaged on each poll.
+   */
+  uint8_t _analogOversample = OPTALINKER_IO_ANALOG_OVERSAMPLE;
+
+  /**
+   * IO counters binary record buffer.
+   */
+  uint8_t _record[IoRecordSize];
+
+  /**
+   * Counters values as last written to flash memory (snapshot or journal).
+   *
+   * Indexed by expansion, io (inputs then outputs) and field.
+   */
+  uint32_t _stored[OPTA_CONTROLLER_MAX_EXPANSION_NUM + 1][24][5];
+
+  /**
+   * Expansions types and first journal sequence of the last snapshot read.
+   */
+  uint8_t _snapshotType[OPTA_CONTROLLER_MAX_EXPANSION_NUM + 1];
+  uint32_t _snapshotSequence = 0;
+
+  /**
+   * Append an io counter to binary record payload.
+   *
+   * Null counters are not stored, unless forced.
+   *
+   * @param   buffer  The payload buffer
+   * @param   offset  The current payload length
+   * @param   uid     The io uid
+   * @param   field   The io field
+   * @param   value   The io field value
+   * @param   force   True to store null value
+   *
+   * @return  The new payload length
+   */
+  size_t appendEntry(uint8_t *buffer, size_t offset, uint16_t uid, uint8_t field, uint32_t value, uint8_t force = 0) {
+    if ((value > 0 || force) && offset + IoRecordEntryLength <= IoRecordSize - StoreRecordHeaderLength) {
+      memcpy(buffer + offset, &uid, 2);
+      buffer[offset + 2] = field;
+      memcpy(buffer + offset + 3, &value, 4);
+      offset += IoRecordEntryLength;
+    }
+
+    return offset;
+  }
+
+  /**
+   * Append an io counters to binary record payload.
+   *
+   * @param   buffer    The payload buffer
+   * @param   offset    The current payload length
+   * @param   ios       An io instance
+   * @param   isOutput  True if io is an output
+   *
+   * @return  The new payload length
+   */
+  size_t appendIo(uint8_t *buffer, size_t offset, IoStruct &ios, uint8_t isOutput) {
+    if (ios.exists) {
+      uint8_t flag = isOutput ? IoRecordOutput : 0;
+      offset = appendEntry(buffer, offset, ios.uid, IoFieldReset | flag, ios.reset);
+      offset = appendEntry(buffer, offset, ios.uid, IoFieldPulse | flag, ios.pulse);
+      offset = appendEntry(buffer, offset, ios.uid, IoFieldPartialPulse | flag, ios.partialPulse);
+      offset = appendEntry(buffer, offset, ios.uid, IoFieldHigh | flag, ios.high);
+      offset = appendEntry(buffer, offset, ios.uid, IoFieldPartialHigh | flag, ios.partialHigh);
+
+      // digital inputs settings, only if not default, even if null
+      if (!isOutput && ios.capture != IoCaptureNone) {
+        IoStruct def;
+        resetSettings(def, ios.uid / 100);
+        if (ios.threshold != def.threshold) {
+          offset = appendEntry(buffer, offset, ios.uid, IoFieldThreshold, ios.threshold, 1);
+        }
+        if (ios.hysteresis != def.hysteresis) {
+          offset = appendEntry(buffer, offset, ios.uid, IoFieldHysteresis, ios.hysteresis, 1);
+        }
+        if (ios.debounce != def.debounce) {
+          offset = appendEntry(buffer, offset, ios.uid, IoFieldDebounce, ios.debounce, 1);
+        }
+      }
+    }
+
+    return offset;
+  }
+
+  /**
+   * Append changed counters of an io to journal.
+   *
+   * @param   ios       An io instance
+   * @param   stored    The io stored values
+   * @param   isOutput  True if io is an output
+   *
+   * @return  1 on success, 2 if journal is busy, else 0 if journal is full
+   */
+  uint8_t journalIo(IoStruct &ios, uint32_t *stored, uint8_t isOutput) {
+    if (ios.exists) {
+      for (uint8_t f = 0; f < 5; f++) {
+        uint32_t value = getIo(ios, IoFieldReset + f);
+        if (value != stored[f]) {
+          uint8_t ret = store.writeJournal(ios.uid, (IoFieldReset + f) | (isOutput ? IoRecordOutput : 0), value);
+          if (ret != 1) {
+
+            return ret;
+          }
+          stored[f] = value;
+        }
+      }
+    }
+
+    return 1;
+  }
+
+  /**
+   * Record an input edge.
+   *
+   * Called from pin interrupt in edge capture mode, or on poll.
+   *
+   * @param   c       The input capture
+   * @param   level   The input level
+   * @param   now     The edge time in us
+   */
+  static void captureEdge(CaptureStruct &c, uint8_t level, uint32_t now) {
+    if (level == c.level) {
+
+      return;
+    }
+    c.level = level;
+    if (level) {
+      if (c.edges > 0) {
+        c.period = now - c.rise;
+      }
+      c.rise = now;
+      c.mark = now;
+      c.edges++;
+    } else {
+      if (c.edges > 0) {
+        c.width = now - c.rise;
+      }
+      captureHigh(c, now);
+    }
+  }
+
+  /**
+   * Add time spent high since rising edge or last call to input capture.
+   *
+   * @param   c       The input capture
+   * @param   now     The time in us
+   */
+  static void captureHigh(CaptureStruct &c, uint32_t now) {
+    // debounced edge time can be before last call
+    if ((int32_t)(now - c.mark) > 0) {
+      c.highUs += now - c.mark;
+      c.mark = now;
+    }
+  }
+
+  /**
+   * Get a digital input level from its voltage.
+   *
+   * @param   ios     An io instance
+   * @param   level   The input current level
+   * @param   mv      The input voltage in mV
+   *
+   * @return  The input level
+   */
+  static uint8_t toLevel(IoStruct &ios, uint8_t level, uint32_t mv) {
+
+    return level ? mv + ios.hysteresis > ios.threshold : mv > ios.threshold;
+  }
+
+  /**
+   * Debounce an input level then record its edge.
+   *
+   * Edge time is the time level changed, once level is stable for debounce time.
+   *
+   * @param   c         The input capture
+   * @param   level     The input level
+   * @param   now       The time in us
+   * @param   debounce  The debounce time in ms
+   */
+  static void debounceEdge(CaptureStruct &c, uint8_t level, uint32_t now, uint16_t debounce) {
+    if (level == c.level) {
+      c.bouncing = 0;
+
+      return;
+    }
+    if (!c.bouncing) {
+      c.bouncing = 1;
+      c.bounce = now;
+    }
+    if (now - c.bounce >= debounce * 1000UL) {
+      c.bouncing = 0;
+      captureEdge(c, level, c.bounce);
+    }
+  }
+
+  /**
+   * Reset a digital input state detection settings.
+   *
+   * @param   ios   An io instance
+   * @param   e     The io expansion
+   */
+  void resetSettings(IoStruct &ios, uint8_t e) {
+    ios.threshold = e == 0 ? IoThresholdBoard : IoThresholdExpansion;
+    ios.hysteresis = e == 0 ? IoHysteresisBoard : IoHysteresisExpansion;
+    ios.debounce = OPTALINKER_IO_DEBOUNCE;
+  }
+
+  /**
+   * Board input pin interrupt.
+   *
+   * @param   param   The input capture
+   */
+  static void onCapture(void *param) {
+    CaptureStruct *c = (CaptureStruct *)param;
+    captureEdge(*c, digitalRead(c->pin) == HIGH, micros());
+  }
+
+  /**
+   * Update io frequency, period and duty cycle from its capture.
+   *
+   * Rate falls to 0 if no rising edge comes within two periods, nor IoCaptureTimeout.
+   *
+   * @param   ios   An io instance
+   * @param   c     The io capture
+   *
+   * @return  1 if io update time must be refreshed, else 0
+   */
+  uint8_t updateRate(IoStruct &ios, CaptureStruct &c) {
+    uint32_t now = micros();
+
+    noInterrupts();
+    uint32_t edges = c.edges;
+    uint32_t rise = c.rise;
+    uint32_t period = c.period;
+    uint32_t width = c.width;
+    interrupts();
+
+    uint32_t frequency = 0;
+    uint16_t duty = ios.state ? 1000 : 0;
+    if (edges > 1 && period > 0 && now - rise <= max(IoCaptureTimeout * 1000, period * 2)) {
+      frequency = 1000000000UL / period;
+      duty = (uint64_t)min(width, period) * 1000 / period;
+    } else {
+      period = 0;
+    }
+
+    // start and stop of pulse train, then its changes from time to time
+    uint8_t refresh = (frequency == 0) != (ios.frequency == 0)
+      || (frequency != ios.frequency && state.getTime() - ios.update >= IoCaptureRefresh);
+
+    ios.frequency = frequency;
+    ios.period = period;
+    ios.duty = duty;
+
+    return refresh;
+  }
+
+  /**
+   * Read a board input in edge capture or scan mode.
+   *
+   * Pulses and high time come from pin interrupt or scan thread,
+   * state changes of a running pulse train do not refresh update time.
+   *
+   * @param   i   The board input
+   */
+  void readCapture(uint8_t i) {
+    IoStruct &ios = _expansion[0].input[i];
+    CaptureStruct &c = _capture[0][i];
+
+    noInterrupts();
+    if (c.level) {
+      captureHigh(c, micros());
+    }
+    uint32_t pulses = c.edges - c.counted;
+    c.counted = c.edges;
+    uint32_t high = c.highUs / 1000;
+    c.highUs -= high * 1000;
+    uint8_t level = c.level;
+    interrupts();
+
+    ios.pulse += pulses;
+    ios.partialPulse += pulses;
+    ios.high += high;
+    ios.partialHigh += high;
+    if (ios.capture == IoCaptureEdge) {
+      ios.voltage = 0;
+    }
+
+    uint8_t refresh = updateRate(ios, c);
+    if (level != ios.state) {
+      ios.state = level;
+      refresh |= ios.frequency == 0;
+    }
+    if (refresh) {
+      monitor.setMessage(String("[I0.") + i + "] => " + level + ", " + ios.frequency / 1000.0 + "Hz, Pulse: " + ios.pulse, MonitorInfo);
+      ios.update = state.getTime();
+    }
+  }
+
+  /**
+   * Board inputs scan thread loop.
+   *
+   * Inputs are read between polls, reads are summed for loop
+   * and crossings of state thresholds are timestamped as edges.
+   */
+  void scanner() {
+    while (1) {
+      uint32_t now = micros();
+      for (uint8_t i = 0; i < 8; i++) {
+        if (_expansion[0].input[i].capture == IoCaptureScan) {
+          uint16_t raw = analogRead(BoardInputs[i]);
+          uint32_t mv = (raw * IoScanMillivolt + IoScanFull / 2) / IoScanFull;
+          CaptureStruct &c = _capture[0][i];
+
+          noInterrupts();
+          _scanSum[_scanBank][i] += raw;
+          _scanCount[_scanBank][i]++;
+          // state takes into account input thresholds, previous state and debounce
+          debounceEdge(c, toLevel(_expansion[0].input[i], c.level, mv), now, _expansion[0].input[i].debounce);
+          interrupts();
+        }
+      }
+      delay(_scanDelay);
+    }
+  }
+
+  /**
+   * Read board inputs from scan results.
+   *
+   * Input voltage is the mean of reads since previous poll.
+   */
+  void readScan() {
+    noInterrupts();
+    uint8_t bank = _scanBank;
+    _scanBank = !bank;
+    interrupts();
+
+    for (uint8_t i = 0; i < 8; i++) {
+      if (_expansion[0].input[i].exists && _expansion[0].input[i].capture == IoCaptureScan) {
+        uint32_t count = _scanCount[bank][i];
+        if (count > 0) {
+          _expansion[0].input[i].voltage = ((uint64_t)_scanSum[bank][i] * IoScanMillivolt + count * IoScanFull / 2) / (count * IoScanFull);
+        }
+        readCapture(i);
+      }
+      _scanSum[bank][i] = 0;
+      _scanCount[bank][i] = 0;
+    }
+  }
+
+  /**
+   * Start board inputs scan thread.
+   */
+  void startScan() {
+    noInterrupts();
+    for (uint8_t i = 0; i < 8; i++) {
+      IoStruct &ios = _expansion[0].input[i];
+      if (ios.exists && ios.capture == IoCapturePoll) {
+        _capture[0][i].mark = micros();
+        ios.capture = IoCaptureScan;
+      }
+    }
+    interrupts();
+
+    // above loop priority not to miss edges
+    static rtos::Thread scanThread(osPriorityAboveNormal);
+    scanThread.start(callback(this, &OptaLinkerIo::scanner));
+
+    monitor.setMessage(LabelIoScan + String(_scanDelay), MonitorSuccess);
+  }
+
+  /**
+   * Apply board input capture mode.
+   *
+   * @param   i   The board input
+   */
+  void attachCapture(uint8_t i) {
+    IoStruct &ios = _expansion[0].input[i];
+    CaptureStruct &c = _capture[0][i];
+    uint8_t edge = (_captureMask >> i) & 1;
+    if (edge == (ios.capture == IoCaptureEdge)) {
+
+      return;
+    }
+
+    if (edge) {
+      pinMode(BoardInputs[i], INPUT);
+      noInterrupts();
+      c.level = digitalRead(BoardInputs[i]) == HIGH;
+      c.counted = c.edges;
+      c.mark = micros();
+      interrupts();
+      attachInterruptParam(digitalPinToInterrupt(BoardInputs[i]), onCapture, CHANGE, &c);
+      ios.capture = IoCaptureEdge;
+    } else {
+      detachInterrupt(digitalPinToInterrupt(BoardInputs[i]));
+      ios.capture = _scanDelay > 0 ? IoCaptureScan : IoCapturePoll;
+    }
+    monitor.setMessage(LabelIoCapture + String(i), edge ? MonitorSuccess : MonitorInfo);
+  }
+
+  /**
+   * Filter an analog measure.
+   *
+   * Fixed point kernel, measures have IoFilterShift fractional bits.
+   *
+   * @param   a   The analog channel
+   * @param   x   The new measure
+   *
+   * @return  The filtered measure
+   */
+  int32_t filterAnalog(AnalogStruct &a, int32_t x) {
+    switch (a.filter) {
+      case IoFilterAverage:
+        if (a.count < a.depth) {
+          a.count++;
+        } else {
+          a.sum -= a.window[a.head];
+        }
+        a.window[a.head] = x;
+        a.sum += x;
+        a.head = (a.head + 1) % a.depth;
+
+        return a.sum / a.count;
+
+      case IoFilterIir:
+        // first sample initializes output
+        if (a.count == 0) {
+          a.count = 1;
+          a.sum = x;
+        } else {
+          a.sum += (x - a.sum) / a.depth;
+        }
+
+        return a.sum;
+
+      default:
+
+        return x;
+    }
+  }
+
+  /**
+   * Scale an analog measure to engineering unit.
+   *
+   * @param   a         The analog channel
+   * @param   measure   The fixed point measure
+   *
+   * @return  The rounded value
+   */
+  int32_t scaleAnalog(AnalogStruct &a, int32_t measure) {
+    if (a.rawMin == a.rawMax) {
+
+      return (measure + (1 << (IoFilterShift - 1))) >> IoFilterShift;
+    }
+
+    int64_t num = ((int64_t)measure - ((int64_t)a.rawMin << IoFilterShift)) * (a.scaleMax - a.scaleMin);
+    int64_t den = (int64_t)(a.rawMax - a.rawMin) << IoFilterShift;
+    // round half away from zero
+    num += (num < 0) == (den < 0) ? den / 2 : -den / 2;
+
+    return a.scaleMin + (int32_t)(num / den);
+  }
+
+  /**
+   * Read an analog expansion channel.
+   *
+   * @param   exp   The analog expansion, inputs already updated
+   * @param   ch    The channel
+   * @param   mode  The channel mode
+   *
+   * @return  The measure in channel mode unit
+   */
+  int32_t readChannel(AnalogExpansion &exp, uint8_t ch, IoAnalogMode mode) {
+    float measure = 0;
+    switch (mode) {
+      case IoAnalogCurrent:
+        measure = exp.pinCurrent(ch, false) * 1000;
+        break;
+
+      case IoAnalogRtd:
+      case IoAnalogRtd2:
+        measure = exp.getRtd(ch) * 10;
+        break;
+
+      default:
+        measure = exp.pinVoltage(ch, false) * 1000;
+    }
+
+    return constrain((int32_t)measure, 0, 65535);
+  }
+
+  /**
+   * Configure an analog expansion channels from their mode.
+   *
+   * @param   e   The expansion
+   */
+  void beginAnalog(uint8_t e) {
+    AnalogExpansion &expAnalog = _analogExpansion[e];
+    if (!expAnalog) {
+
+      return;
+    }
+
+    for (uint8_t ch = 0; ch < OA_AN_CHANNELS_NUM; ch++) {
+      AnalogStruct &a = _analog[e][ch];
+      switch (a.mode) {
+        case IoAnalogCurrent:
+          expAnalog.beginChannelAsCurrentAdc(ch);
+          break;
+
+        case IoAnalogRtd:
+          expAnalog.beginChannelAsRtd(ch, true, 1.2);
+          break;
+
+        case IoAnalogRtd2:
+          expAnalog.beginChannelAsRtd(ch, false, 1.2);
+          break;
+
+        default:
+          expAnalog.beginChannelAsVoltageAdc(ch);
+      }
+      a.count = 0;
+      a.head = 0;
+      a.sum = 0;
+      _expansion[e].input[ch].voltage = 0;
+      _expansion[e].input[ch].value = 0;
+    }
+  }
+
+  /**
+   * Read all channels of an analog expansion.
+   *
+   * Channels are oversampled then filtered, a channel update time is refreshed
+   * only if its measure moves more than OPTALINKER_IO_ANALOG_DEADBAND.
+   *
+   * @param   e   The expansion
+   */
+  void readAnalog(uint8_t e) {
+    AnalogExpansion &expAnalog = _analogExpansion[e];
+    if (!expAnalog) {
+
+      return;
+    }
+
+    int32_t sum[OA_AN_CHANNELS_NUM] = {0};
+    for (uint8_t s = 0; s < _analogOversample; s++) {
+      // Update all channels in one step
+      expAnalog.updateAnalogInputs();
+      for (uint8_t ch = 0; ch < OA_AN_CHANNELS_NUM; ch++) {
+        sum[ch] += readChannel(expAnalog, ch, _analog[e][ch].mode);
+      }
+    }
+
+    for (uint8_t ch = 0; ch < OA_AN_CHANNELS_NUM; ch++) {
+      IoStruct &ios = _expansion[e].input[ch];
+      AnalogStruct &a = _analog[e][ch];
+      int32_t measure = filterAnalog(a, (sum[ch] << IoFilterShift) / _analogOversample);
+      int32_t rounded = (measure + (1 << (IoFilterShift - 1))) >> IoFilterShift;
+      if (ios.exists && abs(rounded - ios.voltage) >= OPTALINKER_IO_ANALOG_DEADBAND) {
+        ios.voltage = rounded;
+        ios.value = scaleAnalog(a, measure);
+        ios.update = state.getTime();
+      }
+    }
+  }
+
+  /**
+   * Memorize all counters as stored.
+   */
+  void setStored() {
+    for (uint8_t e = 0; e < OPTA_CONTROLLER_MAX_EXPANSION_NUM + 1; e++) {
+      for (uint8_t i = 0; i < 24; i++) {
+        IoStruct &ios = i < 16 ? _expansion[e].input[i] : _expansion[e].output[i - 16];
+        for (uint8_t f = 0; f < 5; f++) {
+          _stored[e][i][f] = getIo(ios, IoFieldReset + f);
+        }
+      }
+    }
+  }
+
 public:
-  OptaLinkerIo(OptaLinkerState &_state, OptaLinkerMonitor &_monitor, OptaLinkerBoard &_board, OptaLinkerStore &_store, OptaLinkerConfig &_config) : state(_state), monitor(_monitor), board(_board), store(_store), config(_config) {}
+  OptaLinkerIo(OptaLinkerState &_state, OptaLinkerMonitor &_monitor, OptaLinkerBoard &_board, OptaLinkerStore &_store, OptaLinkerConfig &_config) : state(_state), monitor(_monitor), board(_board), store(_store), config(_config) {
+    // analog channels defaults, they can be changed before setup
+    for (uint8_t e = 0; e < OPTA_CONTROLLER_MAX_EXPANSION_NUM + 1; e++) {
+      for (uint8_t ch = 0; ch < OA_AN_CHANNELS_NUM; ch++) {
+        _analog[e][ch] = { IoAnalogVoltage, (IoFilter)OPTALINKER_IO_ANALOG_FILTER, OPTALINKER_IO_ANALOG_DEPTH, {0}, 0, 0, 0, 0, 0, 0, 0 };
+      }
+    }
+  }
 
   uint8_t setup() {
 
@@ -95,10 +771,33 @@ public:
     readFromFile();
     writeToFile();
 
+    for (uint8_t i = 0; i < 8; i++) {
+      attachCapture(i);
+    }
+    for (uint8_t e = 1; e < _expansionsNum; e++) {
+      if (_expansion[e].type == ExpansionAnalog) {
+        beginAnalog(e);
+      }
+    }
+    if (_scanDelay > 0) {
+      startScan();
+    }
+    _rescanLast = state.getTime();
+
     return 1;
   }
 
   uint8_t loop() {
+    // write outputs set since previous loop
+    commitOutputs();
+
+    // detect expansions hot-plug
+    _isRescan = 0;
+    if ((_rescanDelay > 0) && ((state.getTime() - _rescanLast) > _rescanDelay)) {
+      _rescanLast = state.getTime();
+      _isRescan = rescan();
+    }
+
     _isPoll = 0;
     if ((_pollDelay > 0) && ((_pollLast == 0) || ((state.getTime() - _pollLast) > _pollDelay))) {
       _pollLast = state.getTime();
@@ -108,16 +807,22 @@ public:
     // update inputs
     if (_isPoll) {
 
-      // read board inputs
+      // read board inputs, scanned ones at once
+      if (_scanDelay > 0) {
+        readScan();
+      }
       for (uint8_t i = 0; i < 8; i++) {
-        if (_expansion[0].input[i].exists) {
+        if (_expansion[0].input[i].exists && _expansion[0].input[i].capture == IoCaptureEdge) {
+          readCapture(i);
+        } else if (_expansion[0].input[i].exists && _expansion[0].input[i].capture == IoCapturePoll) {
 
           // analog, convert input state into mV
-          uint16_t ar = (int)(analogRead(BoardInputs[i]) * 10.0 / 4095.0 * 1000);
+          uint16_t ar = (analogRead(BoardInputs[i]) * IoScanMillivolt + IoScanFull / 2) / IoScanFull;
           _expansion[0].input[i].voltage = ar;
 
-          // state, take into account module voltage and previous state, main board is 0~10V
-          uint8_t dr = (!_expansion[0].input[i].state && ar > 6500) || (_expansion[0].input[i].state && ar > 3500);
+          // state, take into account input thresholds, previous state and debounce
+          debounceEdge(_capture[0][i], toLevel(_expansion[0].input[i], _capture[0][i].level, ar), micros(), _expansion[0].input[i].debounce);
+          uint8_t dr = _capture[0][i].level;
 
           // high
           if (dr && _expansion[0].input[i].state) {
@@ -138,6 +843,11 @@ public:
             _expansion[0].input[i].state = dr;
             _expansion[0].input[i].update = state.getTime();
           }
+
+          // rate
+          if (updateRate(_expansion[0].input[i], _capture[0][i])) {
+            _expansion[0].input[i].update = state.getTime();
+          }
         }
       }
 
@@ -151,35 +861,27 @@ public:
       }
 
       // read expansion
-      for (uint8_t n = 0; n < OptaController.getExpansionNum(); n++) {
-        uint8_t e = n + 1;
-        if (_expansion[e].exists && _expansion[e].type != ExpansionAnalog) { // Analog expansion not yet implemented
-
-          DigitalMechExpansion expDmec = OptaController.getExpansion(n); 
-          DigitalStSolidExpansion expDsts = OptaController.getExpansion(n);
+      for (uint8_t e = 1; e < _expansionsNum; e++) {
+        if (_expansion[e].exists && _expansion[e].type == ExpansionAnalog) {
+          readAnalog(e);
+          // output not implemented
+        } else if (_expansion[e].exists && _digital[e]) {
+          DigitalExpansion &expDigital = *_digital[e];
 
           // Update all inputs in one step
-          if (expDmec) {
-            expDmec.updateAnalogInputs();
-          } else if (expDsts) {
-            expDsts.updateAnalogInputs();
-          }
+          expDigital.updateAnalogInputs();
 
           // read input
           for (uint8_t i = 0; i < OPTA_DIGITAL_IN_NUM; i++) {
             if (_expansion[e].input[i].exists) {
 
               // analog (pinVoltage() arg to false as we update all inputs previously)
-              uint16_t ar = 0;
-              if (expDmec) {
-                ar = (uint16_t)(expDmec.pinVoltage(i, false) * 1000);
-              } else if (expDsts) {
-                ar = (uint16_t)(expDsts.pinVoltage(i, false) * 1000);
-              }
+              uint16_t ar = (uint16_t)(expDigital.pinVoltage(i, false) * 1000);
               _expansion[e].input[i].voltage = ar;
 
-              // state, take into account module voltage and previous state, expansions are 0~24V
-              uint8_t dr = (!_expansion[e].input[i].state && ar > 16000) || (_expansion[e].input[i].state && ar > 8000);
+              // state, take into account input thresholds, previous state and debounce
+              debounceEdge(_capture[e][i], toLevel(_expansion[e].input[i], _capture[e][i].level, ar), micros(), _expansion[e].input[i].debounce);
+              uint8_t dr = _capture[e][i].level;
 
               // high
               if (dr && _expansion[e].input[i].state) {
@@ -200,6 +902,11 @@ public:
                 _expansion[e].input[i].state = dr;
                 _expansion[e].input[i].update = state.getTime();
               }
+
+              // rate
+              if (updateRate(_expansion[e].input[i], _capture[e][i])) {
+                _expansion[e].input[i].update = state.getTime();
+              }
             }
           }
 
@@ -213,6 +920,17 @@ public:
           }
         }
       }
+
+      // react to fresh inputs, outputs set from rules and poll callbacks are written on this loop
+      if (_onRules || _onPoll) {
+        if (_onRules) {
+          _onRules();
+        }
+        if (_onPoll) {
+          _onPoll();
+        }
+        commitOutputs();
+      }
     }
 
     // Do not write expansion values to file on startup
@@ -220,12 +938,14 @@ public:
       _storeLast = state.getTime();
     }
 
-    // write expansion values into file every minute
-    if (state.getTime() - _storeLast > 60000) {
+    // append changed expansion values to journal every few seconds, not while a snapshot is queued
+    if (!_storePending && state.getTime() - _storeLast > _storeDelay) {
       _storeLast = state.getTime();
-      uint8_t ret = writeToFile();
 
-      monitor.setMessage(LabelIoStore, ret ? MonitorSuccess : MonitorFail);
+      // journal is full, compact it into a new snapshot
+      if (!writeToJournal()) {
+        writeToFile();
+      }
     }
 
     return 1;
@@ -253,19 +973,113 @@ public:
     return 0;
   }
 
+  /**
+   * Convert Opta controller expansion type to expansion type.
+   *
+   * @param   expType   The Opta controller expansion type
+   *
+   * @return  The expansion type
+   */
+  static ExpansionType toExpansionType(uint8_t expType) {
+    switch (expType) {
+      case EXPANSION_OPTA_DIGITAL_MEC:
+
+        return ExpansionDmec;
+
+      case EXPANSION_OPTA_DIGITAL_STS:
+
+        return ExpansionDsts;
+
+      case EXPANSION_OPTA_ANALOG:
+
+        return ExpansionAnalog;
+
+      default:
+
+        return ExpansionNone;
+    }
+  }
+
+  /**
+   * Reset an expansion slot io and handles to default values.
+   *
+   * @param   e   The expansion
+   */
+  void clearExpansion(uint8_t e) {
+    _expansion[e].exists = 0;
+    _expansion[e].type = ExpansionNone;
+    _digital[e] = nullptr;
+    _analogExpansion[e] = AnalogExpansion();
+    for (uint8_t i = 0; i < getMaxInputNum(); i++) {
+      _expansion[e].input[i] = { 0, toPinId(e, i), i, IoNone, 0, 0, state.getTime(), 0, 0, 0, 0, 0, IoCaptureNone, 0, 0, 0, 0, 0, 0, 0 };
+      _capture[e][i] = { e == 0 && i < 8 ? BoardInputs[i] : 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+    }
+    for (uint8_t i = 0; i < getMaxOutputNum(); i++) {
+      _expansion[e].output[i] = { 0, toPinId(e, i), i, IoNone, 0, 0, state.getTime(), 0, 0, 0, 0, 0, IoCaptureNone, 0, 0, 0, 0, 0, 0, 0 };
+    }
+  }
+
+  /**
+   * Initialize an expansion slot from Opta controller, and resolve its typed handle.
+   *
+   * @param   e   The expansion
+   */
+  void initializeExpansion(uint8_t e) {
+    uint8_t n = e - 1;
+    _expansion[e].exists = 1;
+    _expansion[e].id = e;
+    _expansion[e].type = toExpansionType(OptaController.getExpansionType(n));
+
+    switch (_expansion[e].type) {
+      case ExpansionDmec:
+        _dmec[e] = OptaController.getExpansion(n);
+        _digital[e] = &_dmec[e];
+        break;
+
+      case ExpansionDsts:
+        _dsts[e] = OptaController.getExpansion(n);
+        _digital[e] = &_dsts[e];
+        break;
+
+      case ExpansionAnalog:
+        _analogExpansion[e] = OptaController.getExpansion(n);
+        for (uint8_t i = 0; i < OA_AN_CHANNELS_NUM; i++) {
+          _expansion[e].input[i].exists = 1;
+          _expansion[e].input[i].type = IoAnalog;
+        }
+        // output not implemented
+        break;
+
+      default:
+        _expansion[e].exists = 0;
+    }
+
+    // digital expansions (mech or sts)
+    if (_digital[e]) {
+      for (uint8_t i = 0; i < OPTA_DIGITAL_IN_NUM; i++) {
+        _expansion[e].input[i].exists = 1;
+        _expansion[e].input[i].type = IoDigital;
+        _expansion[e].input[i].capture = IoCapturePoll;
+        resetSettings(_expansion[e].input[i], e);
+      }
+      for (uint8_t i = 0; i < OPTA_DIGITAL_OUT_NUM; i++) {
+        _expansion[e].output[i].exists = 1;
+        _expansion[e].output[i].type = IoRelay;
+      }
+    }
+    _expansion[e].name = getName(e);
+
+    // Display expansion name
+    monitor.setMessage(LabelIoExpansionName + String(e) + ": " + _expansion[e].name, _expansion[e].type == ExpansionNone ? MonitorFail : MonitorSuccess);
+  }
+
   /**
    * Initialize expansion stack.
    */
   void initializeIo() {
     // initialize io by filling in full array with default values
     for(uint8_t e = 0; e < OPTA_CONTROLLER_MAX_EXPANSION_NUM + 1; e++) {
-      _expansion[e].exists = 0;
-      for (uint8_t i = 0; i < getMaxInputNum(); i++) {
-        _expansion[e].input[i] = { 0, toPinId(e, i), i, IoNone, 0, 0, state.getTime(), 0, 0, 0, 0, 0 };
-      }
-      for (uint8_t i = 0; i < getMaxOutputNum(); i++) {
-        _expansion[e].output[i] = { 0, toPinId(e, i), i, IoNone, 0, 0, state.getTime(), 0, 0, 0, 0, 0 };
-      }
+      clearExpansion(e);
     }
 
     // initialize main board io
@@ -276,62 +1090,64 @@ public:
     for (uint8_t i = 0; i < 8; i++) {
       _expansion[0].input[i].exists = 1;
       _expansion[0].input[i].type = IoDigital;
+      _expansion[0].input[i].capture = IoCapturePoll;
+      resetSettings(_expansion[0].input[i], 0);
     }
     for (uint8_t i = 0; i < 4; i++) {
       _expansion[0].output[i].exists = 1;
-      _expansion[0].input[i].type = IoRelay;
+      _expansion[0].output[i].type = IoRelay;
     }
 
     // initialize expansions io
-    for (uint8_t n = 0; n < OptaController.getExpansionNum(); n++) {
-      uint8_t e = n + 1;
-      _expansion[e].exists = 1;
-      _expansion[e].id = e;
-
-      uint8_t expType = OptaController.getExpansionType(n);
-      switch (expType) {
-        case EXPANSION_OPTA_DIGITAL_MEC:
-          _expansion[e].type = ExpansionDmec;
-          for (uint8_t i = 0; i < OPTA_DIGITAL_IN_NUM; i++) {
-            _expansion[e].input[i].exists = 1;
-            _expansion[e].input[i].type = IoDigital;
-          }
-          for (uint8_t i = 0; i < OPTA_DIGITAL_OUT_NUM; i++) {
-            _expansion[e].output[i].exists = 1;
-            _expansion[e].input[i].type = IoRelay;
-          }
-          break;
-
-        case EXPANSION_OPTA_DIGITAL_STS:
-          _expansion[e].type = ExpansionDsts;
-          for (uint8_t i = 0; i < OPTA_DIGITAL_IN_NUM; i++) {
-            _expansion[e].input[i].exists = 1;
-            _expansion[e].input[i].type = IoDigital;
-          }
-          for (uint8_t i = 0; i < OPTA_DIGITAL_OUT_NUM; i++) {
-            _expansion[e].output[i].exists = 1;
-            _expansion[e].input[i].type = IoRelay;
-          }
-          break;
+    for (uint8_t e = 1; e < _expansionsNum; e++) {
+      initializeExpansion(e);
+    }
+  }
 
-        case EXPANSION_OPTA_ANALOG:
-          _expansion[e].type = ExpansionAnalog;
-          for (uint8_t i = 0; i < OA_AN_CHANNELS_NUM; i++) {
-            _expansion[e].input[i].exists = 1;
-            _expansion[e].input[i].type = IoAnalog;
-          }
-          // output not implemented
-          break;
+  /**
+   * Rescan expansions stack, for added, removed or replaced expansions.
+   *
+   * Only changed expansions are rebuilt, others keep their handles and counters.
+   *
+   * @return  Changed expansions as bits, else 0
+   */
+  uint8_t rescan() {
+    OptaController.update();
+    uint8_t num = min(OptaController.getExpansionNum() + 1, OPTA_CONTROLLER_MAX_EXPANSION_NUM + 1);
+    uint8_t changed = 0;
+
+    // io uids of added expansions require them to be counted
+    _expansionsNum = max(_expansionsNum, num);
+    for (uint8_t e = 1; e < OPTA_CONTROLLER_MAX_EXPANSION_NUM + 1; e++) {
+      ExpansionType type = e < num ? toExpansionType(OptaController.getExpansionType(e - 1)) : ExpansionNone;
+      if (type == _expansion[e].type) {
+        continue;
+      }
 
-        default:
-          _expansion[e].exists = 0;
-          _expansion[e].type = ExpansionNone;
+      if (_expansion[e].type != ExpansionNone) {
+        monitor.setMessage(LabelIoUnplug + String(e) + ": " + _expansion[e].name, MonitorWarning);
       }
-      _expansion[e].name = getName(e);
+      changed |= (1 << e);
+      _outputStaged &= ~(1 << e);
+      clearExpansion(e);
+      // journal starts again from this expansion counters, not from the previous one
+      memset(_stored[e], 0xFF, sizeof(_stored[e]));
+      if (e < num) {
+        initializeExpansion(e);
+        if (_expansion[e].type == ExpansionAnalog) {
+          beginAnalog(e);
+        }
+      }
+    }
+    _expansionsNum = num;
 
-      // Display expansion name
-      monitor.setMessage(LabelIoExpansionName + String(e) + ": " + _expansion[e].name, _expansion[e].type == ExpansionNone ? MonitorFail : MonitorSuccess);
+    // keep stored counters in line with new expansions stack
+    if (changed) {
+      monitor.setMessage(LabelIoExpansionNum + String(_expansionsNum - 1), MonitorInfo);
+      writeToFile();
     }
+
+    return changed;
   }
 
   /**
@@ -357,6 +1173,19 @@ public:
       doc["partialPulse"] = ios.partialPulse;
       doc["high"]         = ios.high;
       doc["partialHigh"]  = ios.partialHigh;
+      if (ios.capture != IoCaptureNone) {
+        doc["capture"]    = ios.capture;
+        doc["frequency"]  = ios.frequency;
+        doc["period"]     = ios.period;
+        doc["duty"]       = ios.duty;
+        doc["threshold"]  = ios.threshold;
+        doc["hysteresis"] = ios.hysteresis;
+        doc["debounce"]   = ios.debounce;
+      }
+      if (ios.type == IoAnalog) {
+        doc["mode"]       = _analog[ios.uid / 100][ios.id].mode;
+        doc["value"]      = ios.value;
+      }
     } else {
       doc["exists"] = 0;
     }
@@ -367,77 +1196,379 @@ public:
   /**
    * Write expansion stack to JSON document string.
    *
-   * @return  The JSON String
+   * @return  The JSON String
+   */
+  String writeToJson() {
+    JsonDocument doc;
+    for(uint8_t e = 0; e < _expansionsNum; e++) {
+      if (_expansion[e].exists) {
+        String de = "e" + String(e);
+        doc[de]["type"] = _expansion[e].type;
+        doc[de]["id"] = _expansion[e].id;
+        doc[de]["name"] = _expansion[e].name;
+        for (uint8_t i = 0; i < getMaxInputNum(); i++) {
+          doc[de]["input"][String("i" + String(i))] = writeToJsonIo(_expansion[e].input[i]);
+        }
+        for (uint8_t i = 0; i < getMaxOutputNum(); i++) {
+          doc[de]["output"][String("o" + String(i))] = writeToJsonIo(_expansion[e].output[i]);
+        }
+      }
+    }
+
+    String jsonString;
+    serializeJson(doc, jsonString);
+
+    return jsonString;
+  }
+
+  /**
+   * Read an io from an io JSON document.
+   *
+   * @param   ios   An io instance
+   * @param   doc   An io JSON document
+   */
+  void readFromJsonIo(IoStruct &ios, JsonDocument doc) {
+    if (ios.exists && !doc.isNull()) {
+      //ios.update       = doc["update"].isNull() ? state.getTime() : doc["update"].as<int>();
+      ios.reset        = doc["reset"].isNull() ? 0 : doc["reset"].as<int>();
+      ios.pulse        = doc["pulse"].isNull() ? 0 : doc["pulse"].as<int>();
+      ios.partialPulse = doc["partialPulse"].isNull() ? 0 : doc["partialPulse"].as<int>();
+      ios.high         = doc["high"].isNull() ? 0 : doc["high"].as<int>();
+      ios.partialHigh  = doc["partialHigh"].isNull() ? 0 : doc["partialHigh"].as<int>();
+    }
+  }
+
+  /**
+   * Read expansion stack from a JSON document string.
+   *
+   * @param   buffer  The JSON document buffer
+   * @param   length  The JSON document length
+   *
+   * @return  1 on succes, else 0
+   */
+  uint8_t readFromJson(const char *buffer, size_t length) {
+
+    JsonDocument doc;
+    DeserializationError error = deserializeJson(doc, buffer, length);
+
+    if (error) {
+      monitor.setMessage(LabelConfigJsonReadFail, MonitorWarning);
+
+      return 0;
+    }
+
+    for(uint8_t e = 0; e < _expansionsNum; e++) {
+      if (_expansion[e].exists) {
+        String de = "e" + String(e);
+        // Check if expansion has been changed physicaly
+        if (!doc[de]["type"].isNull() && _expansion[e].type == doc[de]["type"].as<int>()) {
+          for (uint8_t i = 0; i < getMaxInputNum(); i++) {
+            readFromJsonIo(_expansion[e].input[i], doc[de]["input"][String("i" + String(i))]);
+          }
+          for (uint8_t i = 0; i < getMaxOutputNum(); i++) {
+            readFromJsonIo(_expansion[e].output[i], doc[de]["output"][String("o" + String(i))]);
+          }
+        }
+      }
+    }
+
+    return 1;
+  }
+
+  /**
+   * Write digital inputs settings to JSON document string.
+   *
+   * @return  The JSON String
+   */
+  String writeSettingsToJson() {
+    JsonDocument doc;
+    for(uint8_t e = 0; e < _expansionsNum; e++) {
+      for (uint8_t i = 0; i < getMaxInputNum(); i++) {
+        IoStruct &ios = _expansion[e].input[i];
+        if (_expansion[e].exists && ios.exists && ios.capture != IoCaptureNone) {
+          String de = "e" + String(e);
+          String di = "i" + String(i);
+          doc[de][di]["threshold"]  = ios.threshold;
+          doc[de][di]["hysteresis"] = ios.hysteresis;
+          doc[de][di]["debounce"]   = ios.debounce;
+        }
+      }
+    }
+
+    String jsonString;
+    serializeJson(doc, jsonString);
+
+    return jsonString;
+  }
+
+  /**
+   * Read digital inputs settings from a JSON document.
+   *
+   * Settings are under "input" key, missing inputs and fields are left unchanged.
+   * Inputs are written to flash memory if a setting changed.
+   *
+   * @param   buffer  The JSON document buffer
+   * @param   length  The JSON document length
+   *
+   * @return  1 on succes, else 0
+   */
+  uint8_t readSettingsFromJson(const char *buffer, size_t length) {
+    JsonDocument doc;
+    DeserializationError error = deserializeJson(doc, buffer, length);
+
+    if (error) {
+
+      return 0;
+    }
+
+    uint8_t changed = 0;
+    for(uint8_t e = 0; e < _expansionsNum; e++) {
+      for (uint8_t i = 0; i < getMaxInputNum(); i++) {
+        String de = "e" + String(e);
+        String di = "i" + String(i);
+        IoStruct &ios = _expansion[e].input[i];
+        if (!doc["input"][de][di].isNull()) {
+          changed |= setInputThreshold(e, i,
+            doc["input"][de][di]["threshold"].isNull() ? ios.threshold : doc["input"][de][di]["threshold"].as<int>(),
+            doc["input"][de][di]["hysteresis"].isNull() ? ios.hysteresis : doc["input"][de][di]["hysteresis"].as<int>(),
+            doc["input"][de][di]["debounce"].isNull() ? ios.debounce : doc["input"][de][di]["debounce"].as<int>(),
+            false
+          );
+        }
+      }
+    }
+    if (changed) {
+      writeToFile();
+    }
+
+    return 1;
+  }
+
+  /**
+   * Write expansion stack counters to binary record payload.
+   *
+   * @param   buffer    The payload buffer, of IoRecordSize - StoreRecordHeaderLength bytes
+   * @param   sequence  The first journal sequence to replay after this payload
+   *
+   * @return  The payload length
+   */
+  size_t writeToBinary(uint8_t *buffer, uint32_t sequence = 0) {
+    size_t offset = 0;
+
+    buffer[offset++] = _expansionsNum;
+    for (uint8_t e = 0; e < OPTA_CONTROLLER_MAX_EXPANSION_NUM + 1; e++) {
+      buffer[offset++] = e < _expansionsNum && _expansion[e].exists ? _expansion[e].type : ExpansionNone;
+    }
+
+    for (uint8_t e = 0; e < _expansionsNum; e++) {
+      if (_expansion[e].exists) {
+        for (uint8_t i = 0; i < getMaxInputNum(); i++) {
+          offset = appendIo(buffer, offset, _expansion[e].input[i], 0);
+        }
+        for (uint8_t i = 0; i < getMaxOutputNum(); i++) {
+          offset = appendIo(buffer, offset, _expansion[e].output[i], 1);
+        }
+      }
+    }
+    offset = appendEntry(buffer, offset, IoRecordJournal, 0, sequence);
+
+    return offset;
+  }
+
+  /**
+   * Write expansion stack IO states as compact message.
+   *
+   * @param   buffer  The buffer, of IoStateLength bytes
+   *
+   * @return  The message length
+   */
+  size_t writeToState(uint8_t *buffer) {
+    size_t offset = 0;
+
+    for (uint8_t e = 0; e < _expansionsNum; e++) {
+      if (_expansion[e].exists) {
+        uint16_t inputs = 0;
+        uint8_t outputs = 0;
+        for (uint8_t i = 0; i < getMaxInputNum(); i++) {
+          if (_expansion[e].input[i].exists && _expansion[e].input[i].state) {
+            inputs |= (1 << i);
+          }
+        }
+        for (uint8_t i = 0; i < getMaxOutputNum(); i++) {
+          if (_expansion[e].output[i].exists && _expansion[e].output[i].state) {
+            outputs |= (1 << i);
+          }
+        }
+        buffer[offset++] = e;
+        buffer[offset++] = inputs & 0xFF;
+        buffer[offset++] = inputs >> 8;
+        buffer[offset++] = outputs;
+      }
+    }
+
+    return offset;
+  }
+
+  /**
+   * Read an expansion IO states from compact message.
+   *
+   * @param   buffer      The message
+   * @param   length      The message length
+   * @param   expansion   The expansion index
+   * @param   inputs      The inputs states bits to fill in
+   * @param   outputs     The outputs states bits to fill in
+   *
+   * @return  1 if expansion is in message, else 0
+   */
+  uint8_t readFromState(const uint8_t *buffer, size_t length, uint8_t expansion, uint16_t &inputs, uint8_t &outputs) {
+    for (size_t offset = 0; offset + IoStateEntryLength <= length; offset += IoStateEntryLength) {
+      if (buffer[offset] == expansion) {
+        inputs = buffer[offset + 1] | (buffer[offset + 2] << 8);
+        outputs = buffer[offset + 3];
+
+        return 1;
+      }
+    }
+
+    return 0;
+  }
+
+  /**
+   * Get an io from its uid.
+   *
+   * @param   uid       The io uid
+   * @param   isOutput  True if io is an output
+   *
+   * @return  The io instance, or nullptr if it does not exist
    */
-  String writeToJson() {
-    JsonDocument doc;
-    for(uint8_t e = 0; e < _expansionsNum; e++) {
-      if (_expansion[e].exists) {
-        String de = "e" + String(e);
-        doc[de]["type"] = _expansion[e].type;
-        doc[de]["id"] = _expansion[e].id;
-        doc[de]["name"] = _expansion[e].name;
-        for (uint8_t i = 0; i < getMaxInputNum(); i++) {
-          doc[de]["input"][String("i" + String(i))] = writeToJsonIo(_expansion[e].input[i]);
-        }
-        for (uint8_t i = 0; i < getMaxOutputNum(); i++) {
-          doc[de]["output"][String("o" + String(i))] = writeToJsonIo(_expansion[e].output[i]);
-        }
+  IoStruct *getIoByUid(uint16_t uid, uint8_t isOutput) {
+    uint8_t e = uid / 100;
+    uint8_t i = uid % 100;
+    if (e < _expansionsNum && _expansion[e].exists) {
+      if (isOutput && i < getMaxOutputNum() && _expansion[e].output[i].exists) {
+
+        return &_expansion[e].output[i];
       }
-    }
+      if (!isOutput && i < getMaxInputNum() && _expansion[e].input[i].exists) {
 
-    String jsonString;
-    serializeJson(doc, jsonString);
+        return &_expansion[e].input[i];
+      }
+    }
 
-    return jsonString;
+    return nullptr;
   }
 
   /**
-   * Read an io from an io JSON document.
+   * Set an io counter value.
    *
-   * @param   ios   An io instance
-   * @param   doc   An io JSON document
+   * @param   ios     An io instance
+   * @param   field   The io field
+   * @param   value   The io field value
    */
-  void readFromJsonIo(IoStruct &ios, JsonDocument doc) {
-    if (ios.exists && !doc.isNull()) {
-      //ios.update       = doc["update"].isNull() ? state.getTime() : doc["update"].as<int>();
-      ios.reset        = doc["reset"].isNull() ? 0 : doc["reset"].as<int>();
-      ios.pulse        = doc["pulse"].isNull() ? 0 : doc["pulse"].as<int>();
-      ios.partialPulse = doc["partialPulse"].isNull() ? 0 : doc["partialPulse"].as<int>();
-      ios.high         = doc["high"].isNull() ? 0 : doc["high"].as<int>();
-      ios.partialHigh  = doc["partialHigh"].isNull() ? 0 : doc["partialHigh"].as<int>();
+  void setIo(IoStruct &ios, uint8_t field, uint32_t value) {
+    switch (field) {
+      case IoFieldReset:
+        ios.reset = value;
+        break;
+
+      case IoFieldPulse:
+        ios.pulse = value;
+        break;
+
+      case IoFieldPartialPulse:
+        ios.partialPulse = value;
+        break;
+
+      case IoFieldHigh:
+        ios.high = value;
+        break;
+
+      case IoFieldPartialHigh:
+        ios.partialHigh = value;
+        break;
+
+      case IoFieldThreshold:
+        ios.threshold = value;
+        break;
+
+      case IoFieldHysteresis:
+        ios.hysteresis = value;
+        break;
+
+      case IoFieldDebounce:
+        ios.debounce = value;
+        break;
     }
   }
 
   /**
-   * Read expansion stack from a JSON document string.
+   * Read expansion stack counters from binary record payload.
    *
-   * @param   buffer  The JSON document buffer
-   * @param   length  The JSON document length
+   * Counters of an expansion which has been changed physicaly are ignored.
    *
-   * @return  1 on succes, else 0
+   * @param   buffer  The payload buffer
+   * @param   length  The payload length
+   *
+   * @return  1 on success, else 0
    */
-  uint8_t readFromJson(const char *buffer, size_t length) {
+  uint8_t readFromBinary(const uint8_t *buffer, size_t length) {
+    if (length < 1 + (OPTA_CONTROLLER_MAX_EXPANSION_NUM + 1)) {
 
-    JsonDocument doc;
-    DeserializationError error = deserializeJson(doc, buffer, length);
+      return 0;
+    }
 
-    if (error) {
-      monitor.setMessage(LabelConfigJsonReadFail, MonitorWarning);
+    memcpy(_snapshotType, buffer + 1, OPTA_CONTROLLER_MAX_EXPANSION_NUM + 1);
 
-      return 0;
+    size_t offset = 1 + (OPTA_CONTROLLER_MAX_EXPANSION_NUM + 1);
+    while (offset + IoRecordEntryLength <= length) {
+      uint16_t uid = 0;
+      uint32_t value = 0;
+      memcpy(&uid, buffer + offset, 2);
+      uint8_t field = buffer[offset + 2];
+      memcpy(&value, buffer + offset + 3, 4);
+      offset += IoRecordEntryLength;
+
+      if (uid == IoRecordJournal) {
+        _snapshotSequence = value;
+        continue;
+      }
+
+      uint8_t e = uid / 100;
+      if (e > OPTA_CONTROLLER_MAX_EXPANSION_NUM || buffer[1 + e] != _expansion[e].type) {
+        continue;
+      }
+
+      IoStruct *ios = getIoByUid(uid, field & IoRecordOutput);
+      if (ios != nullptr) {
+        setIo(*ios, field & ~IoRecordOutput, value);
+      }
     }
 
-    for(uint8_t e = 0; e < _expansionsNum; e++) {
+    return 1;
+  }
+
+  /**
+   * Append changed expansion stack counters to flash memory journal.
+   *
+   * Nothing is written if no counter changed.
+   * If journal is busy, remaining counters are written on next call.
+   *
+   * @return  1 on success (or busy), else 0 if journal must be compacted
+   */
+  uint8_t writeToJournal() {
+    uint8_t ret = 1;
+    for (uint8_t e = 0; e < _expansionsNum; e++) {
       if (_expansion[e].exists) {
-        String de = "e" + String(e);
-        // Check if expansion has been changed physicaly
-        if (!doc[de]["type"].isNull() && _expansion[e].type == doc[de]["type"].as<int>()) {
-          for (uint8_t i = 0; i < getMaxInputNum(); i++) {
-            readFromJsonIo(_expansion[e].input[i], doc[de]["input"][String("i" + String(i))]);
+        for (uint8_t i = 0; i < getMaxInputNum(); i++) {
+          if ((ret = journalIo(_expansion[e].input[i], _stored[e][i], 0)) != 1) {
+
+            return ret;
           }
-          for (uint8_t i = 0; i < getMaxOutputNum(); i++) {
-            readFromJsonIo(_expansion[e].output[i], doc[de]["output"][String("o" + String(i))]);
+        }
+        for (uint8_t i = 0; i < getMaxOutputNum(); i++) {
+          if ((ret = journalIo(_expansion[e].output[i], _stored[e][16 + i], 1)) != 1) {
+
+            return ret;
           }
         }
       }
@@ -449,23 +1580,89 @@ public:
   /**
    * Write expansion stack to flash memory.
    *
+   * Counters are stored as a binary snapshot written by flash writer thread,
+   * then journal starts again on a new sector. JSON is only used for export.
+   *
    * @return  1 on success, else 0
    */
   uint8_t writeToFile() {
-    String str = writeToJson();
+    _storeSequence = store.getJournalSequence() + 1;
+    size_t length = writeToBinary(_record + StoreRecordHeaderLength, _storeSequence);
+    _storePending++;
+    uint8_t ret = store.queueRecord("io", _record, IoRecordSchema, length, callback(this, &OptaLinkerIo::onStore));
+    // callback is called only once for a replaced request
+    if (ret != 1) {
+      _storePending--;
+    }
+    if (ret) {
+      setStored();
+    }
+
+    return ret ? 1 : 0;
+  }
+
+  /**
+   * Snapshot write callback.
+   *
+   * Journal sectors are reused only once snapshot is written.
+   *
+   * @param   ret   The write result
+   */
+  void onStore(uint8_t ret) {
+    if (ret) {
+      // without journal, fall back to a snapshot every minute
+      if (!store.startJournal(_storeSequence)) {
+        _storeDelay = 60000;
+      }
+    } else {
+      // force all counters to be written again
+      memset(_stored, 0xFF, sizeof(_stored));
+    }
+    if (_storePending > 0) {
+      _storePending--;
+    }
 
-    return store.writeKey("io", str.c_str());
+    monitor.setMessage(LabelIoStore, ret ? MonitorSuccess : MonitorFail);
   }
 
   /**
    * Read expansion stack from flash memory.
    *
+   * Journal entries written after the snapshot are replayed.
+   * Counters written as JSON by previous firmware are imported once.
+   *
    * @return 1 on success, else 0
    */
   uint8_t readFromFile() {
-    String str = store.readKey("io");
+    uint16_t schema = 0;
+    uint8_t ret = 0;
+    int32_t length = store.readRecord("io", _record, sizeof(_record), schema);
+    if (length >= 0) {
+      ret = readFromBinary(_record + StoreRecordHeaderLength, length);
+    } else {
+      OptaLinkerStoreValue value = store.readKey("io");
+
+      return value.c_str()[0] == '{' ? readFromJson(value.c_str(), value.length()) : 0;
+    }
 
-    return readFromJson(str.c_str(), str.length());
+    // journal entries belong to the expansions of the snapshot
+    uint16_t uid, count = 0;
+    uint8_t field;
+    uint32_t value;
+    store.rewindJournal(_snapshotSequence);
+    while (store.readJournal(uid, field, value)) {
+      uint8_t e = uid / 100;
+      if (e <= OPTA_CONTROLLER_MAX_EXPANSION_NUM && _snapshotType[e] == _expansion[e].type) {
+        IoStruct *ios = getIoByUid(uid, field & IoRecordOutput);
+        if (ios != nullptr) {
+          setIo(*ios, field & ~IoRecordOutput, value);
+          count++;
+        }
+      }
+    }
+    monitor.setMessage(LabelIoJournal + String(count), MonitorInfo);
+
+    return ret;
   }
 
   /**
@@ -548,6 +1745,34 @@ public:
       case IoFieldPartialHigh:
         rsp = ios.partialHigh;
         break;
+
+      case IoFieldFrequency:
+        rsp = ios.frequency;
+        break;
+
+      case IoFieldPeriod:
+        rsp = ios.period;
+        break;
+
+      case IoFieldDuty:
+        rsp = ios.duty;
+        break;
+
+      case IoFieldValue:
+        rsp = ios.value;
+        break;
+
+      case IoFieldThreshold:
+        rsp = ios.threshold;
+        break;
+
+      case IoFieldHysteresis:
+        rsp = ios.hysteresis;
+        break;
+
+      case IoFieldDebounce:
+        rsp = ios.debounce;
+        break;
     }
 
     return rsp;
@@ -648,7 +1873,8 @@ public:
   /**
    * Set an output value.
    *
-   * Only digital output is implemented
+   * Only digital output is implemented.
+   * Output is staged, outputs of an expansion are written together on next io loop or commitOutputs().
    *
    * @param   expansion   The expansion num
    * @param   output      The output num
@@ -659,26 +1885,6 @@ public:
     if (expansion < _expansionsNum && output < 8 && _expansion[expansion].exists && _expansion[expansion].output[output].exists) {
       // only if state change
       if (value != _expansion[expansion].output[output].state) {
-        // main board
-        if (expansion == 0) {
-          digitalWrite(BoardOutputs[output], value);
-          digitalWrite(BoardOutputsLeds[output], value);
-        // Digital mech expansion
-        } else if (_expansion[expansion].type == ExpansionDmec) {
-          DigitalMechExpansion expDmec = OptaController.getExpansion(expansion - 1);
-          expDmec.digitalWrite(expansion - 1, value ? HIGH : LOW, true);
-          expDmec.updateDigitalOutputs();
-          //expDmec.switchLedOn(expansion - 1, value ? HIGH : LOW, true);
-          //expDmec.updateLeds();
-        // Digital sts expansion
-        } else if (_expansion[expansion].type == ExpansionDmec) {
-          DigitalStSolidExpansion expDsts = OptaController.getExpansion(expansion - 1);
-          expDsts.digitalWrite(expansion - 1, value ? HIGH : LOW, true);
-          expDsts.updateDigitalOutputs();
-          //expDsts.switchLedOn(expansion - 1, value ? HIGH : LOW, true);
-          //expDsts.updateLeds();
-        }
-
         // pulse
         if (value && !_expansion[expansion].output[output].state) {
           _expansion[expansion].output[output].pulse++;
@@ -687,12 +1893,83 @@ public:
 
         _expansion[expansion].output[output].state = value;
         _expansion[expansion].output[output].update = state.getTime();
+        _outputStaged |= (1 << expansion);
 
         monitor.setMessage(String("[O") + expansion + "." + output+ "] => " + value + ", " + _expansion[expansion].output[output].pulse + " pulses, " + _expansion[expansion].output[output].high + "ms high", MonitorInfo);
       }
     }
   }
 
+  /**
+   * Set a group of outputs of an expansion at once.
+   *
+   * Outputs switch together, in one bus transaction for an expansion.
+   * Ex: setOutputs(1, 0b1111, 0b0101) sets O1.0 and O1.2 on, O1.1 and O1.3 off.
+   *
+   * @param   expansion   The expansion num
+   * @param   mask        The outputs to set, as bits
+   * @param   values      The outputs values, as bits
+   */
+  void setOutputs(uint8_t expansion, uint8_t mask, uint8_t values) {
+    for (uint8_t o = 0; o < getMaxOutputNum(); o++) {
+      if ((mask >> o) & 1) {
+        setOutput(expansion, o, (values >> o) & 1);
+      }
+    }
+    commitOutputs();
+  }
+
+  /**
+   * Get outputs states of an expansion.
+   *
+   * @param   expansion   The expansion num
+   *
+   * @return  The outputs states, as bits
+   */
+  uint8_t getOutputs(uint8_t expansion) {
+    uint8_t values = 0;
+    if (expansion < _expansionsNum && _expansion[expansion].exists) {
+      for (uint8_t o = 0; o < getMaxOutputNum(); o++) {
+        if (_expansion[expansion].output[o].exists && _expansion[expansion].output[o].state) {
+          values |= (1 << o);
+        }
+      }
+    }
+
+    return values;
+  }
+
+  /**
+   * Write staged outputs, once per expansion.
+   */
+  void commitOutputs() {
+    if (!_outputStaged) {
+
+      return;
+    }
+
+    for (uint8_t e = 0; e < _expansionsNum; e++) {
+      if (!((_outputStaged >> e) & 1)) {
+        continue;
+      }
+
+      // main board
+      if (e == 0) {
+        for (uint8_t o = 0; o < 4; o++) {
+          digitalWrite(BoardOutputs[o], _expansion[0].output[o].state);
+          digitalWrite(BoardOutputsLeds[o], _expansion[0].output[o].state);
+        }
+      // Digital expansions (mech or sts)
+      } else if (_digital[e]) {
+        for (uint8_t o = 0; o < OPTA_DIGITAL_OUT_NUM; o++) {
+          _digital[e]->digitalWrite(o, _expansion[e].output[o].state ? HIGH : LOW, false);
+        }
+        _digital[e]->updateDigitalOutputs();
+      }
+    }
+    _outputStaged = 0;
+  }
+
   /**
    * Get human readable expansion name.
    *
@@ -737,6 +2014,184 @@ public:
     monitor.setMessage(LabelIoPoll + String(delay), MonitorSuccess);
   }
 
+  /**
+   * Set a callback called on each poll once inputs are read.
+   *
+   * Outputs set from callback are written on the same loop.
+   * Rules module uses its own hook, this callback is free for sketch.
+   *
+   * @param   poll   The callback
+   */
+  void attachPoll(Callback<void()> poll) {
+    _onPoll = poll;
+  }
+
+  /**
+   * Set rules module callback called on each poll once inputs are read.
+   *
+   * This is reserved for rules module, sketch uses attachPoll().
+   *
+   * @param   rules   The callback
+   */
+  void attachRules(Callback<void()> rules) {
+    _onRules = rules;
+  }
+
+  /**
+   * Set expansions rescan delay.
+   *
+   * @param   delay  The expansions rescan delay in ms, 0 to disable hot-plug
+   */
+  void setRescanDelay(uint32_t delay) {
+    _rescanDelay = delay;
+  }
+
+  /**
+   * Set board input edge capture mode.
+   *
+   * In this mode, input edges are timestamped by pin interrupt instead of being polled,
+   * so fast pulses are all counted, and input voltage is not read.
+   *
+   * @param   input   The board input num
+   * @param   enable  1 for edge capture, 0 for poll
+   */
+  void setCapture(uint8_t input, uint8_t enable) {
+    if (input < 8) {
+      _captureMask = enable ? _captureMask | (1 << input) : _captureMask & ~(1 << input);
+
+      // after setup
+      if (_expansionsNum > 0) {
+        attachCapture(input);
+      }
+    }
+  }
+
+  /**
+   * Set analog expansion channel mode.
+   *
+   * Input voltage field is then the channel measure in mV, uA or 0.1 ohm.
+   *
+   * @param   expansion   The expansion num
+   * @param   channel     The channel num
+   * @param   mode        The channel mode
+   */
+  void setAnalogMode(uint8_t expansion, uint8_t channel, IoAnalogMode mode) {
+    if (expansion > 0 && expansion <= OPTA_CONTROLLER_MAX_EXPANSION_NUM && channel < OA_AN_CHANNELS_NUM) {
+      _analog[expansion][channel].mode = mode;
+
+      // after setup
+      if (expansion < _expansionsNum && _expansion[expansion].type == ExpansionAnalog) {
+        beginAnalog(expansion);
+      }
+      monitor.setMessage(LabelIoAnalog + String(expansion) + "." + channel + ": " + mode, MonitorInfo);
+    }
+  }
+
+  /**
+   * Get analog expansion channel mode.
+   *
+   * @param   expansion   The expansion num
+   * @param   channel     The channel num
+   *
+   * @return  The channel mode
+   */
+  IoAnalogMode getAnalogMode(uint8_t expansion, uint8_t channel) {
+
+    return expansion <= OPTA_CONTROLLER_MAX_EXPANSION_NUM && channel < OA_AN_CHANNELS_NUM ? _analog[expansion][channel].mode : IoAnalogVoltage;
+  }
+
+  /**
+   * Set analog expansion channel filter.
+   *
+   * @param   expansion   The expansion num
+   * @param   channel     The channel num
+   * @param   filter      The filter type
+   * @param   depth       The filter depth, 1~IoFilterDepth samples
+   */
+  void setAnalogFilter(uint8_t expansion, uint8_t channel, IoFilter filter, uint8_t depth) {
+    if (expansion > 0 && expansion <= OPTA_CONTROLLER_MAX_EXPANSION_NUM && channel < OA_AN_CHANNELS_NUM) {
+      AnalogStruct &a = _analog[expansion][channel];
+      a.filter = filter;
+      a.depth = constrain(depth, (uint8_t)1, IoFilterDepth);
+      a.count = 0;
+      a.head = 0;
+      a.sum = 0;
+    }
+  }
+
+  /**
+   * Set analog expansion channel scale to engineering unit.
+   *
+   * Ex: 4~20mA transmitter of 0~250 bar: setAnalogScale(1, 0, 4000, 20000, 0, 250)
+   *
+   * @param   expansion   The expansion num
+   * @param   channel     The channel num
+   * @param   rawMin      The measure at scale min, in channel mode unit
+   * @param   rawMax      The measure at scale max, in channel mode unit
+   * @param   scaleMin    The value at measure min
+   * @param   scaleMax    The value at measure max
+   */
+  void setAnalogScale(uint8_t expansion, uint8_t channel, int32_t rawMin, int32_t rawMax, int32_t scaleMin, int32_t scaleMax) {
+    if (expansion > 0 && expansion <= OPTA_CONTROLLER_MAX_EXPANSION_NUM && channel < OA_AN_CHANNELS_NUM) {
+      AnalogStruct &a = _analog[expansion][channel];
+      a.rawMin = rawMin;
+      a.rawMax = rawMax;
+      a.scaleMin = scaleMin;
+      a.scaleMax = scaleMax;
+    }
+  }
+
+  /**
+   * Set analog expansions oversampling.
+   *
+   * @param   samples   The reads averaged on each poll, 1~16
+   */
+  void setAnalogOversample(uint8_t samples) {
+    _analogOversample = constrain(samples, (uint8_t)1, (uint8_t)16);
+  }
+
+  /**
+   * Set a digital input state detection settings.
+   *
+   * Input is high above threshold, and low again at threshold - hysteresis,
+   * once level is stable for debounce time. Thresholds do not apply in edge capture mode.
+   *
+   * @param   expansion   The expansion num
+   * @param   input       The input num
+   * @param   threshold   The low to high threshold in mV
+   * @param   hysteresis  The hysteresis in mV, up to threshold
+   * @param   debounce    The debounce time in ms
+   * @param   save        True to write inputs to flash memory
+   *
+   * @return  1 if settings changed, else 0
+   */
+  uint8_t setInputThreshold(uint8_t expansion, uint8_t input, uint16_t threshold, uint16_t hysteresis, uint16_t debounce, uint8_t save = true) {
+    if (expansion >= _expansionsNum || input >= getMaxInputNum() || !_expansion[expansion].exists) {
+
+      return 0;
+    }
+
+    IoStruct &ios = _expansion[expansion].input[input];
+    hysteresis = min(hysteresis, threshold);
+    if (!ios.exists || ios.capture == IoCaptureNone
+      || (ios.threshold == threshold && ios.hysteresis == hysteresis && ios.debounce == debounce)
+    ) {
+
+      return 0;
+    }
+
+    ios.threshold = threshold;
+    ios.hysteresis = hysteresis;
+    ios.debounce = debounce;
+    monitor.setMessage(LabelIoThreshold + String(expansion) + "." + input + ": " + threshold + "mV, " + hysteresis + "mV, " + debounce + "ms", MonitorInfo);
+
+    if (save) {
+      writeToFile();
+    }
+
+    return 1;
+  }
+
   /**
    * Check if it is itme to poll io
    *
@@ -747,6 +2202,16 @@ public:
     return _isPoll;
   }
 
+  /**
+   * Check if expansions changed on this loop rescan.
+   *
+   * @return  Changed expansions as bits, else 0
+   */
+  uint8_t isRescan() {
+
+    return _isRescan;
+  }
+
 }; // class OptaLinkerIo
 
 } // namespace optalinker
@@ -151,8 +151,6 @@ private:
    */
   void setServerRegisters() {
     _updateLast = state.getTime() + 1;
-    uint16_t offset = 0;
-    ExpansionStruct *expansion = io.getExpansions();
 
     // Address
     setRegisterUint16(ModbusRegisterAddress + ModbusRegisterAddressExpansionLength, ModbusRegisterExpansionLength);
@@ -166,6 +164,9 @@ private:
     setRegisterUint16(ModbusRegisterAddress + ModbusRegisterAddressRs485, ModbusRegisterRs485);
     setRegisterUint16(ModbusRegisterAddress + ModbusRegisterAddressModbus, ModbusRegisterModbus);
     setRegisterUint16(ModbusRegisterAddress + ModbusRegisterAddressMqtt, ModbusRegisterMqtt);
+    setRegisterUint16(ModbusRegisterAddress + ModbusRegisterAddressInputRate, ModbusRegisterInputRate);
+    setRegisterUint16(ModbusRegisterAddress + ModbusRegisterAddressInputValue, ModbusRegisterInputValue);
+    setRegisterUint16(ModbusRegisterAddress + ModbusRegisterAddressInputSettings, ModbusRegisterInputSettings);
 
     // Firmware
     setRegisterUint16(ModbusRegisterFirmware + ModbusRegisterVersionMajor, version.getMajor());
@@ -208,29 +209,38 @@ private:
     setRegisterString(ModbusRegisterMqtt + ModbusRegisterMqttPassword, String("")); // Do not expose mqtt password
     setRegisterString(ModbusRegisterMqtt + ModbusRegisterMqttBase, config.getMqttBase());
 
-    // Expansions
+    // Expansions, inputs and outputs
     for (uint8_t e = 0; e < io.getExpansionsNum(); e++) {
-      offset = ModbusRegisterExpansion + (e * ModbusRegisterExpansionLength);
-      setRegisterUint16(offset + ModbusRegisterExpansionExists, expansion[e].exists);
-      setRegisterUint16(offset + ModbusRegisterExpansionId, expansion[e].id);
-      setRegisterUint16(offset + ModbusRegisterExpansionType, expansion[e].type);
-      setRegisterString(offset + ModbusRegisterExpansionName, expansion[e].name);
+      setRegisterExpansion(e);
     }
+  }
+
+  /**
+   * Update local modbus server registers block of an expansion.
+   *
+   * @param   e   The expansion
+   */
+  void setRegisterExpansion(uint8_t e) {
+    ExpansionStruct *expansion = io.getExpansions();
+    uint16_t offset = ModbusRegisterExpansion + (e * ModbusRegisterExpansionLength);
+    setRegisterUint16(offset + ModbusRegisterExpansionExists, expansion[e].exists);
+    setRegisterUint16(offset + ModbusRegisterExpansionId, expansion[e].id);
+    setRegisterUint16(offset + ModbusRegisterExpansionType, expansion[e].type);
+    setRegisterString(offset + ModbusRegisterExpansionName, expansion[e].name);
 
     // Inputs
-    for (uint8_t e = 0; e < io.getExpansionsNum(); e++) {
-      for(uint8_t i = 0; i < io.getMaxInputNum(); i++) {
-        setRegisterIo(ModbusRegisterInput + (e * ModbusRegisterIoLength) + (i * ModbusRegisterIoLength), expansion[e].input[i], 1);
-        //max 6*16*20
-      }
+    for(uint8_t i = 0; i < io.getMaxInputNum(); i++) {
+      setRegisterIo(ModbusRegisterInput + (e * ModbusRegisterIoLength) + (i * ModbusRegisterIoLength), expansion[e].input[i], 1);
+      setRegisterRate(e, i, expansion[e].input[i]);
+      setRegisterValue(e, i, expansion[e].input[i]);
+      setRegisterSettings(e, i, expansion[e].input[i]);
+      //max 6*16*20
     }
 
     // Output
-    for (uint8_t e = 0; e < io.getExpansionsNum(); e++) {
-      for(uint8_t i = 0; i < io.getMaxOutputNum(); i++) {
-        setRegisterIo(ModbusRegisterOutput + (e * ModbusRegisterIoLength) + (i * ModbusRegisterIoLength), expansion[e].output[i], 0);
-        //max 6*8*20
-      }
+    for(uint8_t i = 0; i < io.getMaxOutputNum(); i++) {
+      setRegisterIo(ModbusRegisterOutput + (e * ModbusRegisterIoLength) + (i * ModbusRegisterIoLength), expansion[e].output[i], 0);
+      //max 6*8*20
     }
   }
 
@@ -263,6 +273,51 @@ private:
     }
   }
 
+  /**
+   * Update local modbus server input rate registers.
+   *
+   * @param   expansion   The expansion num
+   * @param   input       The input num
+   * @param   ios         The IO structure
+   */
+  void setRegisterRate(uint8_t expansion, uint8_t input, IoStruct ios) {
+    uint16_t offset = ModbusRegisterInputRate + (((expansion * io.getMaxInputNum()) + input) * ModbusRegisterRateLength);
+    setRegisterUint32(offset + ModbusRegisterRateFrequency, ios.frequency);
+    setRegisterUint32(offset + ModbusRegisterRatePeriod, ios.period);
+    setRegisterUint16(offset + ModbusRegisterRateDuty, ios.duty);
+  }
+
+  /**
+   * Update local modbus server input value registers.
+   *
+   * Value saturates at -65535 and 65535, the range of T3 registers.
+   *
+   * @param   expansion   The expansion num
+   * @param   input       The input num
+   * @param   ios         The IO structure
+   */
+  void setRegisterValue(uint8_t expansion, uint8_t input, IoStruct ios) {
+    uint16_t offset = ModbusRegisterInputValue + (((expansion * io.getMaxInputNum()) + input) * ModbusRegisterValueLength);
+    setRegisterInt16(offset + ModbusRegisterValueValue, constrain(ios.value, (int32_t)-65535, (int32_t)65535));
+    setRegisterUint16(offset + ModbusRegisterValueMode, ios.type == IoAnalog ? io.getAnalogMode(expansion, input) : 0);
+  }
+
+  /**
+   * Update local modbus server input settings registers.
+   *
+   * Settings are not updated on inputs changes, not to overwrite holding registers being configured.
+   *
+   * @param   expansion   The expansion num
+   * @param   input       The input num
+   * @param   ios         The IO structure
+   */
+  void setRegisterSettings(uint8_t expansion, uint8_t input, IoStruct ios) {
+    uint16_t offset = ModbusRegisterInputSettings + (((expansion * io.getMaxInputNum()) + input) * ModbusRegisterSettingsLength);
+    setRegisterUint16(offset + ModbusRegisterSettingsThreshold, ios.threshold);
+    setRegisterUint16(offset + ModbusRegisterSettingsHysteresis, ios.hysteresis);
+    setRegisterUint16(offset + ModbusRegisterSettingsDebounce, ios.debounce);
+  }
+
   /**
    * Parser received holding registers.
    */
@@ -330,11 +385,29 @@ private:
       }
       config.setMqttBase(getHoldingRegisterString(ModbusRegisterMqtt + ModbusRegisterMqttBase));
 
-      // Write config and reboot
+      // Inputs settings, written with inputs
+      uint8_t changed = 0;
+      ExpansionStruct *expansion = io.getExpansions();
+      for (uint8_t e = 0; e < io.getExpansionsNum(); e++) {
+        for(uint8_t i = 0; i < io.getMaxInputNum(); i++) {
+          uint16_t offset = ModbusRegisterInputSettings + (((e * io.getMaxInputNum()) + i) * ModbusRegisterSettingsLength);
+          changed |= io.setInputThreshold(e, i,
+            getHoldingRegisterUint16(offset + ModbusRegisterSettingsThreshold),
+            getHoldingRegisterUint16(offset + ModbusRegisterSettingsHysteresis),
+            getHoldingRegisterUint16(offset + ModbusRegisterSettingsDebounce),
+            false
+          );
+          setRegisterSettings(e, i, expansion[e].input[i]);
+        }
+      }
+      if (changed) {
+        io.writeToFile();
+      }
+
+      // Write config and apply it
       delay(10);
       config.writeToFile();
-      io.writeToFile();
-      board.reboot();
+      config.setApply();
 
     }
   }
@@ -590,6 +663,13 @@ public:
 
       ExpansionStruct *expansion = io.getExpansions();
 
+      // Rebuild registers blocks of expansions changed on rescan, including removed ones
+      for (uint8_t e = 1; io.isRescan() && e < OPTA_CONTROLLER_MAX_EXPANSION_NUM + 1; e++) {
+        if ((io.isRescan() >> e) & 1) {
+          setRegisterExpansion(e);
+        }
+      }
+
       /*
        * Update Io <=> modbus
        */
@@ -604,6 +684,8 @@ public:
             if (expansion[e].input[i].update >= _updateLast) {
               //monitor.setMessagge("Modbus registers update input " + String(expansion[e].input[i].uid) + " starting at offset " + offset, MonitorInfo);
               setRegisterIo(offset, expansion[e].input[i], 1);
+              setRegisterRate(e, i, expansion[e].input[i]);
+              setRegisterValue(e, i, expansion[e].input[i]);
               setDiscreteInput(expansion[e].input[i].uid, expansion[e].input[i].state);
             }
 
@@ -646,6 +728,8 @@ public:
           }
         }
       }
+      // coils written together (FC15) switch together
+      io.commitOutputs();
       _updateLast = state.getTime();
 
       // Check if "End of configuration" is received from HoldingRegisters
@@ -657,6 +741,24 @@ public:
     return 1;
   }
 
+  uint8_t reconfigure(uint16_t changes) {
+    // Modbus mode, server ID and serial port are only set on begin
+    if ((changes & ConfigChangeModbus)
+      || ((changes & ConfigChangeDeviceId) && (isRtuServer() || isTcpServer()))
+      || ((changes & ConfigChangeRs485) && (isRtuServer() || isRtuClient()))
+    ) {
+
+      return 0;
+    }
+
+    // Update configuration registers
+    if (changes != ConfigChangeNone && (isRtuServer() || isTcpServer())) {
+      setServerRegisters();
+    }
+
+    return 1;
+  }
+
   uint8_t isRtuClient() {
 
     return config.getModbusType() == ModbusRtuClient ? 1 : 0;
@@ -88,6 +88,19 @@ private:
    */
   MqttClient _genericClient = nullptr;
 
+  /**
+   * RS485 bridge buffer.
+   */
+  uint8_t _rs485Buffer[MqttRs485Batch];
+
+  /**
+   * RS485 bridge counters.
+   */
+  uint32_t _rs485Published = 0;
+  uint32_t _rs485Batched = 0;
+  uint32_t _rs485Commands = 0;
+  uint32_t _rs485Rejected = 0;
+
   /**
    * Last LED change time.
    */
@@ -159,9 +172,37 @@ private:
     _genericClient.subscribe(_baseTopic + "input/reset/#");
     monitor.setMessage(LabelMqttSubscribe + _baseTopic + "input/reset/#", MonitorInfo);
 
+    // subscribe to messages to write on RS485
+    if (config.getRs485ToMqtt()) {
+      _genericClient.subscribe(_baseTopic + "rs485/set");
+      monitor.setMessage(LabelMqttSubscribe + _baseTopic + "rs485/set", MonitorInfo);
+    }
+
     publishDevice();
   }
 
+  /**
+   * Check if a string is a number from 0 to 255.
+   *
+   * @param   value   The string
+   *
+   * @return  1 if valid, else 0
+   */
+  uint8_t isByte(const String &value) {
+    if (value.length() == 0 || value.length() > 3) {
+
+      return 0;
+    }
+    for (uint8_t i = 0; i < value.length(); i++) {
+      if (!isdigit(value[i])) {
+
+        return 0;
+      }
+    }
+
+    return value.toInt() <= 255 ? 1 : 0;
+  }
+
   /**
    * Parse received message.
    *
@@ -187,6 +228,20 @@ private:
     ExpansionStruct *expansion = io.getExpansions();
     for (uint8_t e = 0; e < io.getExpansionsNum(); e++) {
       if (expansion[e].exists) {
+        // set outputs group state, payload is "mask,values" as bits
+        if (topic.equals(_baseTopic + "output/group/" + String(e))) {
+          int separator = payload.indexOf(',');
+          String mask = payload.substring(0, separator);
+          String values = payload.substring(separator + 1);
+          if (separator > 0 && payload.indexOf(',', separator + 1) < 0 && isByte(mask) && isByte(values)) {
+            monitor.setMessage("Setting from MQTT outputs group " + String(e) + " to " + payload, MonitorSuccess);
+
+            io.setOutputs(e, mask.toInt(), values.toInt());
+          } else {
+            monitor.setMessage("Invalid MQTT outputs group " + String(e) + " payload: " + payload, MonitorFail);
+          }
+        }
+
         for (uint8_t i = 0; i < 16; i++) {
 
           if (expansion[e].input[i].exists) {
@@ -198,7 +253,7 @@ private:
             }
           }
 
-          if (expansion[e].output[i].exists) {
+          if (i < io.getMaxOutputNum() && expansion[e].output[i].exists) {
             // reset output state
             if (topic.equals(_baseTopic + "output/reset/" + String(expansion[e].output[i].id))) {
               monitor.setMessage("Resetting from MQTT output " + String(expansion[e].output[i].id), MonitorSuccess);
@@ -218,6 +273,74 @@ private:
     }
   }
 
+  /**
+   * Write received message to RS485.
+   *
+   * Message is read as bytes, too long message is dropped.
+   *
+   * @param   size  The MQTT payload size
+   */
+  void receiveRs485(int size) {
+    int length = _genericClient.read(_rs485Buffer, min((size_t)size, sizeof(_rs485Buffer)));
+    while (_genericClient.available() > 0) {
+      _genericClient.read();
+    }
+    _rs485Commands++;
+
+    if (length != size || !rs485.send(_rs485Buffer, length)) {
+      _rs485Rejected++;
+    }
+  }
+
+  /**
+   * Publish RS485 received frames.
+   *
+   * A single frame is published as is to rs485 topic,
+   * several queued frames are published together to rs485/batch topic.
+   */
+  void publishRs485() {
+    if (!config.getRs485ToMqtt() || !rs485.incoming()) {
+
+      return;
+    }
+
+    if (rs485.available() == 1) {
+      int16_t length = rs485.readFrame(_rs485Buffer, sizeof(_rs485Buffer));
+      if (length >= 0) {
+        publishBinary(_baseTopic + "rs485", _rs485Buffer, length);
+        _rs485Published++;
+      }
+
+      return;
+    }
+
+    size_t offset = 0;
+    while (rs485.incoming() && offset + 2 + Rs485FrameSize <= sizeof(_rs485Buffer)) {
+      int16_t length = rs485.readFrame(_rs485Buffer + offset + 2, Rs485FrameSize);
+      _rs485Buffer[offset] = length & 0xFF;
+      _rs485Buffer[offset + 1] = length >> 8;
+      offset += 2 + length;
+      _rs485Published++;
+    }
+    publishBinary(_baseTopic + "rs485/batch", _rs485Buffer, offset);
+    _rs485Batched++;
+  }
+
+  /**
+   * Publish RS485 bridge counters.
+   */
+  void publishRs485Statistics() {
+    if (config.getRs485ToMqtt()) {
+      publishMessage(_baseTopic + "rs485/stats/published", String(_rs485Published));
+      publishMessage(_baseTopic + "rs485/stats/batched", String(_rs485Batched));
+      publishMessage(_baseTopic + "rs485/stats/dropped", String(rs485.getDropped()));
+      publishMessage(_baseTopic + "rs485/stats/overflow", String(rs485.getOverflow()));
+      publishMessage(_baseTopic + "rs485/stats/commands", String(_rs485Commands));
+      publishMessage(_baseTopic + "rs485/stats/rejected", String(_rs485Rejected));
+      publishMessage(_baseTopic + "rs485/stats/sendDropped", String(rs485.getSendDropped()));
+    }
+  }
+
   /**
    * Publish to MQTT io topics.
    *
@@ -241,6 +364,14 @@ private:
           publishMessage(topic + "high/" + idTopic, String(ios.high));
           publishMessage(topic + "partialHigh/" + idTopic, String(ios.partialHigh));
         }
+        if (ios.capture != IoCaptureNone) {
+          publishMessage(topic + "frequency/" + idTopic, String(ios.frequency));
+          publishMessage(topic + "period/" + idTopic, String(ios.period));
+          publishMessage(topic + "duty/" + idTopic, String(ios.duty));
+        }
+        if (ios.type == IoAnalog) {
+          publishMessage(topic + "value/" + idTopic, String(ios.value));
+        }
 
       } else if (state.getTime() - _lastStatistic > 60000) {
         // Refresh timer every minutes
@@ -292,6 +423,21 @@ public:
         publishInputs();
       }
 
+      // Write all io values of expansions added on rescan
+      if (io.isRescan()) {
+        ExpansionStruct *expansion = io.getExpansions();
+        for (uint8_t e = 1; e < io.getExpansionsNum(); e++) {
+          if (((io.isRescan() >> e) & 1) && expansion[e].exists) {
+            for (uint8_t i = 0; i < 16; i++) {
+              publishIo(_baseTopic + "input/", expansion[e].input[i], true);
+            }
+            for (uint8_t i = 0; i < 8; i++) {
+              publishIo(_baseTopic + "output/", expansion[e].output[i], true);
+            }
+          }
+        }
+      }
+
       // Write changed inputs values to MQTT
       if (io.isPoll()) {
         ExpansionStruct *expansion = io.getExpansions();
@@ -309,6 +455,7 @@ public:
         // every minute publish "high" stats
         if (state.getTime() - _lastStatistic > 60000) {
           _lastStatistic = state.getTime();
+          publishRs485Statistics();
         }
       }
 
@@ -316,18 +463,20 @@ public:
       int rspSize = _genericClient.parseMessage();
       if (rspSize) {
         String rspTopic = _genericClient.messageTopic();
-        String rspPayload = "";
-        for (int index = 0; index < rspSize; index++) {
-          rspPayload += (char)_genericClient.read();
-        }
+        if (config.getRs485ToMqtt() && rspTopic == _baseTopic + "rs485/set") {
+          receiveRs485(rspSize);
+        } else {
+          String rspPayload = "";
+          for (int index = 0; index < rspSize; index++) {
+            rspPayload += (char)_genericClient.read();
+          }
 
-        receiveMessage(rspTopic, rspPayload);
+          receiveMessage(rspTopic, rspPayload);
+        }
       }
 
-      // Write rs485 incoming message to MQTT
-      if (config.getRs485ToMqtt() && rs485.incoming()) {
-        publishMessage(_baseTopic + "rs485", rs485.received());
-      }
+      // Write rs485 incoming frames to MQTT
+      publishRs485();
 
     }
 
@@ -351,6 +500,41 @@ public:
     return 1;
   }
 
+  uint8_t reconfigure(uint16_t changes) {
+    if (changes & (ConfigChangeMqtt | ConfigChangeDeviceId)) {
+      uint8_t isNone = config.getMqttIp().toString().equals("0.0.0.0");
+
+      // A disabled module can not be re-enabled
+      if (!isEnabled()) {
+
+        return isNone ? 1 : 0;
+      }
+
+      // Drop connection, next loop connects again with new settings
+      _genericClient.stop();
+      _isConnected = 0;
+      _lastRetry = 0;
+      _baseTopic = config.getMqttBase() + config.getDeviceId() + "/";
+
+      if (isNone) {
+        disable();
+      }
+    }
+
+    // Follow RS485 to MQTT switch on current connection
+    if ((changes & ConfigChangeRs485) && isConnected()) {
+      if (config.getRs485ToMqtt()) {
+        _genericClient.subscribe(_baseTopic + "rs485/set");
+        monitor.setMessage(LabelMqttSubscribe + _baseTopic + "rs485/set", MonitorInfo);
+      } else {
+        _genericClient.unsubscribe(_baseTopic + "rs485/set");
+        monitor.setMessage(LabelMqttUnsubscribe + _baseTopic + "rs485/set", MonitorInfo);
+      }
+    }
+
+    return 1;
+  }
+
   /**
    * Check if it is conected to MQTT server.
    */
@@ -396,6 +580,29 @@ public:
     return 0;
   }
 
+  /**
+   * Publish a binary message.
+   *
+   * Message is not retained.
+   *
+   * @param   topic     The topic to publish to
+   * @param   buffer    The message bytes
+   * @param   length    The message length
+   *
+   * @return  1 on success, else 0
+   */
+  uint8_t publishBinary(String topic, const uint8_t *buffer, size_t length) {
+    if(isConnected()) {
+      _genericClient.beginMessage(topic, (unsigned long)length, false, 1);
+      _genericClient.write(buffer, length);
+      _genericClient.endMessage();
+
+      return 1;
+    }
+
+    return 0;
+  }
+
   /**
    * Publish all device informations.
    */
@@ -300,6 +300,12 @@ public:
     return 1;
   }
 
+  uint8_t reconfigure(uint16_t changes) {
+
+    // Network connection can not be changed live
+    return changes & ConfigChangeNetwork ? 0 : 1;
+  }
+
   /**
    * Set network connection retry delay.
    *
@@ -11,7 +11,9 @@
 #ifndef OPTALINKER_RS485_H
 #define OPTALINKER_RS485_H
 
+#include <mbed.h>
 #include <ArduinoRS485.h>
+#include <MbedCRC.h>
 
 #include "OptaLinkerModule.h"
 
@@ -25,6 +27,16 @@ class OptaLinkerConfig;
  * OptaLinker Library RS485 module.
  *
  * Manage RS485 transmissions.
+ *
+ * Serial port receive buffer is filled by UART interrupt,
+ * a receiver thread drains it every millisecond and splits bytes into frames.
+ * Completed frames are queued until they are read.
+ *
+ * With binary framing, frames are addressed packets checked by CRC,
+ * device address is configuration device id.
+ *
+ * Sent messages are queued and written by a transmitter thread,
+ * with an idle gap between frames.
  */
 class OptaLinkerRs485 : public OptaLinkerModule {
 
@@ -34,7 +46,523 @@ private:
   OptaLinkerConfig &config;
 
   uint8_t _sleep = 1;
-  String _received = "";
+  rtos::Mutex _txMutex;
+  volatile uint8_t _portOpen = 0;
+  uint32_t _txLast = 0;
+
+  /**
+   * Send request.
+   */
+  struct SendRequest {
+    uint16_t length;
+    uint8_t destination;
+    uint8_t sequence;
+    uint8_t ack;
+    uint8_t data[Rs485PacketHeader + Rs485PacketPayload + 4];
+  };
+
+  /**
+   * Send queue.
+   *
+   * Request at tail is kept until it is sent.
+   */
+  SendRequest _sendQueue[Rs485SendQueue];
+  uint8_t _sendHead = 0;
+  uint8_t _sendTail = 0;
+
+  /**
+   * Send queue lock and pending requests counter.
+   */
+  rtos::Mutex _sendMutex;
+  rtos::Semaphore _sendSemaphore{0};
+
+  /**
+   * Number of messages dropped because send queue is full, or not acknowledged.
+   */
+  uint32_t _sendDropped = 0;
+  uint32_t _sendFailed = 0;
+
+  /**
+   * Received frames queue.
+   *
+   * Receiver thread writes at head, reader reads at tail.
+   * Frame at head is the one being received.
+   */
+  Rs485Frame _frames[Rs485FrameQueue];
+  volatile uint8_t _frameHead = 0;
+  volatile uint8_t _frameTail = 0;
+
+  /**
+   * Frame being received state.
+   */
+  uint16_t _frameExpected = 0;
+  uint8_t _frameSkip = 0;
+  uint8_t _frameSync = 0;
+  uint32_t _frameLast = 0;
+
+  /**
+   * Framing settings.
+   */
+  Rs485Framing _framing = Rs485FramingDelimiter;
+  uint8_t _delimiter = '\n';
+  uint32_t _idleGap = 0;
+
+  /**
+   * Number of frames dropped because queue is full, or too long.
+   */
+  uint32_t _dropped = 0;
+  uint32_t _overflow = 0;
+
+  /**
+   * Binary packets state.
+   */
+  uint8_t _sequence = 0;
+  uint8_t _lastSource = 0;
+  uint8_t _lastSequence = 0;
+  volatile uint8_t _ackReceived = 0;
+  volatile uint8_t _ackSource = 0;
+  volatile uint8_t _ackSequence = 0;
+  uint32_t _corrupted = 0;
+  uint32_t _retries = 0;
+
+  /**
+   * Get idle gap from baudrate.
+   *
+   * This is 3.5 chars of 10 bits, at least 2ms as receiver runs every millisecond.
+   *
+   * @return  The idle gap in us
+   */
+  uint32_t getDefaultIdleGap() {
+
+    return max((uint32_t)(35000000UL / config.getRs485Baudrate()), (uint32_t)2000);
+  }
+
+  /**
+   * Receiver thread loop.
+   */
+  void receiver() {
+    while (1) {
+      if (isListening()) {
+        receive();
+      }
+      delay(1);
+    }
+  }
+
+  /**
+   * Read all bytes available on serial port.
+   *
+   * This is skipped while port is restarted, framing is changed or port is used by transmitter.
+   */
+  void receive() {
+    if (!_portOpen || !_txMutex.trylock()) {
+
+      return;
+    }
+
+    uint32_t now = micros();
+    int c;
+    while (_portOpen && RS485.available() > 0 && (c = RS485.read()) != -1) {
+      _frameLast = now;
+      pushByte((uint8_t)c);
+    }
+
+    // End frame on idle gap, delimiter frame is ended after 1s as partial frame
+    Rs485Frame &frame = _frames[_frameHead];
+    if ((frame.length > 0 || _frameExpected > 0 || _frameSkip || _frameSync)
+      && now - _frameLast > (_framing == Rs485FramingDelimiter ? 1000000 : _idleGap)
+    ) {
+      if (_framing == Rs485FramingBinary) {
+        // incomplete packet
+        if (frame.length > 0) {
+          _corrupted++;
+        }
+        resetFrame();
+      } else if (_framing == Rs485FramingLength) {
+        // incomplete length prefixed frame
+        _overflow++;
+        resetFrame();
+      } else {
+        endFrame();
+      }
+    }
+    _txMutex.unlock();
+  }
+
+  /**
+   * Add a received byte to current frame.
+   *
+   * @param   c   The byte
+   */
+  void pushByte(uint8_t c) {
+    Rs485Frame &frame = _frames[_frameHead];
+
+    if (_framing == Rs485FramingBinary) {
+      pushPacketByte(c);
+
+      return;
+    }
+
+    if (_framing == Rs485FramingDelimiter && c == _delimiter) {
+      endFrame();
+
+      return;
+    }
+
+    // First byte is frame length
+    if (_framing == Rs485FramingLength && frame.length == 0 && _frameExpected == 0) {
+      _frameExpected = c;
+
+      return;
+    }
+
+    // Frame too long, skip it till its end
+    if (frame.length >= Rs485FrameSize) {
+      if (!_frameSkip) {
+        _overflow++;
+      }
+      _frameSkip = 1;
+
+      return;
+    }
+    frame.data[frame.length++] = c;
+
+    if (_framing == Rs485FramingLength && frame.length == _frameExpected) {
+      endFrame();
+    }
+  }
+
+  /**
+   * Queue current frame.
+   */
+  void endFrame() {
+    Rs485Frame &frame = _frames[_frameHead];
+
+    // Remove CR from CRLF line
+    if (_framing == Rs485FramingDelimiter && _delimiter == '\n' && frame.length > 0 && frame.data[frame.length - 1] == '\r') {
+      frame.length--;
+    }
+
+    if (frame.length > 0 && !_frameSkip) {
+      frame.source = 0;
+      frame.type = Rs485PacketData;
+      queueFrame();
+    }
+    resetFrame();
+  }
+
+  /**
+   * Move current frame to queue.
+   */
+  void queueFrame() {
+    uint8_t next = (_frameHead + 1) % Rs485FrameQueue;
+    if (next == _frameTail) {
+      _dropped++;
+    } else {
+      _frameHead = next;
+    }
+  }
+
+  /**
+   * Reset current frame.
+   */
+  void resetFrame() {
+    _frames[_frameHead].length = 0;
+    _frameExpected = 0;
+    _frameSkip = 0;
+    _frameSync = 0;
+  }
+
+  /**
+   * Add a received byte to current binary packet.
+   *
+   * @param   c   The byte
+   */
+  void pushPacketByte(uint8_t c) {
+    Rs485Frame &frame = _frames[_frameHead];
+
+    // Wait for sync bytes
+    if (_frameSync < 2) {
+      if (c == (_frameSync ? Rs485PacketSync1 : Rs485PacketSync0)) {
+        _frameSync++;
+      } else {
+        _frameSync = c == Rs485PacketSync0 ? 1 : 0;
+      }
+
+      return;
+    }
+
+    frame.data[frame.length++] = c;
+
+    // Header received, get packet length
+    if (frame.length == Rs485PacketHeader) {
+      if (frame.data[4] > Rs485PacketPayload) {
+        _corrupted++;
+        resetFrame();
+
+        return;
+      }
+      _frameExpected = Rs485PacketHeader + frame.data[4] + 2;
+    }
+
+    if (_frameExpected > 0 && frame.length == _frameExpected) {
+      endPacket();
+    }
+  }
+
+  /**
+   * Check and queue current binary packet.
+   */
+  void endPacket() {
+    Rs485Frame &frame = _frames[_frameHead];
+    uint8_t destination = frame.data[0];
+    uint8_t source = frame.data[1];
+    uint8_t type = frame.data[2];
+    uint8_t sequence = frame.data[3];
+    uint8_t length = frame.data[4];
+    uint16_t crc = frame.data[Rs485PacketHeader + length] | (frame.data[Rs485PacketHeader + length + 1] << 8);
+
+    if (crc != getPacketCheck(frame.data, Rs485PacketHeader + length)) {
+      _corrupted++;
+      resetFrame();
+
+      return;
+    }
+
+    // Not for this device, or its own packet
+    if ((destination != Rs485PacketBroadcast && destination != config.getDeviceId()) || source == config.getDeviceId()) {
+      resetFrame();
+
+      return;
+    }
+
+    if ((type & ~Rs485PacketAckRequest) == Rs485PacketAck) {
+      _ackSource = source;
+      _ackSequence = sequence;
+      _ackReceived = 1;
+      resetFrame();
+
+      return;
+    }
+
+    if ((type & Rs485PacketAckRequest) && destination != Rs485PacketBroadcast) {
+      transmitPacket(source, Rs485PacketAck, sequence, nullptr, 0);
+    }
+
+    // Packet sent again as acknowledge was lost
+    if (source == _lastSource && sequence == _lastSequence) {
+      resetFrame();
+
+      return;
+    }
+    _lastSource = source;
+    _lastSequence = sequence;
+
+    frame.source = source;
+    frame.type = type & ~Rs485PacketAckRequest;
+    frame.length = length;
+    memmove(frame.data, frame.data + Rs485PacketHeader, length);
+    queueFrame();
+    resetFrame();
+  }
+
+  /**
+   * Get binary packet CRC.
+   *
+   * @param   buffer  The packet from destination
+   * @param   length  The length to check
+   *
+   * @return  The CRC16
+   */
+  uint16_t getPacketCheck(const uint8_t *buffer, size_t length) {
+    MbedCRC<POLY_16BIT_CCITT, 16> ct;
+    uint32_t crc = 0;
+    ct.compute(buffer, length, &crc);
+
+    return crc;
+  }
+
+  /**
+   * Write a binary packet to buffer.
+   *
+   * @param   buffer        The buffer, of Rs485PacketHeader + Rs485PacketPayload + 4 bytes
+   * @param   destination   The destination address
+   * @param   type          The packet type, with flags
+   * @param   sequence      The packet sequence
+   * @param   payload       The payload
+   * @param   length        The payload length
+   *
+   * @return  The packet length
+   */
+  size_t writePacket(uint8_t *buffer, uint8_t destination, uint8_t type, uint8_t sequence, const uint8_t *payload, uint8_t length) {
+    size_t offset = 0;
+
+    buffer[offset++] = Rs485PacketSync0;
+    buffer[offset++] = Rs485PacketSync1;
+    buffer[offset++] = destination;
+    buffer[offset++] = config.getDeviceId();
+    buffer[offset++] = type;
+    buffer[offset++] = sequence;
+    buffer[offset++] = length;
+    if (length > 0) {
+      memcpy(buffer + offset, payload, length);
+      offset += length;
+    }
+    uint16_t crc = getPacketCheck(buffer + 2, offset - 2);
+    buffer[offset++] = crc & 0xFF;
+    buffer[offset++] = crc >> 8;
+
+    return offset;
+  }
+
+  /**
+   * Write a binary packet on serial port.
+   *
+   * This does not use send queue.
+   *
+   * @param   destination   The destination address
+   * @param   type          The packet type, with flags
+   * @param   sequence      The packet sequence
+   * @param   payload       The payload
+   * @param   length        The payload length
+   *
+   * @return  1 on success, else 0
+   */
+  uint8_t transmitPacket(uint8_t destination, uint8_t type, uint8_t sequence, const uint8_t *payload, uint8_t length) {
+    uint8_t buffer[Rs485PacketHeader + Rs485PacketPayload + 4];
+
+    return transmit(buffer, writePacket(buffer, destination, type, sequence, payload, length));
+  }
+
+  /**
+   * Write bytes on serial port.
+   *
+   * This waits for idle gap since previous frame.
+   * Receiver is disabled while transmitting to not read back own bytes.
+   * Driver enables line driver before and disables it once last byte is sent.
+   *
+   * @param   buffer  The bytes
+   * @param   length  The bytes length
+   *
+   * @return  1 on success, else 0 if port is closed
+   */
+  uint8_t transmit(const uint8_t *buffer, size_t length) {
+    _txMutex.lock();
+    if (!_portOpen) {
+      _txMutex.unlock();
+
+      return 0;
+    }
+    _sleep = 0;
+
+    while (micros() - _txLast < _idleGap) {
+      delay(1);
+    }
+
+    RS485.noReceive();
+    RS485.beginTransmission();
+    RS485.write(buffer, length);
+    RS485.endTransmission();
+    if (isListening()) {
+      RS485.receive();
+    }
+    _txLast = micros();
+
+    _sleep = 1;
+    _txMutex.unlock();
+
+    return 1;
+  }
+
+  /**
+   * Transmitter thread loop.
+   */
+  void transmitter() {
+    while (1) {
+      _sendSemaphore.acquire();
+
+      _sendMutex.lock();
+      SendRequest &request = _sendQueue[_sendTail];
+      _sendMutex.unlock();
+
+      if (!transmitRequest(request)) {
+        _sendFailed++;
+      }
+
+      _sendMutex.lock();
+      _sendTail = (_sendTail + 1) % Rs485SendQueue;
+      _sendMutex.unlock();
+    }
+  }
+
+  /**
+   * Write a send request on serial port.
+   *
+   * With acknowledge, this waits for destination acknowledge
+   * and retries up to Rs485PacketRetry times.
+   *
+   * @param   request   The send request
+   *
+   * @return  1 if sent (and acknowledged), else 0
+   */
+  uint8_t transmitRequest(SendRequest &request) {
+    // Packet and acknowledge transmission times, in ms
+    uint32_t timeout = (request.length + Rs485PacketHeader + 4) * 10000UL / config.getRs485Baudrate() + Rs485PacketAckTimeout;
+
+    for (uint8_t retry = 0; retry <= (request.ack ? Rs485PacketRetry : 0); retry++) {
+      if (retry > 0) {
+        _retries++;
+      }
+      _ackReceived = 0;
+      if (!transmit(request.data, request.length)) {
+
+        // port closed by reconfiguration, request is dropped
+        return 0;
+      }
+      if (!request.ack) {
+
+        return 1;
+      }
+
+      uint32_t start = millis();
+      while (millis() - start < timeout) {
+        if (_ackReceived && _ackSource == request.destination && _ackSequence == request.sequence) {
+
+          return 1;
+        }
+        delay(1);
+      }
+    }
+
+    return 0;
+  }
+
+  /**
+   * Get a free send request.
+   *
+   * Send queue must be locked.
+   *
+   * @return  The request, or nullptr if queue is full
+   */
+  SendRequest *getSendRequest() {
+    if ((_sendHead + 1) % Rs485SendQueue == _sendTail) {
+      _sendDropped++;
+
+      return nullptr;
+    }
+
+    return &_sendQueue[_sendHead];
+  }
+
+  /**
+   * Add request got from getSendRequest() to send queue.
+   *
+   * Send queue must be locked.
+   */
+  void queueSendRequest() {
+    _sendHead = (_sendHead + 1) % Rs485SendQueue;
+    _sendSemaphore.release();
+  }
 
   /**
    * Prepare RS485 transmission.
@@ -61,13 +589,59 @@ public:
 
     RS485.begin(config.getRs485Baudrate());
     prepare();
-    //RS485.receive();
+    if (_idleGap == 0) {
+      _idleGap = getDefaultIdleGap();
+    }
+    if (isListening()) {
+      RS485.receive();
+    }
+    _portOpen = 1;
+
+    // Start receiver, above loop priority not to miss bytes
+    resetFrame();
+    static rtos::Thread rs485Thread(osPriorityAboveNormal);
+    rs485Thread.start(callback(this, &OptaLinkerRs485::receiver));
+
+    static rtos::Thread rs485SendThread(osPriorityNormal);
+    rs485SendThread.start(callback(this, &OptaLinkerRs485::transmitter));
 
     board.pingTimeout();
 
     return 1;
   }
 
+  uint8_t reconfigure(uint16_t changes) {
+    if ((changes & ConfigChangeRs485) && !board.isLite() && !board.isNone()) {
+
+      // A disabled module can not be re-enabled
+      if (!isEnabled()) {
+
+        return config.getRs485Type() == Rs485None ? 1 : 0;
+      }
+
+      // Restart port with new baudrate, it stays closed if type is none.
+      // Receiver and transmitter threads do not use port while it is closed
+      _txMutex.lock();
+      _portOpen = 0;
+      RS485.end();
+      if (config.getRs485Type() != Rs485None) {
+        monitor.setMessage(LabelRs485Setup + String(config.getRs485Baudrate()), MonitorAction);
+
+        RS485.begin(config.getRs485Baudrate());
+        prepare();
+        _idleGap = getDefaultIdleGap();
+        if (isListening()) {
+          RS485.receive();
+        }
+        resetFrame();
+        _portOpen = 1;
+      }
+      _txMutex.unlock();
+    }
+
+    return 1;
+  }
+
   /**
    * Check if board is setup as RS485 receiver.
    *
@@ -88,6 +662,18 @@ public:
     return isEnabled() && config.getRs485Type() == Rs485Sender ? 1 : 0;
   }
 
+  /**
+   * Check if board reads RS485 port.
+   *
+   * With binary framing, both sender and receiver read port.
+   *
+   * @return  1 if listening, else 0
+   */
+  uint8_t isListening() {
+
+    return isReceiver() || (isSender() && _framing == Rs485FramingBinary) ? 1 : 0;
+  }
+
   /**
    * Check if RS port is not used.
    *
@@ -99,100 +685,270 @@ public:
   }
 
   /**
-   * Grab incoming message.
+   * Set received frames delimitation.
+   *
+   * @param   framing     The framing type (Rs485Framing)
+   * @param   delimiter   The frame end char, for delimiter framing
+   * @param   idleGap     The idle gap in us, 0 for default from baudrate
+   */
+  void setFraming(Rs485Framing framing, uint8_t delimiter = '\n', uint32_t idleGap = 0) {
+    // Receiver thread does not use frame state while it is changed
+    _txMutex.lock();
+    _framing = framing;
+    _delimiter = delimiter;
+    _idleGap = idleGap > 0 ? idleGap : getDefaultIdleGap();
+    resetFrame();
+
+    if (_portOpen && isListening()) {
+      RS485.receive();
+    }
+    _txMutex.unlock();
+  }
+
+  /**
+   * Check if a frame is received.
    *
-   * @return  1 if a message arrives, else 0
+   * This does not block.
+   *
+   * @return  1 if a frame is queued, else 0
    */
   uint8_t incoming() {
-    if (isReceiver() && isSleeping()) {
 
-      _sleep = 0;
-      RS485.receive();
-      if (RS485.available() > 0) {
-        char r_message[40]; // Max message size is 40
-        int r_index = 0;
-        uint32_t wait = millis() + 5;
-        while (1) {
-          delay(50); // Wait for more incoming data
-          int r_int = RS485.read();
-
-          // Check if we goes faster than serial
-          if (r_int != -1) {
-            char r_char = (char) (byte) r_int;
-
-            // Check end of message // TODO: end char choice
-            if (r_char == '\n' || r_char == '\r') {
-              r_message[r_index] = '\0';
-
-              break;
-            }
-
-            r_message[r_index] = r_char;
-            r_index++;
-          } else {
-            // force stop reading after 150 ms
-            if (millis() - wait > 1000) {//watchdog.getTimeout()) {
-              //monitor.setMessage("Receiving partial RS485 message", MonitorWarning);
-              r_message[r_index] = '\0';
-
-              break;
-            }
-          }
-        }
-        board.pingTimeout();
-        RS485.noReceive();
+    return isListening() && _frameTail != _frameHead ? 1 : 0;
+  }
 
-        if (r_index) {
-          _received = String(r_message);
-          _sleep = 1;
+  /**
+   * Get number of queued frames.
+   *
+   * @return  The number of frames
+   */
+  uint8_t available() {
 
-          return 1;
-        }
-      }
-      _sleep = 1;
+    return (_frameHead + Rs485FrameQueue - _frameTail) % Rs485FrameQueue;
+  }
+
+  /**
+   * Read and remove next received frame.
+   *
+   * @param   buffer  The buffer to fill in
+   * @param   size    The buffer size, longer frame is truncated
+   *
+   * @return  The frame length, else -1 if there is no frame
+   */
+  int16_t readFrame(uint8_t *buffer, size_t size) {
+
+    return readPacket(nullptr, nullptr, buffer, size);
+  }
+
+  /**
+   * Read and remove next received binary packet.
+   *
+   * @param   source  The source address to fill in, or nullptr
+   * @param   type    The packet type to fill in (Rs485Packet), or nullptr
+   * @param   buffer  The buffer to fill in with payload
+   * @param   size    The buffer size, longer payload is truncated
+   *
+   * @return  The payload length, else -1 if there is no packet
+   */
+  int16_t readPacket(uint8_t *source, uint8_t *type, uint8_t *buffer, size_t size) {
+    if (_frameTail == _frameHead) {
+
+      return -1;
     }
 
-    return 0;
+    Rs485Frame &frame = _frames[_frameTail];
+    if (source != nullptr) {
+      *source = frame.source;
+    }
+    if (type != nullptr) {
+      *type = frame.type;
+    }
+    uint16_t length = min((size_t)frame.length, size);
+    memcpy(buffer, frame.data, length);
+    _frameTail = (_frameTail + 1) % Rs485FrameQueue;
+
+    return length;
   }
 
   /**
    * Get received message.
    *
+   * Read and remove next received frame.
+   *
    * @return  The received message as String
    */
   String received() {
-    String ret = "";
-    if (_received.length()) {
-      ret = _received;
-      _received = "";
+    char buffer[Rs485FrameSize + 1];
+    int16_t length = readFrame((uint8_t *)buffer, Rs485FrameSize);
+    if (length < 0) {
+
+      return "";
+    }
+    buffer[length] = '\0';
+
+    return String(buffer);
+  }
+
+  /**
+   * Get number of frames dropped because queue was full.
+   *
+   * @return  The number of frames
+   */
+  uint32_t getDropped() {
+
+    return _dropped;
+  }
+
+  /**
+   * Get number of frames dropped because they were too long or incomplete.
+   *
+   * @return  The number of frames
+   */
+  uint32_t getOverflow() {
+
+    return _overflow;
+  }
+
+  /**
+   * Get number of binary packets dropped on bad CRC or incomplete.
+   *
+   * @return  The number of packets
+   */
+  uint32_t getCorrupted() {
+
+    return _corrupted;
+  }
+
+  /**
+   * Get number of binary packets sent again on missing acknowledge.
+   *
+   * @return  The number of retries
+   */
+  uint32_t getRetries() {
+
+    return _retries;
+  }
+
+  /**
+   * Get number of messages dropped because send queue was full.
+   *
+   * @return  The number of messages
+   */
+  uint32_t getSendDropped() {
+
+    return _sendDropped;
+  }
+
+  /**
+   * Get number of binary packets not acknowledged after retries.
+   *
+   * @return  The number of packets
+   */
+  uint32_t getSendFailed() {
+
+    return _sendFailed;
+  }
+
+  /**
+   * Get number of messages waiting in send queue.
+   *
+   * @return  The number of messages
+   */
+  uint8_t getSendPending() {
+    _sendMutex.lock();
+    uint8_t pending = (_sendHead + Rs485SendQueue - _sendTail) % Rs485SendQueue;
+    _sendMutex.unlock();
+
+    return pending;
+  }
+
+  /**
+   * Send a binary packet.
+   *
+   * Packet is queued, this does not block.
+   * With acknowledge, transmitter waits for destination acknowledge
+   * and retries up to Rs485PacketRetry times, see getSendFailed().
+   *
+   * @param   destination   The destination address, Rs485PacketBroadcast for all
+   * @param   type          The packet type (Rs485Packet)
+   * @param   payload       The payload
+   * @param   length        The payload length, up to Rs485PacketPayload
+   * @param   ack           Request acknowledge, ignored on broadcast
+   *
+   * @return  1 if packet queued, else 0
+   */
+  uint8_t sendPacket(uint8_t destination, uint8_t type, const uint8_t *payload, uint8_t length, uint8_t ack = 0) {
+    if (!isListening() || _framing != Rs485FramingBinary || length > Rs485PacketPayload) {
+
+      return 0;
     }
 
-    return ret;
+    ack = ack && destination != Rs485PacketBroadcast ? 1 : 0;
+
+    _sendMutex.lock();
+    SendRequest *request = getSendRequest();
+    if (request == nullptr) {
+      _sendMutex.unlock();
+
+      return 0;
+    }
+    request->destination = destination;
+    request->sequence = ++_sequence;
+    request->ack = ack;
+    request->length = writePacket(request->data, destination, type | (ack ? Rs485PacketAckRequest : 0), request->sequence, payload, length);
+    queueSendRequest();
+    _sendMutex.unlock();
+
+    return 1;
   }
 
   /**
    * Send a message.
    *
+   * Message is queued, this does not block.
+   *
    * @param   The message to send as string
    *
-   * @return  1 if message send, else 0 (and you must retry)
+   * @return  1 if message queued, else 0 (and you must retry)
    */
   uint8_t send(String msg) {
-    if (isSender() && isSleeping()) {
-      //monitor.setMessage("Sending RS485 message", MonitorInfo);
 
-      _sleep = 0;
+    return send((const uint8_t *)msg.c_str(), msg.length());
+  }
 
-      RS485.beginTransmission();
-      RS485.print(msg);
-      RS485.endTransmission();
+  /**
+   * Send raw bytes.
+   *
+   * Bytes are queued, this does not block.
+   * Receiver can also send, it stops reading port while sending.
+   *
+   * @param   buffer  The bytes
+   * @param   length  The bytes length
+   *
+   * @return  1 if bytes queued, else 0 (and you must retry)
+   */
+  uint8_t send(const uint8_t *buffer, size_t length) {
+    if ((!isSender() && !isReceiver()) || length == 0 || length > sizeof(_sendQueue[0].data)) {
 
-      _sleep = 1;
+      return 0;
+    }
 
-      return 1;
+    _sendMutex.lock();
+    SendRequest *request = getSendRequest();
+    if (request == nullptr) {
+      _sendMutex.unlock();
+
+      return 0;
     }
+    request->destination = Rs485PacketBroadcast;
+    request->sequence = 0;
+    request->ack = 0;
+    request->length = length;
+    memcpy(request->data, buffer, length);
+    queueSendRequest();
+    _sendMutex.unlock();
 
-    return 0;
+    return 1;
   }
 
 }; // class OptaLinkerRs485
@@ -0,0 +1,745 @@
+/*
+ * OptaLinker
+ *
+ * Author: Jean-Christian Paul Denis
+ * Source: https://github.com/JcDenis/OptaLinker
+ *
+ * @see OptaLinker.h
+ * @see README.md file
+ */
+
+#ifndef OPTALINKER_RULES_H
+#define OPTALINKER_RULES_H
+
+#include <ArduinoJson.h>
+
+#include "OptaLinkerModule.h"
+
+namespace optalinker {
+
+class OptaLinkerState;
+class OptaLinkerMonitor;
+class OptaLinkerStore;
+class OptaLinkerIo;
+
+/**
+ * OptaLinker Library local rules module.
+ *
+ * Rules drive outputs from inputs on device, on each inputs poll, even without network.
+ * Rules are compiled to bytecode when they are set.
+ *
+ * One rule per line (or separated by ;) as: target = expression
+ * * Target is an output Oe.o or a marker Mn
+ * * Ie.i, Oe.o, Mn : input state, output state, marker
+ * * Ve.i > mV, Ve.i < mV : input voltage (or analog expansion measure) compare
+ * * ! & | ( ) 0 1 : not, and, or, group, constants
+ * * TON(a, ms) : a is high since ms
+ * * TOF(a, ms) : a is high, or is low since less than ms
+ * * SR(set, reset) : latch, reset wins
+ * * CTU(pulse, preset, reset) : pulse rising edges count reached preset
+ * * # : comment to end of line
+ */
+class OptaLinkerRules : public OptaLinkerModule {
+
+private:
+  OptaLinkerState &state;
+  OptaLinkerMonitor &monitor;
+  OptaLinkerStore &store;
+  OptaLinkerIo &io;
+
+  /**
+   * Rules source.
+   */
+  String _source = "";
+
+  /**
+   * Character position of last compile failure.
+   */
+  uint16_t _errorPosition = 0;
+
+  /**
+   * Running bytecode.
+   */
+  uint8_t _code[RulesCodeSize] = { RulesOpEnd };
+
+  /**
+   * Timers, latches and counters states, by index.
+   */
+  RulesStateStruct _state[RulesStateNum] = {};
+
+  /**
+   * Markers, as bits.
+   */
+  uint16_t _markers = 0;
+
+  /**
+   * Running bytecode and compiler lock.
+   */
+  rtos::Mutex _mutex;
+
+  /**
+   * Compiler bytecode, cursor, stack depth and number of states.
+   */
+  uint8_t _compiled[RulesCodeSize];
+  uint16_t _compiledLength = 0;
+  const char *_cursor = nullptr;
+  uint8_t _depth = 0;
+  uint8_t _states = 0;
+
+  /**
+   * Skip spaces and comment, but not rules separators.
+   */
+  void skipSpaces() {
+    while (*_cursor == ' ' || *_cursor == '\t' || *_cursor == '\r') {
+      _cursor++;
+    }
+    if (*_cursor == '#') {
+      while (*_cursor != '\0' && *_cursor != '\n') {
+        _cursor++;
+      }
+    }
+  }
+
+  /**
+   * Read a character.
+   *
+   * @param   c   The upper case character
+   *
+   * @return  1 if it is read, else 0
+   */
+  uint8_t accept(char c) {
+    skipSpaces();
+    if (toupper(*_cursor) == c) {
+      _cursor++;
+
+      return 1;
+    }
+
+    return 0;
+  }
+
+  /**
+   * Read a word, case insensitive.
+   *
+   * @param   word  The word
+   *
+   * @return  1 if it is read, else 0
+   */
+  uint8_t acceptWord(const char *word) {
+    skipSpaces();
+    size_t length = strlen(word);
+    if (strncasecmp(_cursor, word, length) == 0) {
+      _cursor += length;
+
+      return 1;
+    }
+
+    return 0;
+  }
+
+  /**
+   * Read a number.
+   *
+   * @param   value   The number read
+   * @param   max     The maximum value
+   *
+   * @return  1 on success, else 0
+   */
+  uint8_t readNumber(uint32_t &value, uint32_t max) {
+    skipSpaces();
+    if (!isdigit(*_cursor)) {
+
+      return 0;
+    }
+
+    value = 0;
+    while (isdigit(*_cursor)) {
+      value = (value * 10) + (*_cursor++ - '0');
+      if (value > max) {
+
+        return 0;
+      }
+    }
+
+    return 1;
+  }
+
+  /**
+   * Read an io as expansion.number.
+   *
+   * @param   address   The io read, as expansion << 4 | number
+   * @param   max       The number of io of an expansion
+   *
+   * @return  1 on success, else 0
+   */
+  uint8_t readIo(uint8_t &address, uint8_t max) {
+    uint32_t e = 0, n = 0;
+    if (!readNumber(e, OPTA_CONTROLLER_MAX_EXPANSION_NUM) || *_cursor++ != '.' || !readNumber(n, max - 1)) {
+
+      return 0;
+    }
+    address = (e << 4) | n;
+
+    return 1;
+  }
+
+  /**
+   * Append bytes to compiled bytecode, last byte is kept for RulesOpEnd.
+   *
+   * @param   value   The value
+   * @param   length  The value length in bytes, little endian
+   *
+   * @return  1 on success, else 0
+   */
+  uint8_t emit(uint32_t value, uint8_t length = 1) {
+    for (uint8_t b = 0; b < length; b++) {
+      if (_compiledLength >= RulesCodeSize - 1) {
+
+        return 0;
+      }
+      _compiled[_compiledLength++] = (value >> (b * 8)) & 0xFF;
+    }
+
+    return 1;
+  }
+
+  /**
+   * Count a value pushed on stack.
+   *
+   * @return  1 if stack is not full, else 0
+   */
+  uint8_t push() {
+
+    return ++_depth <= RulesStackSize ? 1 : 0;
+  }
+
+  /**
+   * Reserve a timer, latch or counter state.
+   *
+   * @param   index   The state index
+   *
+   * @return  1 on success, else 0
+   */
+  uint8_t reserve(uint8_t &index) {
+    if (_states >= RulesStateNum) {
+
+      return 0;
+    }
+    index = _states++;
+
+    return 1;
+  }
+
+  /**
+   * Compile an expression: and ('|' and)*
+   */
+  uint8_t parseOr() {
+    if (!parseAnd()) {
+
+      return 0;
+    }
+    while (accept('|')) {
+      if (!parseAnd() || !emit(RulesOpOr)) {
+
+        return 0;
+      }
+      _depth--;
+    }
+
+    return 1;
+  }
+
+  /**
+   * Compile an expression: unary ('&' unary)*
+   */
+  uint8_t parseAnd() {
+    if (!parseUnary()) {
+
+      return 0;
+    }
+    while (accept('&')) {
+      if (!parseUnary() || !emit(RulesOpAnd)) {
+
+        return 0;
+      }
+      _depth--;
+    }
+
+    return 1;
+  }
+
+  /**
+   * Compile an expression: '!' unary | primary
+   */
+  uint8_t parseUnary() {
+    if (accept('!')) {
+
+      return parseUnary() && emit(RulesOpNot);
+    }
+
+    return parsePrimary();
+  }
+
+  /**
+   * Compile an expression: function, group, constant, io or marker.
+   */
+  uint8_t parsePrimary() {
+    uint8_t address = 0, index = 0;
+    uint32_t number = 0, preset = 0;
+
+    // timers
+    uint8_t timer = acceptWord("TON(") ? RulesOpTimerOn : (acceptWord("TOF(") ? RulesOpTimerOff : RulesOpEnd);
+    if (timer != RulesOpEnd) {
+
+      return parseOr() && accept(',') && readNumber(number, UINT32_MAX / 10) && accept(')')
+        && reserve(index) && emit(timer) && emit(index) && emit(number, 4);
+    }
+
+    // latch
+    if (acceptWord("SR(")) {
+      if (!parseOr() || !accept(',') || !parseOr() || !accept(')') || !reserve(index)) {
+
+        return 0;
+      }
+      _depth--;
+
+      return emit(RulesOpLatch) && emit(index);
+    }
+
+    // counter
+    if (acceptWord("CTU(")) {
+      if (!parseOr() || !accept(',') || !readNumber(preset, UINT16_MAX) || !accept(',') || !parseOr() || !accept(')') || !reserve(index)) {
+
+        return 0;
+      }
+      _depth--;
+
+      return emit(RulesOpCounter) && emit(index) && emit(preset, 2);
+    }
+
+    // group
+    if (accept('(')) {
+
+      return parseOr() && accept(')');
+    }
+
+    // constants
+    if (accept('0')) {
+
+      return push() && emit(RulesOpFalse);
+    }
+    if (accept('1')) {
+
+      return push() && emit(RulesOpTrue);
+    }
+
+    // input state
+    if (accept('I')) {
+
+      return readIo(address, io.getMaxInputNum()) && push() && emit(RulesOpInput) && emit(address);
+    }
+
+    // output state
+    if (accept('O')) {
+
+      return readIo(address, io.getMaxOutputNum()) && push() && emit(RulesOpOutput) && emit(address);
+    }
+
+    // marker
+    if (accept('M')) {
+
+      return readNumber(number, RulesMarkerNum - 1) && push() && emit(RulesOpMarker) && emit(number);
+    }
+
+    // input voltage compare
+    if (accept('V')) {
+      if (!readIo(address, io.getMaxInputNum())) {
+
+        return 0;
+      }
+      uint8_t compare = accept('>') ? RulesOpAbove : (accept('<') ? RulesOpBelow : RulesOpEnd);
+
+      return compare != RulesOpEnd && readNumber(number, UINT16_MAX) && push() && emit(compare) && emit(address) && emit(number, 2);
+    }
+
+    return 0;
+  }
+
+  /**
+   * Compile a rule: target '=' expression
+   */
+  uint8_t parseRule() {
+    uint8_t address = 0, target = RulesOpEnd;
+    uint32_t number = 0;
+
+    if (accept('O') && readIo(address, io.getMaxOutputNum())) {
+      target = RulesOpSetOutput;
+    } else if (accept('M') && readNumber(number, RulesMarkerNum - 1)) {
+      target = RulesOpSetMarker;
+      address = number;
+    }
+    if (target == RulesOpEnd || !accept('=') || !parseOr() || !emit(target) || !emit(address)) {
+
+      return 0;
+    }
+    _depth = 0;
+
+    return 1;
+  }
+
+  /**
+   * Compile rules source to compiler bytecode.
+   *
+   * @param   source  The rules source
+   *
+   * @return  1 on success, else 0 and cursor is on error
+   */
+  uint8_t compile(const char *source) {
+    _cursor = source;
+    _compiledLength = 0;
+    _depth = 0;
+    _states = 0;
+
+    while (1) {
+      skipSpaces();
+      if (*_cursor == '\0') {
+        break;
+      }
+      if (*_cursor == ';' || *_cursor == '\n') {
+        _cursor++;
+        continue;
+      }
+      if (!parseRule()) {
+
+        return 0;
+      }
+      skipSpaces();
+      if (*_cursor != '\0' && *_cursor != ';' && *_cursor != '\n') {
+
+        return 0;
+      }
+    }
+    _compiled[_compiledLength] = RulesOpEnd;
+
+    return 1;
+  }
+
+  /**
+   * Read bytecode number, little endian.
+   */
+  uint32_t readCode(uint16_t pc, uint8_t length) {
+    uint32_t value = 0;
+    for (uint8_t b = length; b-- > 0;) {
+      value = (value << 8) | _code[pc + b];
+    }
+
+    return value;
+  }
+
+  /**
+   * Rules write callback.
+   *
+   * @param   ret   The write result
+   */
+  void onWrite(uint8_t ret) {
+    monitor.setMessage(LabelRulesFileWrite, ret ? MonitorSuccess : MonitorFail);
+  }
+
+public:
+  OptaLinkerRules(OptaLinkerState &_state, OptaLinkerMonitor &_monitor, OptaLinkerStore &_store, OptaLinkerIo &_io) : state(_state), monitor(_monitor), store(_store), io(_io) {}
+
+  uint8_t setup() {
+    monitor.setMessage(LabelRulesSetup, MonitorAction);
+
+    if (!readFromFile()) {
+      setRules(OPTALINKER_RULES, false);
+    }
+
+    // Evaluate rules once inputs are read
+    io.attachRules(callback(this, &OptaLinkerRules::evaluate));
+
+    return 1;
+  }
+
+  uint8_t loop() {
+
+    return 1;
+  }
+
+  /**
+   * Evaluate rules bytecode.
+   *
+   * Called by io module on each poll, outputs are written on the same io loop.
+   * Evaluation is skipped while rules are compiled.
+   */
+  void evaluate() {
+    if (!_mutex.trylock()) {
+
+      return;
+    }
+
+    ExpansionStruct *expansion = io.getExpansions();
+    uint32_t now = state.getTime();
+    uint32_t stack = 0;
+    uint16_t pc = 0;
+    uint8_t a = 0, b = 0;
+
+    while (_code[pc] != RulesOpEnd) {
+      uint8_t op = _code[pc++];
+      switch (op) {
+        case RulesOpFalse:
+        case RulesOpTrue:
+          stack = (stack << 1) | (op == RulesOpTrue ? 1 : 0);
+          break;
+
+        case RulesOpInput:
+          stack = (stack << 1) | (expansion[_code[pc] >> 4].input[_code[pc] & 0x0F].state ? 1 : 0);
+          pc++;
+          break;
+
+        case RulesOpOutput:
+          stack = (stack << 1) | (expansion[_code[pc] >> 4].output[_code[pc] & 0x0F].state ? 1 : 0);
+          pc++;
+          break;
+
+        case RulesOpMarker:
+          stack = (stack << 1) | ((_markers >> _code[pc]) & 1);
+          pc++;
+          break;
+
+        case RulesOpAbove:
+        case RulesOpBelow: {
+          int voltage = expansion[_code[pc] >> 4].input[_code[pc] & 0x0F].voltage;
+          int limit = readCode(pc + 1, 2);
+          stack = (stack << 1) | ((op == RulesOpAbove ? voltage > limit : voltage < limit) ? 1 : 0);
+          pc += 3;
+          break;
+        }
+
+        case RulesOpNot:
+          stack ^= 1;
+          break;
+
+        case RulesOpAnd:
+          a = stack & 1;
+          stack >>= 1;
+          stack &= a ? ~0UL : ~1UL;
+          break;
+
+        case RulesOpOr:
+          a = stack & 1;
+          stack >>= 1;
+          stack |= a;
+          break;
+
+        case RulesOpTimerOn:
+        case RulesOpTimerOff: {
+          RulesStateStruct &s = _state[_code[pc]];
+          uint32_t duration = readCode(pc + 1, 4);
+          pc += 5;
+          a = stack & 1;
+          if (a != s.last) {
+            s.since = now;
+            s.last = a;
+          }
+          if (op == RulesOpTimerOn) {
+            s.value = a && now - s.since >= duration ? 1 : 0;
+          } else {
+            s.value = a || (s.value && now - s.since < duration) ? 1 : 0;
+          }
+          stack = (stack & ~1UL) | s.value;
+          break;
+        }
+
+        case RulesOpLatch: {
+          RulesStateStruct &s = _state[_code[pc]];
+          pc++;
+          a = stack & 1; // reset
+          stack >>= 1;
+          b = stack & 1; // set
+          s.value = a ? 0 : (b ? 1 : s.value);
+          stack = (stack & ~1UL) | s.value;
+          break;
+        }
+
+        case RulesOpCounter: {
+          RulesStateStruct &s = _state[_code[pc]];
+          uint16_t preset = readCode(pc + 1, 2);
+          pc += 3;
+          a = stack & 1; // reset
+          stack >>= 1;
+          b = stack & 1; // pulse
+          if (a) {
+            s.count = 0;
+          } else if (b && !s.last && s.count < preset) {
+            s.count++;
+          }
+          s.last = b;
+          s.value = s.count >= preset ? 1 : 0;
+          stack = (stack & ~1UL) | s.value;
+          break;
+        }
+
+        case RulesOpSetOutput:
+          io.setOutput(_code[pc] >> 4, _code[pc] & 0x0F, stack & 1);
+          pc++;
+          stack >>= 1;
+          break;
+
+        case RulesOpSetMarker:
+          _markers = (stack & 1) ? (_markers | (1 << _code[pc])) : (_markers & ~(1 << _code[pc]));
+          pc++;
+          stack >>= 1;
+          break;
+
+        default:
+          // unknown operation, stop here
+          _mutex.unlock();
+
+          return;
+      }
+    }
+
+    _mutex.unlock();
+  }
+
+  /**
+   * Set rules.
+   *
+   * Rules are compiled then replace running rules, timers, latches, counters and markers are resetted.
+   * On error, running rules are kept.
+   *
+   * @param   source  The rules source
+   * @param   save    Write rules to flash memory
+   *
+   * @return  1 on success, else 0
+   */
+  uint8_t setRules(String source, bool save = true) {
+    if (source.length() > RulesSourceSize) {
+      _errorPosition = RulesSourceSize;
+      monitor.setMessage(LabelRulesCompileFail + String(RulesSourceSize), MonitorFail);
+
+      return 0;
+    }
+
+    _mutex.lock();
+    if (!compile(source.c_str())) {
+      _errorPosition = _cursor - source.c_str();
+      _mutex.unlock();
+      monitor.setMessage(LabelRulesCompileFail + String(_errorPosition), MonitorFail);
+
+      return 0;
+    }
+    memcpy(_code, _compiled, _compiledLength + 1);
+    memset(_state, 0, sizeof(_state));
+    _markers = 0;
+    _source = source;
+    _mutex.unlock();
+
+    monitor.setMessage(LabelRulesCompile + String(_compiledLength), MonitorSuccess);
+
+    if (save) {
+      writeToFile();
+    }
+
+    return 1;
+  }
+
+  /**
+   * Get rules source.
+   *
+   * @return  The rules source
+   */
+  String getRules() {
+
+    return _source;
+  }
+
+  /**
+   * Get character position of last rules compile failure.
+   *
+   * @return  The character position
+   */
+  uint16_t getErrorPosition() {
+
+    return _errorPosition;
+  }
+
+  /**
+   * Get a marker value.
+   *
+   * @param   marker  The marker number
+   *
+   * @return  The marker value
+   */
+  uint8_t getMarker(uint8_t marker) {
+
+    return marker < RulesMarkerNum ? (_markers >> marker) & 1 : 0;
+  }
+
+  /**
+   * Read rules from a JSON string, as "rules" key.
+   *
+   * @param   buffer  The JSON string
+   * @param   length  The JSON string length
+   *
+   * @return  1 on success, else 0
+   */
+  uint8_t readFromJson(const char *buffer, size_t length) {
+    JsonDocument doc;
+    DeserializationError error = deserializeJson(doc, buffer, length);
+
+    if (error) {
+
+      return 0;
+    }
+
+    if (!doc["rules"].isNull() && !doc["rules"].as<String>().equals(_source)) {
+
+      return setRules(doc["rules"].as<String>());
+    }
+
+    return 1;
+  }
+
+  /**
+   * Write rules to flash memory.
+   *
+   * Record is written by flash writer thread.
+   *
+   * @return  1 on success, else 0
+   */
+  uint8_t writeToFile() {
+    uint8_t record[RulesRecordSize];
+    uint16_t length = _source.length();
+    memcpy(record + StoreRecordHeaderLength, _source.c_str(), length);
+
+    return store.queueRecord("rules", record, RulesRecordSchema, length, callback(this, &OptaLinkerRules::onWrite)) ? 1 : 0;
+  }
+
+  /**
+   * Read rules from flash memory.
+   *
+   * @return  1 on success, else 0
+   */
+  uint8_t readFromFile() {
+    uint8_t record[RulesRecordSize];
+    uint16_t schema = 0;
+    int32_t length = store.readRecord("rules", record, sizeof(record), schema);
+
+    if (length < 0 || schema != RulesRecordSchema) {
+
+      return 0;
+    }
+
+    String source = "";
+    source.concat((const char *)record + StoreRecordHeaderLength, length);
+
+    return setRules(source, false);
+  }
+
+}; // class OptaLinkerRules
+
+} // namespace optalinker
+
+#endif // #ifndef OPTALINKER_RULES_H
@@ -18,7 +18,9 @@
 #include <FATFileSystem.h>
 #include "wiced_resource.h"
 #include <KVStore.h>
+#include <KVMap.h>
 #include <kvstore_global_api.h>
+#include <MbedCRC.h>
 
 #include "OptaLinkerModule.h"
 #include "fwWifiCertificates.h"
@@ -30,6 +32,118 @@ using namespace mbed;
 class OptaLinkerMonitor;
 class OptaLinkerBoard;
 
+/**
+ * OptaLinker Library flash memory read handle.
+ *
+ * Holds a buffer from store pool, or from heap for large contents.
+ * Buffer is released when handle goes out of scope, handle can only be moved.
+ */
+class OptaLinkerStoreValue {
+
+private:
+  char *_buffer = nullptr;
+  size_t _size = 0;
+  size_t _length = 0;
+
+  /**
+   * Pool slot in use flag, nullptr for heap buffer.
+   */
+  volatile uint8_t *_slot = nullptr;
+
+public:
+  OptaLinkerStoreValue() {}
+  OptaLinkerStoreValue(char *buffer, size_t size, volatile uint8_t *slot) : _buffer(buffer), _size(size), _slot(slot) {}
+  OptaLinkerStoreValue(const OptaLinkerStoreValue &) = delete;
+  OptaLinkerStoreValue &operator=(const OptaLinkerStoreValue &) = delete;
+
+  OptaLinkerStoreValue(OptaLinkerStoreValue &&other) : _buffer(other._buffer), _size(other._size), _length(other._length), _slot(other._slot) {
+    other._buffer = nullptr;
+    other._slot = nullptr;
+    other._size = other._length = 0;
+  }
+
+  ~OptaLinkerStoreValue() {
+    release();
+  }
+
+  /**
+   * Release buffer to pool or heap.
+   */
+  void release() {
+    if (_slot != nullptr) {
+      *_slot = 0;
+    } else if (_buffer != nullptr) {
+      free(_buffer);
+    }
+    _buffer = nullptr;
+    _slot = nullptr;
+    _size = _length = 0;
+  }
+
+  /**
+   * Get buffer.
+   *
+   * @return  The buffer, nullptr if there is none
+   */
+  char *data() {
+
+    return _buffer;
+  }
+
+  /**
+   * Get buffer size.
+   *
+   * @return  The buffer size
+   */
+  size_t size() const {
+
+    return _size;
+  }
+
+  /**
+   * Set contents length.
+   *
+   * @param   length  The contents length, a null char is added after it
+   */
+  void setLength(size_t length) {
+    if (_buffer != nullptr && length < _size) {
+      _length = length;
+      _buffer[length] = '\0';
+    }
+  }
+
+  /**
+   * Get contents length.
+   *
+   * @return  The contents length
+   */
+  size_t length() const {
+
+    return _length;
+  }
+
+  /**
+   * Get contents as string.
+   *
+   * @return  The contents (or an empty string)
+   */
+  const char *c_str() const {
+
+    return _buffer != nullptr ? _buffer : "";
+  }
+
+  /**
+   * Check if handle has a buffer.
+   *
+   * @return  1 if it has, else 0
+   */
+  uint8_t isValid() const {
+
+    return _buffer != nullptr ? 1 : 0;
+  }
+
+}; // class OptaLinkerStoreValue
+
 /**
  * OptaLinker Library flash memory module.
  *
@@ -42,6 +156,8 @@ class OptaLinkerBoard;
  * * 4 : User : 7MB
  *
  * There are methods to help KV store usage.
+ *
+ * Space from 14MB to 15.5MB is used by IO counters journal.
  */
 class OptaLinkerStore : public OptaLinkerModule {
 
@@ -54,6 +170,290 @@ private:
    */
   uint32_t _bootCount = 0;
 
+  /**
+   * Journal flash device.
+   */
+  BlockDevice *_journalDevice = nullptr;
+
+  /**
+   * Journal sector size and number of sectors.
+   */
+  uint32_t _journalSectorSize = 0;
+  uint16_t _journalSectors = 0;
+
+  /**
+   * Journal current sector sequence (0 if there is no sector yet).
+   */
+  uint32_t _journalSequence = 0;
+
+  /**
+   * Journal first sequence still required to replay.
+   */
+  uint32_t _journalFirst = 0;
+
+  /**
+   * Journal current sector write offset.
+   */
+  uint32_t _journalOffset = 0;
+
+  /**
+   * Journal sector sequence to erase ahead by flash writer thread, and last one erased.
+   */
+  volatile uint32_t _journalErase = 0;
+  volatile uint32_t _journalErased = 0;
+
+  /**
+   * Journal replay sequence and offset.
+   */
+  uint32_t _journalReadSequence = 0;
+  uint32_t _journalReadOffset = 0;
+
+  /**
+   * Flash read buffers pool and their in use flags.
+   */
+  char _pool[StorePoolSize][StorePoolBufferSize];
+  volatile uint8_t _poolUsed[StorePoolSize] = {};
+  rtos::Mutex _poolMutex;
+
+  /**
+   * Flash write request.
+   */
+  struct StoreRequest {
+    uint8_t state;
+    uint32_t order;
+    char key[32];
+    uint8_t *buffer;
+    size_t capacity;
+    size_t size;
+    Callback<void(uint8_t)> done;
+  };
+
+  /**
+   * Flash write queue.
+   */
+  StoreRequest _queue[StoreQueueSize] = {};
+
+  /**
+   * Flash write queue order counter.
+   */
+  uint32_t _queueOrder = 0;
+
+  /**
+   * Flash write queue lock and pending requests counter.
+   */
+  rtos::Mutex _queueMutex;
+  rtos::Semaphore _queueSemaphore{0};
+
+  /**
+   * Requests rejected because flash write queue was full.
+   */
+  uint32_t _queueRejected = 0;
+
+  /**
+   * Fill in a binary record header.
+   *
+   * @param   record  The record buffer
+   * @param   schema  The payload schema version
+   * @param   length  The payload length
+   *
+   * @return  The record length
+   */
+  size_t setRecordHeader(uint8_t *record, uint16_t schema, uint16_t length) {
+    uint32_t magic = StoreRecordMagic;
+    uint32_t crc = crc32(record + StoreRecordHeaderLength, length);
+    memcpy(record, &magic, 4);
+    memcpy(record + 4, &schema, 2);
+    memcpy(record + 6, &length, 2);
+    memcpy(record + 8, &crc, 4);
+
+    return StoreRecordHeaderLength + length;
+  }
+
+  /**
+   * Flash writer thread loop.
+   *
+   * Requests are written in queue order.
+   */
+  void writer() {
+    while (1) {
+      _queueSemaphore.acquire();
+
+      // erase next journal sector ahead, library loop never waits for a sector erase
+      if (_journalErase != 0 && _journalErase != _journalErased) {
+        uint32_t sequence = _journalErase;
+        if (_journalDevice->erase(getJournalAddress(sequence), _journalSectorSize) == BD_ERROR_OK) {
+          _journalErased = sequence;
+        }
+        _journalErase = 0;
+      }
+
+      StoreRequest *request = nullptr;
+      _queueMutex.lock();
+      for (uint8_t q = 0; q < StoreQueueSize; q++) {
+        if (_queue[q].state == StoreRequestPending && (request == nullptr || _queue[q].order < request->order)) {
+          request = &_queue[q];
+        }
+      }
+      if (request != nullptr) {
+        request->state = StoreRequestWriting;
+      }
+      _queueMutex.unlock();
+
+      if (request == nullptr) {
+        continue;
+      }
+
+      uint8_t ret = writeKey(request->key, request->buffer, request->size);
+      Callback<void(uint8_t)> done = request->done;
+
+      _queueMutex.lock();
+      request->state = StoreRequestFree;
+      request->done = nullptr;
+      board.unsetHold();
+      _queueMutex.unlock();
+
+      if (done) {
+        done(ret);
+      }
+    }
+  }
+
+  /**
+   * Get flash address of a journal sector.
+   *
+   * @param   sequence  The sector sequence
+   *
+   * @return  The sector address
+   */
+  uint32_t getJournalAddress(uint32_t sequence) {
+
+    return StoreJournalAddress + (sequence % _journalSectors) * _journalSectorSize;
+  }
+
+  /**
+   * Check if a journal sector belongs to a sequence.
+   *
+   * @param   sequence  The sector sequence
+   *
+   * @return  1 if sector header matches sequence, else 0
+   */
+  uint8_t checkJournalSector(uint32_t sequence) {
+    uint32_t header[2] = { 0, 0 };
+    if (_journalDevice->read(header, getJournalAddress(sequence), StoreJournalHeaderLength) != BD_ERROR_OK) {
+
+      return 0;
+    }
+
+    return header[0] == StoreJournalMagic && header[1] == sequence ? 1 : 0;
+  }
+
+  /**
+   * Compute check byte of a journal entry.
+   *
+   * @param   entry   The journal entry
+   *
+   * @return  The CRC8 of the entry without its check byte
+   */
+  static uint8_t getJournalCheck(const uint8_t *entry) {
+    MbedCRC<POLY_8BIT_CCITT, 8> ct;
+    uint8_t buffer[StoreJournalEntryLength - 1];
+    memcpy(buffer, entry, 3);
+    memcpy(buffer + 3, entry + 4, 4);
+    uint32_t crc = 0;
+    ct.compute(buffer, sizeof(buffer), &crc);
+
+    return crc;
+  }
+
+  /**
+   * Check if a journal entry is not yet written.
+   *
+   * @param   entry   The journal entry
+   *
+   * @return  1 if all entry bytes are erased, else 0
+   */
+  static uint8_t isJournalErased(const uint8_t *entry) {
+    for (uint8_t i = 0; i < StoreJournalEntryLength; i++) {
+      if (entry[i] != 0xFF) {
+
+        return 0;
+      }
+    }
+
+    return 1;
+  }
+
+  /**
+   * Erase a journal sector and make it the current one.
+   *
+   * Sector already erased by flash writer thread is not erased again.
+   *
+   * @param   sequence  The sector sequence
+   *
+   * @return  1 on success, else 0
+   */
+  uint8_t openJournal(uint32_t sequence) {
+    uint32_t address = getJournalAddress(sequence);
+    uint32_t header[2] = { StoreJournalMagic, sequence };
+    if ((_journalErased != sequence && _journalDevice->erase(address, _journalSectorSize) != BD_ERROR_OK)
+      || _journalDevice->program(header, address, StoreJournalHeaderLength) != BD_ERROR_OK
+    ) {
+      monitor.setMessage(LabelStoreJournalFail, MonitorFail);
+
+      return 0;
+    }
+
+    _journalSequence = sequence;
+    _journalOffset = StoreJournalHeaderLength;
+
+    return 1;
+  }
+
+  /**
+   * Find journal current sector and write offset.
+   *
+   * @return  1 on success, else 0
+   */
+  uint8_t setupJournal() {
+    _journalDevice = BlockDevice::get_default_instance();
+    _journalSectorSize = _journalDevice->get_erase_size(StoreJournalAddress);
+    if (_journalSectorSize == 0 || StoreJournalLength / _journalSectorSize < 2) {
+      _journalDevice = nullptr;
+
+      return 0;
+    }
+    _journalSectors = min((uint32_t)StoreJournalSectors, StoreJournalLength / _journalSectorSize);
+
+    // Search sector with highest sequence
+    for (uint16_t s = 0; s < _journalSectors; s++) {
+      uint32_t header[2] = { 0, 0 };
+      if (_journalDevice->read(header, StoreJournalAddress + s * _journalSectorSize, StoreJournalHeaderLength) == BD_ERROR_OK
+        && header[0] == StoreJournalMagic
+        && header[1] % _journalSectors == s
+        && header[1] > _journalSequence
+      ) {
+        _journalSequence = header[1];
+      }
+    }
+
+    // Search first free entry of this sector
+    if (_journalSequence > 0) {
+      uint8_t entry[StoreJournalEntryLength];
+      uint32_t address = getJournalAddress(_journalSequence);
+      _journalOffset = StoreJournalHeaderLength;
+      while (_journalOffset + StoreJournalEntryLength <= _journalSectorSize
+        && _journalDevice->read(entry, address + _journalOffset, StoreJournalEntryLength) == BD_ERROR_OK
+        && !isJournalErased(entry)
+      ) {
+        _journalOffset += StoreJournalEntryLength;
+      }
+    }
+
+    monitor.setMessage(LabelStoreJournal + String(_journalSequence), MonitorInfo);
+
+    return 1;
+  }
+
 public:
   OptaLinkerStore(OptaLinkerMonitor &_monitor, OptaLinkerBoard &_board) : monitor(_monitor), board(_board) {}
 
@@ -69,10 +469,17 @@ public:
     }
 
     const char key[10] = "bootcount";
-    const char *bc = readKey(key);
+    char bc[12] = {0};
+    readKey(key, bc, sizeof(bc) - 1);
     _bootCount = abs(atoi(bc) + 1);
     writeKey(key, String(_bootCount).c_str());
 
+    setupJournal();
+
+    // Start flash writer, below loop priority
+    static rtos::Thread storeThread(osPriorityBelowNormal);
+    storeThread.start(callback(this, &OptaLinkerStore::writer));
+
     return 1;
   }
 
@@ -95,26 +502,58 @@ public:
     }
   }
 
+  /**
+   * Get a read buffer.
+   *
+   * A free pool buffer is used if it is large enough, else buffer is allocated on heap.
+   *
+   * @param   size  The required buffer size
+   *
+   * @return  The buffer handle (not valid if allocation failed)
+   */
+  OptaLinkerStoreValue getBuffer(size_t size) {
+    if (size <= StorePoolBufferSize) {
+      _poolMutex.lock();
+      for (uint8_t p = 0; p < StorePoolSize; p++) {
+        if (!_poolUsed[p]) {
+          _poolUsed[p] = 1;
+          _poolMutex.unlock();
+
+          return OptaLinkerStoreValue(_pool[p], StorePoolBufferSize, &_poolUsed[p]);
+        }
+      }
+      _poolMutex.unlock();
+    }
+
+    char *buffer = (char *)malloc(size);
+
+    return OptaLinkerStoreValue(buffer, buffer != nullptr ? size : 0, nullptr);
+  }
+
   /**
    * Read contents of a stored key.
    *
-   * @return  The stored key contents (or an empty string)
+   * Contents are null terminated. Buffer is released with returned handle.
+   *
+   * @param   key   The key
+   *
+   * @return  The stored key contents handle (not valid if key can not be read)
    */
-  const char *readKey(const char *key) {
+  OptaLinkerStoreValue readKey(const char *key) {
     kv_info_t info;
     if (kv_get_info(key, &info) == MBED_SUCCESS) {
-      char* buffer = (char*)malloc(info.size + 1);
-      size_t actual; 
-      if (kv_get(key, buffer, info.size, &actual) == MBED_SUCCESS) {
-        buffer[actual] = '\0';
-        
-        return buffer;
-      } 
+      OptaLinkerStoreValue value = getBuffer(info.size + 1);
+      size_t actual = 0;
+      if (value.isValid() && kv_get(key, value.data(), info.size, &actual) == MBED_SUCCESS) {
+        value.setLength(actual);
+
+        return value;
+      }
     }
 
     monitor.setMessage(LabelStoreReadFail, MonitorWarning);
 
-    return "";
+    return OptaLinkerStoreValue();
   }
 
   /**
@@ -130,6 +569,411 @@ public:
     return kv_set(key, value, strlen(value), 0) == MBED_SUCCESS ? 1 : 0;
   }
 
+  /**
+   * Write a key binary contents to store.
+   *
+   * @param   key     The key
+   * @param   buffer  The contents
+   * @param   size    The contents length
+   *
+   * @return  1 on success, else 0
+   */
+  uint8_t writeKey(const char *key, const void *buffer, size_t size) {
+
+    return kv_set(key, buffer, size, 0) == MBED_SUCCESS ? 1 : 0;
+  }
+
+  /**
+   * Read a key binary contents into a buffer.
+   *
+   * @param   key     The key
+   * @param   buffer  The buffer to fill in
+   * @param   size    The buffer size
+   *
+   * @return  The number of bytes read, else -1
+   */
+  int32_t readKey(const char *key, void *buffer, size_t size) {
+    size_t actual = 0;
+    if (kv_get(key, buffer, size, &actual) == MBED_SUCCESS) {
+
+      return actual;
+    }
+
+    return -1;
+  }
+
+  /**
+   * Read a part of a key binary contents into a buffer.
+   *
+   * @param   key     The key
+   * @param   buffer  The buffer to fill in
+   * @param   size    The buffer size
+   * @param   offset  The contents offset to start from
+   *
+   * @return  The number of bytes read, else -1
+   */
+  int32_t readKey(const char *key, void *buffer, size_t size, size_t offset) {
+    KVStore *kv = nullptr;
+    size_t index = 0;
+    size_t actual = 0;
+    if (KVMap::get_instance().lookup(key, &kv, &index) == MBED_SUCCESS
+      && kv->get(key + index, buffer, size, &actual, offset) == MBED_SUCCESS
+    ) {
+
+      return actual;
+    }
+
+    return -1;
+  }
+
+  /**
+   * Read a key contents chunk by chunk.
+   *
+   * Only one pool buffer is used whatever the contents length is.
+   *
+   * @param   key     The key
+   * @param   chunk   The callback called with each chunk, it returns 0 to stop reading
+   *
+   * @return  1 if all contents are read, else 0
+   */
+  uint8_t streamKey(const char *key, Callback<uint8_t(const uint8_t *, size_t)> chunk) {
+    OptaLinkerStoreValue value = getBuffer(StorePoolBufferSize);
+    if (!value.isValid()) {
+
+      return 0;
+    }
+
+    size_t offset = 0;
+    int32_t actual = 0;
+    do {
+      actual = readKey(key, value.data(), value.size(), offset);
+      if (actual < 0 || (actual > 0 && !chunk((const uint8_t *)value.data(), actual))) {
+
+        return 0;
+      }
+      offset += actual;
+    } while ((size_t)actual == value.size());
+
+    return 1;
+  }
+
+  /**
+   * Compute CRC32 of a buffer.
+   *
+   * This is the standard CRC32 (zlib) also used by OTA files.
+   *
+   * @param   buffer  The buffer
+   * @param   size    The buffer length
+   *
+   * @return  The CRC32
+   */
+  static uint32_t crc32(const void *buffer, size_t size) {
+    MbedCRC<POLY_32BIT_ANSI, 32> ct;
+    uint32_t crc = 0;
+    ct.compute(buffer, size, &crc);
+
+    return crc;
+  }
+
+  /**
+   * Write a binary record to store.
+   *
+   * The record buffer MUST start with StoreRecordHeaderLength free bytes
+   * followed by the payload. Header is filled in here.
+   *
+   * @param   key     The key
+   * @param   record  The record buffer
+   * @param   schema  The payload schema version
+   * @param   length  The payload length
+   *
+   * @return  1 on success, else 0
+   */
+  uint8_t writeRecord(const char *key, uint8_t *record, uint16_t schema, uint16_t length) {
+
+    return writeKey(key, record, setRecordHeader(record, schema, length));
+  }
+
+  /**
+   * Queue a key binary contents to be written by flash writer thread.
+   *
+   * Contents are copied, a pending request of the same key is replaced (with its callback).
+   * If queue is full, request is rejected, caller never waits for a flash write.
+   * Reboot waits for queued requests.
+   * Callback is called once for each request returning 1.
+   *
+   * @param   key     The key
+   * @param   buffer  The contents
+   * @param   size    The contents length
+   * @param   done    The callback called with write result
+   *
+   * @return  1 if queued, 2 if a pending request is replaced, else 0 on error or if queue is full
+   */
+  uint8_t queueKey(const char *key, const void *buffer, size_t size, Callback<void(uint8_t)> done = nullptr) {
+    if (strlen(key) >= sizeof(_queue[0].key)) {
+
+      return 0;
+    }
+
+    _queueMutex.lock();
+
+    // Search pending request of this key, or a free one
+    StoreRequest *request = nullptr;
+    for (uint8_t q = 0; q < StoreQueueSize; q++) {
+      if (_queue[q].state == StoreRequestPending && strcmp(_queue[q].key, key) == 0) {
+        request = &_queue[q];
+        break;
+      }
+      if (_queue[q].state == StoreRequestFree && request == nullptr) {
+        request = &_queue[q];
+      }
+    }
+
+    // Queue is full
+    if (request == nullptr) {
+      _queueRejected++;
+      _queueMutex.unlock();
+      monitor.setMessage(LabelStoreQueueFull + String(key), MonitorWarning);
+
+      return 0;
+    }
+
+    // Buffers are kept between requests, they only grow
+    if (request->capacity < size) {
+      uint8_t *grown = (uint8_t *)realloc(request->buffer, size);
+      if (grown == nullptr) {
+        _queueMutex.unlock();
+
+        return 0;
+      }
+      request->buffer = grown;
+      request->capacity = size;
+    }
+    memcpy(request->buffer, buffer, size);
+    request->size = size;
+    request->done = done;
+
+    uint8_t ret = 2;
+    if (request->state == StoreRequestFree) {
+      strcpy(request->key, key);
+      request->order = _queueOrder++;
+      request->state = StoreRequestPending;
+      board.setHold();
+      _queueSemaphore.release();
+      ret = 1;
+    }
+    _queueMutex.unlock();
+
+    return ret;
+  }
+
+  /**
+   * Queue a binary record to be written by flash writer thread.
+   *
+   * @see writeRecord()
+   * @see queueKey()
+   *
+   * @param   key     The key
+   * @param   record  The record buffer
+   * @param   schema  The payload schema version
+   * @param   length  The payload length
+   * @param   done    The callback called with write result
+   *
+   * @return  1 if queued, 2 if a pending request is replaced, else 0 on error or if queue is full
+   */
+  uint8_t queueRecord(const char *key, uint8_t *record, uint16_t schema, uint16_t length, Callback<void(uint8_t)> done = nullptr) {
+
+    return queueKey(key, record, setRecordHeader(record, schema, length), done);
+  }
+
+  /**
+   * Read a binary record from store.
+   *
+   * Payload starts at record + StoreRecordHeaderLength.
+   *
+   * @param   key     The key
+   * @param   record  The record buffer
+   * @param   size    The record buffer size
+   * @param   schema  The payload schema version read
+   *
+   * @return  The payload length, else -1 if record is missing or corrupted
+   */
+  int32_t readRecord(const char *key, uint8_t *record, size_t size, uint16_t &schema) {
+    int32_t actual = readKey(key, record, size);
+    if (actual < StoreRecordHeaderLength) {
+
+      return -1;
+    }
+
+    uint32_t magic = 0, crc = 0;
+    uint16_t length = 0;
+    memcpy(&magic, record, 4);
+    memcpy(&schema, record + 4, 2);
+    memcpy(&length, record + 6, 2);
+    memcpy(&crc, record + 8, 4);
+
+    if (magic != StoreRecordMagic
+      || StoreRecordHeaderLength + length != actual
+      || crc32(record + StoreRecordHeaderLength, length) != crc
+    ) {
+
+      return -1;
+    }
+
+    return length;
+  }
+
+  /**
+   * Get number of requests rejected because flash write queue was full.
+   *
+   * @return  The rejected requests count
+   */
+  uint32_t getQueueRejected() {
+
+    return _queueRejected;
+  }
+
+  /**
+   * Get journal current sector sequence.
+   *
+   * @return  The sequence, 0 if there is no journal sector yet
+   */
+  uint32_t getJournalSequence() {
+
+    return _journalSequence;
+  }
+
+  /**
+   * Start a new journal sector after a compaction.
+   *
+   * Previous sectors are no more required.
+   *
+   * @param   sequence  The new sector sequence
+   *
+   * @return  1 on success, else 0
+   */
+  uint8_t startJournal(uint32_t sequence) {
+    if (_journalDevice == nullptr || !openJournal(sequence)) {
+
+      return 0;
+    }
+    _journalFirst = sequence;
+
+    return 1;
+  }
+
+  /**
+   * Append an entry to journal.
+   *
+   * Next sector is erased by flash writer thread once current one is half full,
+   * it is used when current one is full.
+   * This fails when all sectors are still required,
+   * journal must then be compacted into a snapshot.
+   *
+   * @param   uid     The io uid
+   * @param   field   The io field
+   * @param   value   The io field value
+   *
+   * @return  1 on success, 2 if next sector is not yet erased (retry later), else 0
+   */
+  uint8_t writeJournal(uint16_t uid, uint8_t field, uint32_t value) {
+    if (_journalDevice == nullptr || _journalSequence == 0 || _journalFirst == 0) {
+
+      return 0;
+    }
+
+    uint32_t next = _journalSequence + 1;
+    uint8_t available = next - _journalFirst < _journalSectors ? 1 : 0;
+    if (available && _journalErased != next && _journalErase != next && _journalOffset * 2 >= _journalSectorSize) {
+      _journalErase = next;
+      _queueSemaphore.release();
+    }
+
+    if (_journalOffset + StoreJournalEntryLength > _journalSectorSize) {
+      if (!available) {
+
+        return 0;
+      }
+      if (_journalErased != next) {
+
+        return 2;
+      }
+      if (!openJournal(next)) {
+
+        return 0;
+      }
+    }
+
+    uint8_t entry[StoreJournalEntryLength];
+    memcpy(entry, &uid, 2);
+    entry[2] = field;
+    memcpy(entry + 4, &value, 4);
+    entry[3] = getJournalCheck(entry);
+
+    uint32_t address = getJournalAddress(_journalSequence) + _journalOffset;
+    // a failed entry is skipped on replay by its check byte
+    _journalOffset += StoreJournalEntryLength;
+
+    return _journalDevice->program(entry, address, StoreJournalEntryLength) == BD_ERROR_OK ? 1 : 0;
+  }
+
+  /**
+   * Rewind journal replay.
+   *
+   * @param   sequence  The first sector sequence to replay
+   */
+  void rewindJournal(uint32_t sequence) {
+    if (_journalSequence >= _journalSectors && sequence <= _journalSequence - _journalSectors) {
+      sequence = _journalSequence - _journalSectors + 1;
+    }
+    _journalFirst = sequence > 0 ? sequence : 1;
+    _journalReadSequence = _journalFirst;
+    _journalReadOffset = 0;
+  }
+
+  /**
+   * Read next journal entry.
+   *
+   * Corrupted entries and sectors are skipped.
+   *
+   * @param   uid     The io uid read
+   * @param   field   The io field read
+   * @param   value   The io field value read
+   *
+   * @return  1 if an entry is read, 0 at the end of journal
+   */
+  uint8_t readJournal(uint16_t &uid, uint8_t &field, uint32_t &value) {
+    uint8_t entry[StoreJournalEntryLength];
+    while (_journalDevice != nullptr && _journalReadSequence > 0 && _journalReadSequence <= _journalSequence) {
+      if (_journalReadOffset == 0) {
+        if (!checkJournalSector(_journalReadSequence)) {
+          _journalReadSequence++;
+          continue;
+        }
+        _journalReadOffset = StoreJournalHeaderLength;
+      }
+
+      if (_journalReadOffset + StoreJournalEntryLength > _journalSectorSize
+        || _journalDevice->read(entry, getJournalAddress(_journalReadSequence) + _journalReadOffset, StoreJournalEntryLength) != BD_ERROR_OK
+        || isJournalErased(entry)
+      ) {
+        _journalReadSequence++;
+        _journalReadOffset = 0;
+        continue;
+      }
+      _journalReadOffset += StoreJournalEntryLength;
+
+      if (entry[3] == getJournalCheck(entry)) {
+        memcpy(&uid, entry, 2);
+        field = entry[2];
+        memcpy(&value, entry + 4, 4);
+
+        return 1;
+      }
+    }
+
+    return 0;
+  }
+
   /**
    * Deleted a stored key.
    *
@@ -152,14 +996,46 @@ public:
     return _bootCount;
   }
 
+  /**
+   * Check if flash memory partitions layout is valid.
+   *
+   * @param   root  The flash device
+   *
+   * @return  1 if MBR exists and partitions match expected layout, else 0
+   */
+  uint8_t checkLayout(BlockDevice *root) {
+    for (uint8_t p = 0; p < 4; p++) {
+      MBRBlockDevice part(root, p + 1);
+      if (part.init() != BD_ERROR_OK) {
+
+        return 0;
+      }
+
+      // Partition 1 start depends on MBR sector size
+      uint8_t valid = part.get_partition_type() == StorePartitionType
+        && part.get_partition_stop() == StorePartitionStop[p]
+        && (p == 0 || part.get_partition_start() == StorePartitionStart[p]);
+      part.deinit();
+
+      if (!valid) {
+
+        return 0;
+      }
+    }
+
+    return 1;
+  }
+
   /**
    * Process flash memory partition and formatting.
    *
+   * Existing partitions and filesystems are kept unless force is set.
+   *
    * @return  1 on succes (even if nothing is done), else 0
    */
   uint8_t formatMemory(uint8_t force = 0) {
 
-    uint8_t wifi_exists = 0, ota_exists = 0, user_exists = 0;
+    uint8_t layout_exists = 0, wifi_exists = 0, ota_exists = 0, user_exists = 0;
 
     // Init partitions
     BlockDevice* root = BlockDevice::get_default_instance();
@@ -171,7 +1047,7 @@ public:
     // Init filesystems
     FATFileSystem wifi_data_fs("wlan");
     FATFileSystem ota_data_fs("fs");
-    FileSystem *user_data_fs;
+    LittleFileSystem user_data_fs("user");
 
     // init instance
     if (root->init() != BD_ERROR_OK) {
@@ -180,20 +1056,27 @@ public:
       return 0;
     }
 
+    // Fast path: keep existing partitions if layout is valid
+    if (!force && checkLayout(root)) {
+      monitor.setMessage(LabelStoreLayout, MonitorInfo);
+      layout_exists = 1;
+    }
+
     // Erase all
     if (force) {
       monitor.setMessage(LabelStoreErase, MonitorInfo);
       root->erase(0x0, root->size());
-    } else {
+    } else if (!layout_exists) {
       // Erase only the first sector containing the MBR
       root->erase(0x0, root->get_erase_size());
     }
 
     // Define partions sizes
-    MBRBlockDevice::partition(root, 1, 0x0B, 0, 1 * 1024 * 1024);
-    MBRBlockDevice::partition(root, 2, 0x0B, 1 * 1024 * 1024,  6 * 1024 * 1024);
-    MBRBlockDevice::partition(root, 3, 0x0B, 6 * 1024 * 1024,  7 * 1024 * 1024);
-    MBRBlockDevice::partition(root, 4, 0x0B, 7 * 1024 * 1024, 14 * 1024 * 1024);
+    if (!layout_exists) {
+      for (uint8_t p = 0; p < 4; p++) {
+        MBRBlockDevice::partition(root, p + 1, StorePartitionType, StorePartitionStart[p], StorePartitionStop[p]);
+      }
+    }
     // use space from 15.5MB to 16 MB for another fw, memory mapped
 
     // Check if Wifi partition exists
@@ -280,6 +1163,7 @@ public:
     if (!ota_data_fs.mount(&ota_data)) {
       monitor.setMessage(LabelStoreExisting + String("OTA"), MonitorInfo);
       ota_data_fs.unmount();
+      ota_exists = 1;
     }
 
     // Manage OTA partition
@@ -292,20 +1176,18 @@ public:
       }
     }
 
-    // Set User parttion as little FS
-    user_data_fs = new LittleFileSystem("user");
-
     // Check if User partition exists
-    if (!user_data_fs->mount(&user_data)) {
+    if (!user_data_fs.mount(&user_data)) {
       monitor.setMessage(LabelStoreExisting + String("User"), MonitorInfo);
-      user_data_fs->unmount();
+      user_data_fs.unmount();
+      user_exists = 1;
     }
 
     // Manage User partition
     if (!user_exists || force) {
 
       // Format User partition
-      if (user_data_fs->reformat(&user_data)) {
+      if (user_data_fs.reformat(&user_data)) {
         monitor.setMessage(LabelStoreFormatFail + String("User"), MonitorFail);
 
         return 0;
@@ -0,0 +1,820 @@
+/*
+ * OptaLinker
+ *
+ * Author: Jean-Christian Paul Denis
+ * Source: https://github.com/JcDenis/OptaLinker
+ *
+ * @see OptaLinker.h
+ * @see README.md file
+ */
+
+#ifndef OPTALINKER_UPDATE_H
+#define OPTALINKER_UPDATE_H
+
+#include <stdio.h>
+#include <Ethernet.h>
+#include <EthernetSSLClient.h>
+#include <WiFi.h>
+#include <WiFiSSLClient.h>
+
+#include "OptaLinkerModule.h"
+
+namespace optalinker {
+
+class OptaLinkerMonitor;
+class OptaLinkerBoard;
+class OptaLinkerStore;
+class OptaLinkerNetwork;
+
+/**
+ * OptaLinker Library OTA update module.
+ *
+ * Download OTA file and write firmware to update file in a single pass.
+ * CRC is computed and LZSS payload is uncompressed as chunks arrive,
+ * compressed file is never stored.
+ *
+ * Download state is saved regularly, a broken download is resumed
+ * with an HTTP Range request, even after a reboot.
+ *
+ * A delta payload is applied to running firmware while it arrives.
+ */
+class OptaLinkerUpdate : public OptaLinkerModule {
+
+private:
+  OptaLinkerMonitor &monitor;
+  OptaLinkerBoard &board;
+  OptaLinkerNetwork &network;
+
+  /**
+   * Update file.
+   */
+  FILE *_file = nullptr;
+
+  /**
+   * Download state, saved to resume download.
+   */
+  struct UpdateState {
+    uint32_t magic;
+    uint32_t url;      // URL CRC32
+    uint32_t total;    // OTA file length from server
+    uint32_t length;   // OTA file header length
+    uint32_t check;    // OTA file header CRC32
+    uint32_t received; // OTA file bytes received
+    uint32_t written;  // Update file bytes written
+    uint32_t crc;      // OTA file CRC32 of received bytes
+    uint8_t isCompressed;
+    uint8_t lzssState;
+    uint8_t lzssBits;
+    uint16_t lzssValue;
+    uint16_t lzssPosition;
+    uint16_t lzssR;
+    uint8_t header[UpdateHeaderLength];
+    uint8_t lzssBuffer[UpdateLzssN];
+    uint8_t isDelta;
+    uint8_t deltaState;
+    uint8_t deltaBytes;
+    uint8_t deltaField[UpdateDeltaHeaderLength];
+    uint32_t deltaRemaining;
+    uint32_t deltaBase;     // running firmware length
+    uint32_t deltaLength;   // new firmware length
+    uint32_t deltaCheck;    // new firmware CRC32
+    uint32_t deltaCrc;      // CRC32 of written bytes
+  };
+  UpdateState _state;
+  int _error = UpdateErrorNone;
+
+  /**
+   * Download settings.
+   */
+  uint16_t _chunkSize = OPTALINKER_UPDATE_CHUNK;
+  uint8_t _retry = OPTALINKER_UPDATE_RETRY;
+  uint32_t _backoff = OPTALINKER_UPDATE_BACKOFF;
+
+  /**
+   * Download buffer.
+   */
+  uint8_t _chunk[UpdateChunkMax];
+
+  /**
+   * Update file write buffer.
+   */
+  uint8_t _out[UpdateWriteSize];
+  uint16_t _outLength = 0;
+
+  /**
+   * Continue a CRC32 (zlib) over a buffer.
+   *
+   * This is computed in software as running CRC is saved in download state
+   * and resumed after a reboot, which hardware CRC unit partial computation does not allow.
+   *
+   * @param   crc     The previous CRC32, 0 to start
+   * @param   buffer  The buffer
+   * @param   size    The buffer length
+   *
+   * @return  The CRC32
+   */
+  static uint32_t crc32(uint32_t crc, const uint8_t *buffer, size_t size) {
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++) {
+      crc ^= buffer[i];
+      crc = (crc >> 4) ^ UpdateCrcTable[crc & 0x0F];
+      crc = (crc >> 4) ^ UpdateCrcTable[crc & 0x0F];
+    }
+
+    return ~crc;
+  }
+
+  /**
+   * Write buffered bytes to update file.
+   */
+  void flush() {
+    if (_outLength > 0 && _error == UpdateErrorNone) {
+      if (_state.isDelta) {
+        _state.deltaCrc = crc32(_state.deltaCrc, _out, _outLength);
+      }
+      if (fwrite(_out, 1, _outLength, _file) != _outLength) {
+        _error = UpdateErrorFile;
+      }
+      _state.written += _outLength;
+    }
+    _outLength = 0;
+  }
+
+  /**
+   * Add a byte to update file.
+   *
+   * @param   c   The byte
+   */
+  void output(uint8_t c) {
+    _out[_outLength++] = c;
+    if (_outLength == UpdateWriteSize) {
+      flush();
+    }
+  }
+
+  /**
+   * Add a byte of uncompressed payload.
+   *
+   * @param   c   The byte
+   */
+  void emit(uint8_t c) {
+    if (_state.isDelta) {
+      patch(c);
+    } else {
+      output(c);
+    }
+  }
+
+  /**
+   * Read a little endian uint32 from current delta field.
+   *
+   * @param   offset  The offset in field
+   *
+   * @return  The value
+   */
+  uint32_t getDeltaField(uint8_t offset) {
+    uint32_t value;
+    memcpy(&value, _state.deltaField + offset, 4);
+
+    return value;
+  }
+
+  /**
+   * Set delta patcher next expected field.
+   *
+   * @param   state   The field type (UpdateDeltaState)
+   */
+  void expectDelta(uint8_t state) {
+    _state.deltaState = state;
+    _state.deltaBytes = 0;
+  }
+
+  /**
+   * Apply a byte of delta payload.
+   *
+   * @param   c   The delta byte
+   */
+  void patch(uint8_t c) {
+    UpdateState &st = _state;
+    const uint8_t *image = (const uint8_t *)UpdateImageAddress;
+    if (_error != UpdateErrorNone) {
+
+      return;
+    }
+
+    switch (st.deltaState) {
+      case UpdateDeltaStateHeader:
+        st.deltaField[st.deltaBytes++] = c;
+        if (st.deltaBytes == UpdateDeltaHeaderLength) {
+          st.deltaBase = getDeltaField(4);
+          st.deltaLength = getDeltaField(12);
+          st.deltaCheck = getDeltaField(16);
+          if (getDeltaField(0) != UpdateDeltaMagic) {
+            _error = UpdateErrorDelta;
+          } else if (st.deltaBase > UpdateImageMax || OptaLinkerStore::crc32(image, st.deltaBase) != getDeltaField(8)) {
+            _error = UpdateErrorBase;
+          }
+          expectDelta(UpdateDeltaStateOperation);
+        }
+        break;
+
+      case UpdateDeltaStateOperation:
+        if (c == UpdateDeltaCopy) {
+          expectDelta(UpdateDeltaStateCopy);
+        } else if (c == UpdateDeltaData) {
+          expectDelta(UpdateDeltaStateLength);
+        } else {
+          _error = UpdateErrorDelta;
+        }
+        break;
+
+      case UpdateDeltaStateCopy:
+        st.deltaField[st.deltaBytes++] = c;
+        if (st.deltaBytes == 8) {
+          uint32_t offset = getDeltaField(0);
+          uint32_t length = getDeltaField(4);
+          if (offset > st.deltaBase || length > st.deltaBase - offset) {
+            _error = UpdateErrorDelta;
+
+            return;
+          }
+          for (uint32_t i = 0; i < length; i++) {
+            output(image[offset + i]);
+            if ((i & 0xFFF) == 0xFFF) {
+              board.pingTimeout();
+            }
+          }
+          expectDelta(UpdateDeltaStateOperation);
+        }
+        break;
+
+      case UpdateDeltaStateLength:
+        st.deltaField[st.deltaBytes++] = c;
+        if (st.deltaBytes == 4) {
+          st.deltaRemaining = getDeltaField(0);
+          expectDelta(st.deltaRemaining > 0 ? UpdateDeltaStateData : UpdateDeltaStateOperation);
+        }
+        break;
+
+      case UpdateDeltaStateData:
+        output(c);
+        if (--st.deltaRemaining == 0) {
+          expectDelta(UpdateDeltaStateOperation);
+        }
+        break;
+    }
+  }
+
+  /**
+   * Set LZSS decoder next expected code.
+   *
+   * @param   state   The code type (UpdateLzssState)
+   * @param   bits    The code length in bits
+   */
+  void expect(uint8_t state, uint8_t bits) {
+    _state.lzssState = state;
+    _state.lzssBits = bits;
+    _state.lzssValue = 0;
+  }
+
+  /**
+   * Uncompress a byte of LZSS payload.
+   *
+   * Codes can be split across bytes and chunks,
+   * so bits are read one by one into the expected code.
+   *
+   * @param   c   The compressed byte
+   */
+  void decode(uint8_t c) {
+    UpdateState &st = _state;
+    for (uint8_t mask = 128; mask > 0; mask >>= 1) {
+      st.lzssValue = (st.lzssValue << 1) | (c & mask ? 1 : 0);
+      if (--st.lzssBits > 0) {
+        continue;
+      }
+
+      switch (st.lzssState) {
+        case UpdateLzssFlag:
+          if (st.lzssValue) {
+            expect(UpdateLzssLiteral, 8);
+          } else {
+            expect(UpdateLzssPosition, UpdateLzssEI);
+          }
+          break;
+
+        case UpdateLzssLiteral:
+          emit(st.lzssValue);
+          st.lzssBuffer[st.lzssR++] = st.lzssValue;
+          st.lzssR &= (UpdateLzssN - 1);
+          expect(UpdateLzssFlag, 1);
+          break;
+
+        case UpdateLzssPosition:
+          st.lzssPosition = st.lzssValue;
+          expect(UpdateLzssLength, UpdateLzssEJ);
+          break;
+
+        case UpdateLzssLength:
+          for (uint16_t k = 0; k <= st.lzssValue + 1; k++) {
+            uint8_t b = st.lzssBuffer[(st.lzssPosition + k) & (UpdateLzssN - 1)];
+            emit(b);
+            st.lzssBuffer[st.lzssR++] = b;
+            st.lzssR &= (UpdateLzssN - 1);
+          }
+          expect(UpdateLzssFlag, 1);
+          break;
+      }
+    }
+  }
+
+  /**
+   * Save download state.
+   *
+   * Update file is flushed first, so state always matches file content.
+   *
+   * @return  1 on success, else 0
+   */
+  uint8_t saveState() {
+    flush();
+    if (_file == nullptr || _error != UpdateErrorNone || fflush(_file) != 0) {
+
+      return 0;
+    }
+
+    FILE *file = fopen(UpdateStateFile, "wb");
+    if (file == nullptr) {
+
+      return 0;
+    }
+    _state.magic = UpdateStateMagic;
+    size_t ret = fwrite(&_state, sizeof(_state), 1, file);
+    fclose(file);
+
+    return ret == 1 ? 1 : 0;
+  }
+
+  /**
+   * Load download state and reopen update file.
+   *
+   * @param   url   The URL CRC32
+   *
+   * @return  1 if download can be resumed, else 0
+   */
+  uint8_t loadState(uint32_t url) {
+    FILE *file = fopen(UpdateStateFile, "rb");
+    if (file == nullptr) {
+
+      return 0;
+    }
+    size_t ret = fread(&_state, sizeof(_state), 1, file);
+    fclose(file);
+
+    if (ret != 1 || _state.magic != UpdateStateMagic || _state.url != url || _state.received == 0) {
+
+      return 0;
+    }
+
+    _file = fopen(UpdateFile, "r+b");
+    if (_file == nullptr || fseek(_file, _state.written, SEEK_SET) != 0) {
+      closeFile();
+
+      return 0;
+    }
+    _outLength = 0;
+    _error = UpdateErrorNone;
+
+    return 1;
+  }
+
+  /**
+   * Check if whole OTA file is received.
+   *
+   * @return  1 if complete, else 0
+   */
+  uint8_t isComplete() {
+
+    return (_state.received >= UpdateHeaderLength && _state.received >= _state.length + 8)
+      || (_state.total > 0 && _state.received >= _state.total) ? 1 : 0;
+  }
+
+  /**
+   * Close update file.
+   */
+  void closeFile() {
+    if (_file != nullptr) {
+      fclose(_file);
+      _file = nullptr;
+    }
+  }
+
+  /**
+   * Wait before next download retry.
+   *
+   * Board watchdog is kicked while waiting.
+   *
+   * @param   retry   The retry number, from 1
+   */
+  void wait(uint8_t retry) {
+    uint32_t duration = _backoff << min(retry - 1, 16);
+    if (duration > UpdateBackoffMax) {
+      duration = UpdateBackoffMax;
+    }
+    monitor.setMessage(LabelUpdateRetry + String(duration), MonitorInfo);
+
+    uint32_t start = millis();
+    while (millis() - start < duration) {
+      board.pingTimeout();
+      delay(100);
+    }
+  }
+
+  /**
+   * Parse URL.
+   *
+   * @param   url     The URL as http(s)://host[:port]/path
+   * @param   host    The host to fill in
+   * @param   port    The port to fill in
+   * @param   path    The path to fill in
+   * @param   ssl     The https flag to fill in
+   *
+   * @return  1 on success, else 0
+   */
+  uint8_t parseUrl(String url, String &host, uint16_t &port, String &path, uint8_t &ssl) {
+    int start = url.indexOf("://");
+    if (start < 0) {
+
+      return 0;
+    }
+    ssl = url.startsWith("https") ? 1 : 0;
+    start += 3;
+
+    int end = url.indexOf('/', start);
+    host = end < 0 ? url.substring(start) : url.substring(start, end);
+    path = end < 0 ? "/" : url.substring(end);
+    port = ssl ? 443 : 80;
+
+    int colon = host.indexOf(':');
+    if (colon >= 0) {
+      port = host.substring(colon + 1).toInt();
+      host = host.substring(0, colon);
+    }
+
+    return host.length() > 0 && port > 0 ? 1 : 0;
+  }
+
+  /**
+   * Read a line of HTTP response header.
+   *
+   * @param   client    The network client
+   * @param   line      The line to fill in, without CRLF
+   *
+   * @return  1 on success, else 0 on timeout
+   */
+  uint8_t readLine(Client &client, String &line) {
+    line = "";
+    uint32_t last = millis();
+    while (millis() - last < network.getTimeout()) {
+      if (client.available() > 0) {
+        char c = client.read();
+        if (c == '\n') {
+
+          return 1;
+        }
+        if (c != '\r') {
+          line += c;
+        }
+        last = millis();
+      } else if (!client.connected()) {
+
+        return 0;
+      } else {
+        delay(1);
+      }
+    }
+
+    return 0;
+  }
+
+  /**
+   * Request OTA file and write it to update file.
+   *
+   * If some bytes are already received, only missing bytes are requested.
+   *
+   * @param   client  The network client
+   * @param   host    The server host
+   * @param   port    The server port
+   * @param   path    The file path
+   *
+   * @return  The error code (UpdateError)
+   */
+  int fetch(Client &client, String &host, uint16_t port, String &path) {
+    if (!client.connect(host.c_str(), port)) {
+
+      return UpdateErrorConnect;
+    }
+
+    String request = "GET " + path + " HTTP/1.1\r\nHost: " + host + "\r\nConnection: close\r\n";
+    if (_state.received > 0) {
+      request += "Range: bytes=" + String(_state.received) + "-\r\n";
+    }
+    client.print(request + "\r\n");
+
+    // Response headers
+    String line;
+    if (!readLine(client, line)) {
+      client.stop();
+
+      return UpdateErrorBroken;
+    }
+    int status = line.substring(line.indexOf(' ') + 1).toInt();
+    uint32_t length = 0;
+    uint32_t total = 0;
+    while (readLine(client, line) && line.length() > 0) {
+      line.toLowerCase();
+      if (line.startsWith("content-length:")) {
+        length = line.substring(15).toInt();
+      }
+      // bytes start-end/total
+      if (line.startsWith("content-range:") && line.indexOf('/') > 0) {
+        total = line.substring(line.indexOf('/') + 1).toInt();
+      }
+      if (line.startsWith("transfer-encoding:") && line.indexOf("chunked") >= 0) {
+        client.stop();
+
+        return UpdateErrorHttp;
+      }
+    }
+
+    // Resume, server must send missing part of same file, else restart
+    if (_state.received > 0 && (status != 206 || total != _state.total)) {
+      if (status == 206 || status == 416) {
+        client.stop();
+        begin(_state.url);
+
+        return UpdateErrorBroken;
+      }
+      begin(_state.url);
+    }
+    if (status != 200 && status != 206) {
+      client.stop();
+
+      return UpdateErrorHttp;
+    }
+    if (_state.received == 0) {
+      _state.total = length;
+    }
+
+    // Body
+    uint32_t last = millis();
+    uint8_t progress = _state.total > 0 ? _state.received * 10 / _state.total : 0;
+    uint8_t chunks = 0;
+    while (!isComplete() && millis() - last < network.getTimeout()) {
+      int read = client.available() > 0 ? client.read(_chunk, _chunkSize) : 0;
+      if (read > 0) {
+        last = millis();
+        if (!write(_chunk, read)) {
+          break;
+        }
+
+        if (_state.total > 0 && (_state.received * 10 / _state.total) > progress) {
+          progress = _state.received * 10 / _state.total;
+          monitor.setMessage(LabelUpdateProgress + String(progress * 10), MonitorInfo);
+        }
+        if (++chunks >= UpdateStateChunks) {
+          chunks = 0;
+          saveState();
+        }
+      } else if (!client.connected()) {
+        break;
+      } else {
+        delay(1);
+      }
+
+      board.pingTimeout();
+      yield();
+    }
+    client.stop();
+
+    if (_error != UpdateErrorNone) {
+
+      return _error;
+    }
+    if (!isComplete()) {
+      saveState();
+
+      return millis() - last < network.getTimeout() ? UpdateErrorBroken : UpdateErrorTimeout;
+    }
+
+    return UpdateErrorNone;
+  }
+
+public:
+  OptaLinkerUpdate(OptaLinkerMonitor &_monitor, OptaLinkerBoard &_board, OptaLinkerNetwork &_network) : monitor(_monitor), board(_board), network(_network) {}
+
+  /**
+   * Set download chunk size.
+   *
+   * @param   size  The chunk size in bytes, up to UpdateChunkMax
+   */
+  void setChunkSize(uint16_t size) {
+    _chunkSize = size < 64 ? 64 : (size > UpdateChunkMax ? UpdateChunkMax : size);
+  }
+
+  /**
+   * Set download retries on connection lost.
+   *
+   * @param   retry     The number of retries
+   * @param   backoff   The first retry delay in ms, it doubles on each retry
+   */
+  void setRetry(uint8_t retry, uint32_t backoff) {
+    _retry = retry;
+    _backoff = backoff;
+  }
+
+  /**
+   * Start writing a new update file.
+   *
+   * OTA storage must be mounted.
+   *
+   * @param   url   The URL CRC32
+   *
+   * @return  1 on success, else 0
+   */
+  uint8_t begin(uint32_t url = 0) {
+    closeFile();
+    remove(UpdateStateFile);
+
+    memset(&_state, 0, sizeof(_state));
+    _state.url = url;
+    _outLength = 0;
+    _error = UpdateErrorNone;
+
+    memset(_state.lzssBuffer, ' ', UpdateLzssN - UpdateLzssF);
+    _state.lzssR = UpdateLzssN - UpdateLzssF;
+    expect(UpdateLzssFlag, 1);
+
+    _file = fopen(UpdateFile, "wb");
+    if (_file == nullptr) {
+      _error = UpdateErrorFile;
+
+      return 0;
+    }
+
+    return 1;
+  }
+
+  /**
+   * Write a chunk of OTA file.
+   *
+   * @param   buffer  The chunk
+   * @param   size    The chunk length
+   *
+   * @return  1 on success, else 0
+   */
+  uint8_t write(const uint8_t *buffer, size_t size) {
+    UpdateState &st = _state;
+    size_t offset = 0;
+
+    // Header
+    while (st.received < UpdateHeaderLength && offset < size && _error == UpdateErrorNone) {
+      st.header[st.received++] = buffer[offset++];
+      if (st.received == UpdateHeaderLength) {
+        memcpy(&st.length, st.header, 4);
+        memcpy(&st.check, st.header + 4, 4);
+        uint32_t magic;
+        memcpy(&magic, st.header + 8, 4);
+        if (magic != UpdateMagic) {
+          _error = UpdateErrorMagic;
+        } else if (st.length < UpdateHeaderLength - 8) {
+          _error = UpdateErrorLength;
+        }
+        st.isCompressed = (st.header[UpdateHeaderLength - 1] & UpdateCompressed) ? 1 : 0;
+        st.isDelta = (st.header[UpdateHeaderLength - 1] & UpdateDelta) ? 1 : 0;
+        st.crc = crc32(0, st.header + 8, UpdateHeaderLength - 8);
+      }
+    }
+
+    // Payload
+    if (offset < size && _error == UpdateErrorNone) {
+      if (st.received + (size - offset) > st.length + 8) {
+        _error = UpdateErrorLength;
+
+        return 0;
+      }
+      st.crc = crc32(st.crc, buffer + offset, size - offset);
+      st.received += size - offset;
+
+      for (; offset < size; offset++) {
+        if (st.isCompressed) {
+          decode(buffer[offset]);
+        } else {
+          emit(buffer[offset]);
+        }
+      }
+    }
+
+    return _error == UpdateErrorNone ? 1 : 0;
+  }
+
+  /**
+   * Finish update file and check it.
+   *
+   * Update file is removed on error.
+   *
+   * @return  The firmware length, else an error code (UpdateError)
+   */
+  int end() {
+    flush();
+    closeFile();
+    remove(UpdateStateFile);
+
+    if (_error == UpdateErrorNone) {
+      if (_state.received < UpdateHeaderLength || _state.received != _state.length + 8) {
+        _error = UpdateErrorLength;
+      } else if (_state.crc != _state.check) {
+        _error = UpdateErrorCrc;
+      } else if (_state.isDelta && (_state.deltaState != UpdateDeltaStateOperation || _state.written != _state.deltaLength)) {
+        _error = UpdateErrorDelta;
+      } else if (_state.isDelta && _state.deltaCrc != _state.deltaCheck) {
+        _error = UpdateErrorCrc;
+      }
+    }
+
+    if (_error != UpdateErrorNone) {
+      remove(UpdateFile);
+
+      return _error;
+    }
+
+    return _state.written;
+  }
+
+  /**
+   * Download OTA file to update file.
+   *
+   * OTA storage must be mounted.
+   * Board watchdog is kicked on each chunk.
+   * On connection lost, download is retried from where it stopped,
+   * if all retries fail, it is resumed on next call with same URL.
+   *
+   * @param   url   The OTA file URL
+   *
+   * @return  The firmware length, else an error code (UpdateError)
+   */
+  int download(String url) {
+    String host;
+    String path;
+    uint16_t port;
+    uint8_t ssl;
+    if (!parseUrl(url, host, port, path, ssl)) {
+
+      return UpdateErrorUrl;
+    }
+
+    static EthernetClient ethernetClient;
+    static EthernetSSLClient ethernetSslClient;
+    static WiFiClient wifiClient;
+    static WiFiSSLClient wifiSslClient;
+    Client *client;
+    if (network.isEthernet()) {
+      client = ssl ? (Client *)&ethernetSslClient : (Client *)&ethernetClient;
+    } else {
+      client = ssl ? (Client *)&wifiSslClient : (Client *)&wifiClient;
+    }
+
+    uint32_t urlCrc = OptaLinkerStore::crc32(url.c_str(), url.length());
+    if (loadState(urlCrc)) {
+      monitor.setMessage(LabelUpdateResume + String(_state.received), MonitorInfo);
+    } else if (!begin(urlCrc)) {
+
+      return end();
+    }
+
+    int ret = UpdateErrorNone;
+    for (uint8_t retry = 0; retry <= _retry; retry++) {
+      if (retry > 0) {
+        wait(retry);
+      }
+      ret = fetch(*client, host, port, path);
+      if (ret != UpdateErrorConnect && ret != UpdateErrorBroken && ret != UpdateErrorTimeout) {
+        break;
+      }
+    }
+
+    // Keep state and file to resume on next call
+    if (ret == UpdateErrorConnect || ret == UpdateErrorBroken || ret == UpdateErrorTimeout) {
+      flush();
+      closeFile();
+
+      return ret;
+    }
+    _error = ret;
+
+    return end();
+  }
+
+}; // class OptaLinkerUpdate
+
+} // namespace optalinker
+
+#endif // #ifndef OPTALINKER_UPDATE_H
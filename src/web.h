@@ -26,6 +26,7 @@ class OptaLinkerMonitor;
 class OptaLinkerBoard;
 class OptaLinkerConfig;
 class OptaLinkerIo;
+class OptaLinkerRules;
 class OptaLinkerNetwork;
 class OptaLinkerClock;
 class OptaLinkerMqtt;
@@ -44,6 +45,7 @@ private:
   OptaLinkerBoard &board;
   OptaLinkerConfig &config;
   OptaLinkerIo &io;
+  OptaLinkerRules &rules;
   OptaLinkerNetwork &network;
   OptaLinkerClock &clock;
   OptaLinkerMqtt &mqtt;
@@ -110,6 +112,8 @@ private:
               receiveConfig(client);
             } else if (webConnectRequest.startsWith("GET /publish ")) {
               receivePublish(client);
+            } else if (webConnectRequest.startsWith("GET /outputs?")) {
+              receiveOutputs(client, webConnectRequest);
             } else if (webConnectRequest.startsWith("GET /config ")) {
               sendConfig(client);
             } else if (webConnectRequest.startsWith("GET /data ")) {
@@ -281,11 +285,29 @@ private:
    * @param   client  The client
    */
   void sendConfig(Client *&client) {
+    JsonDocument doc;
+    String stringConfig = config.writeToJson(true);
+    deserializeJson(doc, stringConfig.c_str(), stringConfig.length());
+
+    // inputs settings
+    JsonDocument input;
+    String stringInput = io.writeSettingsToJson();
+    DeserializationError error = deserializeJson(input, stringInput.c_str(), stringInput.length());
+    if (!error) {
+      doc["input"] = input;
+    }
+
+    // local rules
+    doc["rules"] = rules.getRules();
+
+    String jsonString;
+    serializeJson(doc, jsonString);
+
     client->println("HTTP/1.1 200 OK");
     client->println("Content-Type: application/json");
     client->println("Connection: close");
     client->println();
-    client->println(config.writeToJson(true));
+    client->println(jsonString);
   }
 
 
@@ -391,15 +413,25 @@ private:
 
     if (isValid) {
       config.writeToFile();
-
-      client->println("HTTP/1.1 200 OK");
-      client->println("Content-Type: application/json");
-      client->println("Connection: close");
-      client->println();
-      client->println("{\"status\":\"success\",\"message\":\"Configuration updated\"}");
+      io.readSettingsFromJson(jsonString.c_str(), jsonString.length());
+
+      // other settings are applied even if rules do not compile, running rules are kept
+      if (!rules.readFromJson(jsonString.c_str(), jsonString.length())) {
+        client->println("HTTP/1.1 400 BAD REQUEST");
+        client->println("Content-Type: application/json");
+        client->println("Connection: close");
+        client->println();
+        client->println(String("{\"status\":\"error\",\"message\":\"") + LabelRulesCompileFail + rules.getErrorPosition() + "\",\"position\":" + rules.getErrorPosition() + "}");
+      } else {
+        client->println("HTTP/1.1 200 OK");
+        client->println("Content-Type: application/json");
+        client->println("Connection: close");
+        client->println();
+        client->println("{\"status\":\"success\",\"message\":\"Configuration updated\"}");
+      }
       client->stop();
 
-      board.reboot();
+      config.setApply();
     } else {
       client->println("HTTP/1.1 403 FORBIDDEN");
       client->println("Content-Type: application/json");
@@ -427,8 +459,55 @@ private:
     client->println("{\"status\":\"success\",\"message\":\"Informations published\"}");
   }
 
+  /**
+   * Get a numeric query parameter from request line.
+   *
+   * @param   request   The request line
+   * @param   name      The parameter name
+   *
+   * @return  The parameter value, else -1
+   */
+  long getQueryParameter(String &request, const char *name) {
+    int start = request.indexOf("?" + String(name) + "=");
+    if (start < 0) {
+      start = request.indexOf("&" + String(name) + "=");
+    }
+    if (start < 0) {
+
+      return -1;
+    }
+
+    return request.substring(start + strlen(name) + 2).toInt();
+  }
+
+  /**
+   * Handle receive outputs group commnand.
+   *
+   * Request is as: GET /outputs?expansion=1&mask=15&value=5
+   *
+   * @param   client    The client
+   * @param   request   The request line
+   */
+  void receiveOutputs(Client *&client, String &request) {
+    long expansion = getQueryParameter(request, "expansion");
+    long mask = getQueryParameter(request, "mask");
+    long value = getQueryParameter(request, "value");
+    uint8_t valid = expansion >= 0 && expansion < io.getExpansionsNum() && mask >= 0 && mask <= 255 && value >= 0 && value <= 255;
+
+    client->println(valid ? "HTTP/1.1 200 OK" : "HTTP/1.1 400 BAD REQUEST");
+    client->println("Content-Type: application/json");
+    client->println("Connection: close");
+    client->println();
+    if (valid) {
+      io.setOutputs(expansion, mask, value);
+      client->println(String("{\"status\":\"success\",\"outputs\":") + io.getOutputs(expansion) + "}");
+    } else {
+      client->println("{\"status\":\"error\",\"message\":\"Outputs not updated\"}");
+    }
+  }
+
 public:
-  OptaLinkerWeb(OptaLinkerVersion &_version, OptaLinkerState &_state, OptaLinkerMonitor &_monitor, OptaLinkerBoard &_board, OptaLinkerConfig &_config, OptaLinkerIo &_io, OptaLinkerNetwork &_network, OptaLinkerClock &_clock, OptaLinkerMqtt &_mqtt) : version(_version), state(_state), monitor(_monitor), board(_board), config(_config), io(_io), network(_network), clock(_clock), mqtt(_mqtt) {}
+  OptaLinkerWeb(OptaLinkerVersion &_version, OptaLinkerState &_state, OptaLinkerMonitor &_monitor, OptaLinkerBoard &_board, OptaLinkerConfig &_config, OptaLinkerIo &_io, OptaLinkerRules &_rules, OptaLinkerNetwork &_network, OptaLinkerClock &_clock, OptaLinkerMqtt &_mqtt) : version(_version), state(_state), monitor(_monitor), board(_board), config(_config), io(_io), rules(_rules), network(_network), clock(_clock), mqtt(_mqtt) {}
 
   uint8_t setup() {
     monitor.setMessage(LabelWebSetup, MonitorAction);